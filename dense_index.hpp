@@ -10,6 +10,40 @@
 #include <vector>
 #include <array>
 #include <deque>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <bit>
+#include <optional>
+#include <stdexcept>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <algorithm>
+#include <span>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <numeric>
+#include <cmath>
+#include <tuple>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace dense_index {
 
@@ -53,12 +87,13 @@ constexpr std::size_t get_index_value(const T& idx) {
 template<typename T>
 concept IndexTag = std::is_class_v<T> || std::is_enum_v<T>;
 
-// Strong index type with C++23 features
-template<IndexTag Tag>
+// Strong index type with C++23 features. Rep is the stored width; a narrower
+// Rep halves the footprint of index arrays when the domain fits in it.
+template<IndexTag Tag, std::unsigned_integral Rep = std::size_t>
 class StrongIndex {
 public:
     using tag_type = Tag;
-    using underlying_type = std::size_t;
+    using underlying_type = Rep;
 
 private:
     underlying_type value_{};
@@ -66,7 +101,17 @@ private:
 public:
     // Constructors
     constexpr StrongIndex() noexcept = default;
-    constexpr explicit StrongIndex(underlying_type value) noexcept : value_(value) {}
+    constexpr explicit StrongIndex(std::size_t value) noexcept : value_(static_cast<underlying_type>(value)) {
+        assert(value <= std::numeric_limits<underlying_type>::max() && "StrongIndex: value does not fit Rep");
+    }
+
+    // Construct from value, throwing std::length_error if it does not fit Rep
+    [[nodiscard]] static constexpr StrongIndex checked(std::size_t value) {
+        if (value > std::numeric_limits<underlying_type>::max()) {
+            throw std::length_error("StrongIndex::checked");
+        }
+        return StrongIndex(value);
+    }
 
     // Conversion operators
     [[nodiscard]] constexpr explicit operator underlying_type() const noexcept {
@@ -111,11 +156,11 @@ public:
 
     // Arithmetic operations
     [[nodiscard]] constexpr StrongIndex operator+(underlying_type n) const noexcept {
-        return StrongIndex(value_ + n);
+        return StrongIndex(static_cast<underlying_type>(value_ + n));
     }
 
     [[nodiscard]] constexpr StrongIndex operator-(underlying_type n) const noexcept {
-        return StrongIndex(value_ - n);
+        return StrongIndex(static_cast<underlying_type>(value_ - n));
     }
 
     constexpr StrongIndex& operator+=(underlying_type n) noexcept {
@@ -133,13 +178,33 @@ public:
     }
 };
 
+namespace detail {
+
+// IndexType(value), through IndexType::checked when the type has a narrow range
+template<typename IndexType>
+[[nodiscard]] constexpr IndexType checked_index(std::size_t value) {
+    if constexpr (requires { IndexType::checked(value); }) {
+        return IndexType::checked(value);
+    } else {
+        return IndexType(value);
+    }
+}
+
+// Throws std::length_error unless every index below size fits IndexType
+template<typename IndexType>
+constexpr void check_index_domain(std::size_t size) {
+    if (size != 0) (void)checked_index<IndexType>(size - 1);
+}
+
+} // namespace detail
+
 } // namespace dense_index
 
 // Helper to make index types hashable
-template<dense_index::IndexTag Tag>
-struct std::hash<dense_index::StrongIndex<Tag>> {
-    [[nodiscard]] std::size_t operator()(const dense_index::StrongIndex<Tag>& idx) const noexcept {
-        return std::hash<typename dense_index::StrongIndex<Tag>::underlying_type>{}(idx.value());
+template<dense_index::IndexTag Tag, typename Rep>
+struct std::hash<dense_index::StrongIndex<Tag, Rep>> {
+    [[nodiscard]] std::size_t operator()(const dense_index::StrongIndex<Tag, Rep>& idx) const noexcept {
+        return std::hash<Rep>{}(idx.value());
     }
 };
 
@@ -475,19 +540,22 @@ public:
 
     // Push/pop operations with index return
     [[nodiscard]] constexpr index_type push_back(const value_type& value) requires HasPushBack<Container> {
+        const auto idx = detail::checked_index<index_type>(container_.size());
         container_.push_back(value);
-        return index_type(container_.size() - 1);
+        return idx;
     }
 
     [[nodiscard]] constexpr index_type push_back(value_type&& value) requires HasPushBack<Container> {
+        const auto idx = detail::checked_index<index_type>(container_.size());
         container_.push_back(std::move(value));
-        return index_type(container_.size() - 1);
+        return idx;
     }
 
     template<typename... Args>
     [[nodiscard]] constexpr index_type emplace_back(Args&&... args) requires HasEmplaceBack<Container> {
+        const auto idx = detail::checked_index<index_type>(container_.size());
         container_.emplace_back(std::forward<Args>(args)...);
-        return index_type(container_.size() - 1);
+        return idx;
     }
 
     constexpr void pop_back() requires HasPopBack<Container> {
@@ -496,10 +564,12 @@ public:
 
     // Resize operations
     constexpr void resize(size_type count) requires HasResize<Container> {
+        detail::check_index_domain<index_type>(count);
         container_.resize(count);
     }
 
     constexpr void resize(size_type count, const value_type& value) requires HasResize<Container> {
+        detail::check_index_domain<index_type>(count);
         container_.resize(count, value);
     }
 
@@ -571,4 +641,7452 @@ using DenseArray = DenseIndexedContainer<std::array<T, N>, IndexType>;
 template<typename T, StrongIndexType IndexType>
 using DenseDeque = DenseIndexedContainer<std::deque<T>, IndexType>;
 
-} // namespace dense_index
\ No newline at end of file
+namespace detail {
+
+// Invoke f(base + i) for every set bit i of mask, lowest first
+template<typename Mask, typename F>
+constexpr void for_each_set_bit(Mask mask, std::size_t base, F&& f) {
+    while (mask != 0) {
+        f(base + static_cast<std::size_t>(std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+// Invoke f(i) for every i in [0, n) with values[i] == needle
+template<typename F>
+inline void for_each_equal_u32(const std::uint32_t* values, std::size_t n, std::uint32_t needle, F&& f) {
+    std::size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i key = _mm512_set1_epi32(static_cast<int>(needle));
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = _mm512_loadu_si512(values + i);
+        for_each_set_bit(static_cast<std::uint32_t>(_mm512_cmpeq_epi32_mask(v, key)), i, f);
+    }
+#elif defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi32(static_cast<int>(needle));
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        const __m256i eq = _mm256_cmpeq_epi32(v, key);
+        for_each_set_bit(static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))), i, f);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (values[i] == needle) f(i);
+    }
+}
+
+// Invoke f(i) for every i in [0, n) whose span length offsets[i + 1] - offsets[i]
+// equals len (or is at least len when AtLeast is set)
+template<bool AtLeast, typename F>
+inline void for_each_span_length(const std::uint32_t* offsets, std::size_t n, std::uint32_t len, F&& f) {
+    std::size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i key = _mm512_set1_epi32(static_cast<int>(len));
+    for (; i + 16 <= n; i += 16) {
+        const __m512i lo = _mm512_loadu_si512(offsets + i);
+        const __m512i hi = _mm512_loadu_si512(offsets + i + 1);
+        const __m512i lengths = _mm512_sub_epi32(hi, lo);
+        const __mmask16 mask = AtLeast ? _mm512_cmpge_epu32_mask(lengths, key)
+                                       : _mm512_cmpeq_epi32_mask(lengths, key);
+        for_each_set_bit(static_cast<std::uint32_t>(mask), i, f);
+    }
+#elif defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi32(static_cast<int>(len));
+    for (; i + 8 <= n; i += 8) {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i + 1));
+        const __m256i lengths = _mm256_sub_epi32(hi, lo);
+        const __m256i hit = AtLeast ? _mm256_cmpeq_epi32(_mm256_max_epu32(lengths, key), lengths)
+                                    : _mm256_cmpeq_epi32(lengths, key);
+        for_each_set_bit(static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit))), i, f);
+    }
+#endif
+    for (; i < n; ++i) {
+        const std::uint32_t length = offsets[i + 1] - offsets[i];
+        if (AtLeast ? length >= len : length == len) f(i);
+    }
+}
+
+} // namespace detail
+
+// Code domain of dictionary-encoded string columns
+struct DictTag {};
+using DictIndex = StrongIndex<DictTag>;
+
+// Storage strategy for DenseStringColumn
+enum class StringEncoding {
+    plain,      // every row appends its bytes to the arena
+    dictionary  // each distinct value is stored once, rows hold its DictIndex code
+};
+
+// Column of strings packed into one byte arena with a 32-bit offsets array.
+// Element access yields std::string_view, valid until the column is next modified.
+template<StrongIndexType IndexType>
+class DenseStringColumn {
+public:
+    using index_type = IndexType;
+    using value_type = std::string_view;
+    using size_type = std::size_t;
+    using offset_type = std::uint32_t;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::string_view;
+
+        constexpr const_iterator() noexcept = default;
+        constexpr const_iterator(const DenseStringColumn* column, size_type pos) noexcept
+            : column_(column), pos_(pos) {}
+
+        [[nodiscard]] std::string_view operator*() const { return column_->row(pos_); }
+
+        constexpr const_iterator& operator++() noexcept {
+            ++pos_;
+            return *this;
+        }
+
+        constexpr const_iterator operator++(int) noexcept {
+            const_iterator tmp(*this);
+            ++pos_;
+            return tmp;
+        }
+
+        [[nodiscard]] constexpr bool operator==(const const_iterator& other) const noexcept {
+            return pos_ == other.pos_;
+        }
+
+    private:
+        const DenseStringColumn* column_ = nullptr;
+        size_type pos_ = 0;
+    };
+    using iterator = const_iterator;
+
+private:
+    static constexpr std::uint32_t empty_slot = ~std::uint32_t{0};
+
+    StringEncoding encoding_ = StringEncoding::plain;
+    std::vector<char> bytes_;              // plain: row bytes, dictionary: distinct values
+    std::vector<offset_type> offsets_{0};  // plain: one span per row, dictionary: one per code
+    std::vector<std::uint32_t> codes_;     // dictionary: code of every row
+    std::vector<std::uint32_t> slots_;     // dictionary: open-addressing table of codes
+
+    [[nodiscard]] bool is_dictionary() const noexcept { return encoding_ == StringEncoding::dictionary; }
+
+    [[nodiscard]] std::string_view span(std::size_t i) const noexcept {
+        return std::string_view(bytes_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    [[nodiscard]] std::string_view row(size_type pos) const noexcept {
+        return span(is_dictionary() ? codes_[pos] : pos);
+    }
+
+    // Append s to the arena as a new span and return the span number
+    std::uint32_t append_span(std::string_view s) {
+        if (bytes_.size() + s.size() > std::numeric_limits<offset_type>::max()) {
+            throw std::length_error("DenseStringColumn: arena exceeds 32-bit offsets");
+        }
+        // s may point into the arena itself, so copy it out before growing
+        if (!bytes_.empty() && std::less_equal<const char*>{}(bytes_.data(), s.data()) &&
+            std::less<const char*>{}(s.data(), bytes_.data() + bytes_.size())) {
+            const std::string copy(s);
+            return append_span(copy);
+        }
+        bytes_.insert(bytes_.end(), s.begin(), s.end());
+        offsets_.push_back(static_cast<offset_type>(bytes_.size()));
+        return static_cast<std::uint32_t>(offsets_.size() - 2);
+    }
+
+    [[nodiscard]] std::size_t slot_of(std::string_view s) const noexcept {
+        return std::hash<std::string_view>{}(s) & (slots_.size() - 1);
+    }
+
+    void grow_slots() {
+        std::vector<std::uint32_t> slots(std::max<std::size_t>(16, slots_.size() * 2), empty_slot);
+        slots_.swap(slots);
+        const auto mask = slots_.size() - 1;
+        for (std::uint32_t code = 0; code + 1 < offsets_.size(); ++code) {
+            auto h = slot_of(span(code));
+            while (slots_[h] != empty_slot) h = (h + 1) & mask;
+            slots_[h] = code;
+        }
+    }
+
+    std::uint32_t intern(std::string_view s) {
+        if (2 * offsets_.size() > slots_.size()) grow_slots();
+        const auto mask = slots_.size() - 1;
+        for (auto h = slot_of(s);; h = (h + 1) & mask) {
+            if (slots_[h] == empty_slot) {
+                slots_[h] = append_span(s);
+                return slots_[h];
+            }
+            if (span(slots_[h]) == s) return slots_[h];
+        }
+    }
+
+    [[nodiscard]] std::optional<std::uint32_t> lookup(std::string_view s) const noexcept {
+        if (slots_.empty()) return std::nullopt;
+        const auto mask = slots_.size() - 1;
+        for (auto h = slot_of(s); slots_[h] != empty_slot; h = (h + 1) & mask) {
+            if (span(slots_[h]) == s) return slots_[h];
+        }
+        return std::nullopt;
+    }
+
+public:
+    // Constructors
+    DenseStringColumn() = default;
+
+    explicit DenseStringColumn(StringEncoding encoding) : encoding_(encoding) {}
+
+    DenseStringColumn(std::initializer_list<std::string_view> init,
+                      StringEncoding encoding = StringEncoding::plain)
+        : encoding_(encoding) {
+        for (auto s : init) {
+            [[maybe_unused]] auto _ = push_back(s);
+        }
+    }
+
+    // Element access
+    [[nodiscard]] std::string_view operator[](index_type idx) const noexcept {
+        return row(get_index_value(idx));
+    }
+
+    std::string_view operator[](size_type) const = delete;
+
+    [[nodiscard]] std::string_view at(index_type idx) const {
+        if (get_index_value(idx) >= size()) {
+            throw std::out_of_range("DenseStringColumn::at");
+        }
+        return row(get_index_value(idx));
+    }
+
+    std::string_view at(size_type) const = delete;
+
+    // Iterators
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, size()); }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept {
+        return is_dictionary() ? codes_.size() : offsets_.size() - 1;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] StringEncoding encoding() const noexcept { return encoding_; }
+
+    // Bytes held by the arena, offsets, codes and dictionary table
+    [[nodiscard]] size_type memory_usage() const noexcept {
+        return bytes_.capacity() + offsets_.capacity() * sizeof(offset_type) +
+               codes_.capacity() * sizeof(std::uint32_t) + slots_.capacity() * sizeof(std::uint32_t);
+    }
+
+    void reserve(size_type rows, size_type bytes) {
+        bytes_.reserve(bytes);
+        if (is_dictionary()) {
+            codes_.reserve(rows);
+        } else {
+            offsets_.reserve(rows + 1);
+        }
+    }
+
+    // Modifiers
+    void clear() noexcept {
+        bytes_.clear();
+        offsets_.assign(1, 0);
+        codes_.clear();
+        slots_.clear();
+    }
+
+    [[nodiscard]] index_type push_back(std::string_view s) {
+        const auto idx = detail::checked_index<index_type>(size());
+        if (is_dictionary()) {
+            codes_.push_back(intern(s));
+        } else {
+            append_span(s);
+        }
+        return idx;
+    }
+
+    // Dictionary access (dictionary encoding only)
+    [[nodiscard]] size_type dictionary_size() const noexcept {
+        return is_dictionary() ? offsets_.size() - 1 : 0;
+    }
+
+    [[nodiscard]] DictIndex code(index_type idx) const noexcept {
+        assert(is_dictionary() && "DenseStringColumn::code needs a dictionary-encoded column");
+        return DictIndex(codes_[get_index_value(idx)]);
+    }
+
+    [[nodiscard]] std::string_view dictionary_value(DictIndex code) const noexcept {
+        return span(code.value());
+    }
+
+    [[nodiscard]] std::optional<DictIndex> find_code(std::string_view s) const noexcept {
+        if (auto code = lookup(s)) return DictIndex(*code);
+        return std::nullopt;
+    }
+
+    // Column scans: invoke f(index_type) for every matching row, in order
+    template<typename F>
+    void for_each_equal(std::string_view needle, F&& f) const {
+        auto emit = [&](std::size_t i) { f(index_type(i)); };
+        if (is_dictionary()) {
+            if (auto code = lookup(needle)) {
+                detail::for_each_equal_u32(codes_.data(), codes_.size(), *code, emit);
+            }
+            return;
+        }
+        if (needle.size() > std::numeric_limits<offset_type>::max()) return;
+        // Filter on length with SIMD, then compare bytes of the candidates only
+        detail::for_each_span_length<false>(offsets_.data(), size(), static_cast<offset_type>(needle.size()),
+            [&](std::size_t i) {
+                if (needle.empty() || std::memcmp(bytes_.data() + offsets_[i], needle.data(), needle.size()) == 0) {
+                    emit(i);
+                }
+            });
+    }
+
+    template<typename F>
+    void for_each_prefix(std::string_view prefix, F&& f) const {
+        auto emit = [&](std::size_t i) { f(index_type(i)); };
+        if (is_dictionary()) {
+            std::vector<std::uint8_t> hit(dictionary_size());
+            bool any = false;
+            for (std::size_t c = 0; c < hit.size(); ++c) {
+                hit[c] = span(c).starts_with(prefix);
+                any = any || hit[c];
+            }
+            if (!any) return;
+            for (std::size_t i = 0; i < codes_.size(); ++i) {
+                if (hit[codes_[i]]) emit(i);
+            }
+            return;
+        }
+        if (prefix.size() > std::numeric_limits<offset_type>::max()) return;
+        detail::for_each_span_length<true>(offsets_.data(), size(), static_cast<offset_type>(prefix.size()),
+            [&](std::size_t i) {
+                if (prefix.empty() || std::memcmp(bytes_.data() + offsets_[i], prefix.data(), prefix.size()) == 0) {
+                    emit(i);
+                }
+            });
+    }
+
+    [[nodiscard]] std::vector<index_type> find_equal(std::string_view needle) const {
+        std::vector<index_type> result;
+        for_each_equal(needle, [&](index_type idx) { result.push_back(idx); });
+        return result;
+    }
+
+    [[nodiscard]] std::vector<index_type> find_prefix(std::string_view prefix) const {
+        std::vector<index_type> result;
+        for_each_prefix(prefix, [&](index_type idx) { result.push_back(idx); });
+        return result;
+    }
+
+    [[nodiscard]] size_type count_equal(std::string_view needle) const {
+        size_type count = 0;
+        for_each_equal(needle, [&](index_type) { ++count; });
+        return count;
+    }
+};
+
+// Non-owning view over contiguous elements, indexed by a strong index type
+template<typename T, StrongIndexType IndexType>
+class DenseSpan {
+public:
+    using index_type = IndexType;
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+private:
+    T* data_ = nullptr;
+    size_type size_ = 0;
+
+public:
+    // Constructors
+    constexpr DenseSpan() noexcept = default;
+    constexpr DenseSpan(T* data, size_type size) noexcept : data_(data), size_(size) {}
+    constexpr explicit DenseSpan(std::span<T> s) noexcept : data_(s.data()), size_(s.size()) {}
+
+    // Mutable to const conversion
+    template<typename U>
+        requires std::is_convertible_v<U (*)[], T (*)[]>
+    constexpr DenseSpan(const DenseSpan<U, IndexType>& other) noexcept
+        : data_(other.data()), size_(other.size()) {}
+
+    // Element access
+    [[nodiscard]] constexpr reference operator[](index_type idx) const noexcept {
+        return data_[get_index_value(idx)];
+    }
+
+    reference operator[](size_type) const = delete;
+
+    [[nodiscard]] constexpr reference at(index_type idx) const {
+        if (get_index_value(idx) >= size_) {
+            throw std::out_of_range("DenseSpan::at");
+        }
+        return data_[get_index_value(idx)];
+    }
+
+    reference at(size_type) const = delete;
+
+    [[nodiscard]] constexpr reference front() const noexcept { return data_[0]; }
+    [[nodiscard]] constexpr reference back() const noexcept { return data_[size_ - 1]; }
+    [[nodiscard]] constexpr T* data() const noexcept { return data_; }
+
+    // Iterators
+    [[nodiscard]] constexpr iterator begin() const noexcept { return data_; }
+    [[nodiscard]] constexpr iterator end() const noexcept { return data_ + size_; }
+    [[nodiscard]] constexpr const_iterator cbegin() const noexcept { return data_; }
+    [[nodiscard]] constexpr const_iterator cend() const noexcept { return data_ + size_; }
+
+    // Capacity
+    [[nodiscard]] constexpr size_type size() const noexcept { return size_; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+
+    // Subviews
+    [[nodiscard]] constexpr DenseSpan subspan(index_type first, size_type count) const noexcept {
+        return DenseSpan(data_ + get_index_value(first), count);
+    }
+
+    [[nodiscard]] constexpr std::span<T> span() const noexcept { return std::span<T>(data_, size_); }
+
+    // Utility functions
+    [[nodiscard]] constexpr index_type index_of(const_iterator it) const noexcept {
+        return index_type(static_cast<size_type>(it - data_));
+    }
+};
+
+// Rows of variable length packed into one contiguous buffer with an offsets array.
+// Rows are addressed by OuterIndex and elements within a row by InnerIndex.
+template<typename T, StrongIndexType OuterIndex, StrongIndexType InnerIndex>
+class DenseJaggedArray {
+public:
+    using outer_index_type = OuterIndex;
+    using inner_index_type = InnerIndex;
+    using value_type = T;
+    using size_type = std::size_t;
+    using row_type = DenseSpan<T, InnerIndex>;
+    using const_row_type = DenseSpan<const T, InnerIndex>;
+
+private:
+    std::vector<T> values_;
+    std::vector<size_type> offsets_{0};
+
+    // True when r views elements of this array, which growing or rebuilding would invalidate
+    template<typename R>
+    [[nodiscard]] bool aliases(R& r) const noexcept {
+        if constexpr (std::ranges::contiguous_range<R> &&
+                      std::is_same_v<std::remove_cv_t<std::ranges::range_value_t<R>>, T>) {
+            const T* p = std::ranges::data(r);
+            return !values_.empty() && std::less_equal<const T*>{}(values_.data(), p) &&
+                   std::less<const T*>{}(p, values_.data() + values_.size());
+        } else {
+            return false;
+        }
+    }
+
+    template<bool Const>
+    class row_iterator {
+        using owner = std::conditional_t<Const, const DenseJaggedArray, DenseJaggedArray>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::conditional_t<Const, const_row_type, row_type>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        constexpr row_iterator() noexcept = default;
+        constexpr row_iterator(owner* array, size_type row) noexcept : array_(array), row_(row) {}
+
+        [[nodiscard]] value_type operator*() const { return (*array_)[OuterIndex(row_)]; }
+
+        constexpr row_iterator& operator++() noexcept {
+            ++row_;
+            return *this;
+        }
+
+        constexpr row_iterator operator++(int) noexcept {
+            row_iterator tmp(*this);
+            ++row_;
+            return tmp;
+        }
+
+        [[nodiscard]] constexpr bool operator==(const row_iterator& other) const noexcept {
+            return row_ == other.row_;
+        }
+
+    private:
+        owner* array_ = nullptr;
+        size_type row_ = 0;
+    };
+
+public:
+    using iterator = row_iterator<false>;
+    using const_iterator = row_iterator<true>;
+
+    // Constructors
+    DenseJaggedArray() = default;
+
+    DenseJaggedArray(std::initializer_list<std::initializer_list<T>> rows) {
+        for (const auto& row : rows) {
+            [[maybe_unused]] auto _ = push_row(row);
+        }
+    }
+
+    // Row access
+    [[nodiscard]] row_type operator[](OuterIndex row) noexcept {
+        const auto r = get_index_value(row);
+        return row_type(values_.data() + offsets_[r], offsets_[r + 1] - offsets_[r]);
+    }
+
+    [[nodiscard]] const_row_type operator[](OuterIndex row) const noexcept {
+        const auto r = get_index_value(row);
+        return const_row_type(values_.data() + offsets_[r], offsets_[r + 1] - offsets_[r]);
+    }
+
+    row_type operator[](size_type) = delete;
+    const_row_type operator[](size_type) const = delete;
+
+    [[nodiscard]] row_type at(OuterIndex row) {
+        if (get_index_value(row) >= size()) {
+            throw std::out_of_range("DenseJaggedArray::at");
+        }
+        return (*this)[row];
+    }
+
+    [[nodiscard]] const_row_type at(OuterIndex row) const {
+        if (get_index_value(row) >= size()) {
+            throw std::out_of_range("DenseJaggedArray::at");
+        }
+        return (*this)[row];
+    }
+
+    // All elements of all rows, in row order
+    [[nodiscard]] std::span<T> values() noexcept { return values_; }
+    [[nodiscard]] std::span<const T> values() const noexcept { return values_; }
+
+    // Iterators over rows
+    [[nodiscard]] iterator begin() noexcept { return iterator(this, 0); }
+    [[nodiscard]] iterator end() noexcept { return iterator(this, size()); }
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, size()); }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return offsets_.size() - 1; }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] size_type total_size() const noexcept { return values_.size(); }
+
+    [[nodiscard]] size_type row_size(OuterIndex row) const noexcept {
+        const auto r = get_index_value(row);
+        return offsets_[r + 1] - offsets_[r];
+    }
+
+    void reserve(size_type rows, size_type values) {
+        offsets_.reserve(rows + 1);
+        values_.reserve(values);
+    }
+
+    void shrink_to_fit() {
+        offsets_.shrink_to_fit();
+        values_.shrink_to_fit();
+    }
+
+    // Append-only growth
+    void clear() noexcept {
+        values_.clear();
+        offsets_.assign(1, 0);
+    }
+
+    template<std::ranges::input_range R>
+        requires std::convertible_to<std::ranges::range_reference_t<R>, T>
+    [[nodiscard]] OuterIndex push_row(R&& row) {
+        // row may be a row of this array, so copy it out before growing
+        if (aliases(row)) {
+            std::vector<T> copy(std::ranges::begin(row), std::ranges::end(row));
+            return push_row(copy);
+        }
+        const auto idx = detail::checked_index<OuterIndex>(size());
+        for (auto&& value : row) {
+            values_.push_back(std::forward<decltype(value)>(value));
+        }
+        // The row's length is only known once it is read; drop it if InnerIndex cannot address it
+        try {
+            detail::check_index_domain<InnerIndex>(values_.size() - offsets_.back());
+        } catch (...) {
+            values_.resize(offsets_.back());
+            throw;
+        }
+        offsets_.push_back(values_.size());
+        return idx;
+    }
+
+    [[nodiscard]] OuterIndex push_row(std::initializer_list<T> row) {
+        const auto idx = detail::checked_index<OuterIndex>(size());
+        detail::check_index_domain<InnerIndex>(row.size());
+        values_.insert(values_.end(), row.begin(), row.end());
+        offsets_.push_back(values_.size());
+        return idx;
+    }
+
+    [[nodiscard]] OuterIndex emplace_row(size_type count, const T& value = T{}) {
+        const auto idx = detail::checked_index<OuterIndex>(size());
+        detail::check_index_domain<InnerIndex>(count);
+        values_.insert(values_.end(), count, value);
+        offsets_.push_back(values_.size());
+        return idx;
+    }
+
+    // Append to the last row, which is the only row that can grow in place
+    [[nodiscard]] InnerIndex push_back_to_last(const T& value) {
+        if (empty()) throw std::out_of_range("DenseJaggedArray::push_back_to_last");
+        const auto idx = detail::checked_index<InnerIndex>(offsets_.back() - offsets_[offsets_.size() - 2]);
+        values_.push_back(value);
+        ++offsets_.back();
+        return idx;
+    }
+
+    [[nodiscard]] InnerIndex push_back_to_last(T&& value) {
+        if (empty()) throw std::out_of_range("DenseJaggedArray::push_back_to_last");
+        const auto idx = detail::checked_index<InnerIndex>(offsets_.back() - offsets_[offsets_.size() - 2]);
+        values_.push_back(std::move(value));
+        ++offsets_.back();
+        return idx;
+    }
+
+    void pop_row() {
+        if (empty()) throw std::out_of_range("DenseJaggedArray::pop_row");
+        offsets_.pop_back();
+        values_.resize(offsets_.back());
+    }
+
+    // Edits that change row lengths go through a compacting rebuild:
+    // edit(OuterIndex, std::vector<T>&) may modify, grow or shrink each row.
+    template<typename F>
+        requires std::invocable<F&, OuterIndex, std::vector<T>&>
+    void rebuild(F&& edit) {
+        std::vector<T> values;
+        std::vector<size_type> offsets;
+        values.reserve(values_.size());
+        offsets.reserve(offsets_.size());
+        offsets.push_back(0);
+        std::vector<T> row;
+        for (size_type r = 0; r < size(); ++r) {
+            row.assign(std::make_move_iterator(values_.begin() + static_cast<std::ptrdiff_t>(offsets_[r])),
+                       std::make_move_iterator(values_.begin() + static_cast<std::ptrdiff_t>(offsets_[r + 1])));
+            edit(OuterIndex(r), row);
+            values.insert(values.end(), std::make_move_iterator(row.begin()), std::make_move_iterator(row.end()));
+            offsets.push_back(values.size());
+        }
+        values_.swap(values);
+        offsets_.swap(offsets);
+    }
+
+    // Replace one row; in place when the length is unchanged, otherwise via rebuild()
+    template<std::ranges::forward_range R>
+        requires std::convertible_to<std::ranges::range_reference_t<R>, T>
+    void set_row(OuterIndex row, R&& values) {
+        const auto count = static_cast<size_type>(std::ranges::distance(values));
+        if (count == row_size(row)) {
+            std::ranges::copy(values, (*this)[row].begin());
+            return;
+        }
+        // rebuild() moves every element out, so take a copy of a source inside this array
+        if (aliases(values)) {
+            std::vector<T> copy(std::ranges::begin(values), std::ranges::end(values));
+            set_row(row, copy);
+            return;
+        }
+        rebuild([&](OuterIndex r, std::vector<T>& elements) {
+            if (get_index_value(r) == get_index_value(row)) {
+                elements.assign(std::ranges::begin(values), std::ranges::end(values));
+            }
+        });
+    }
+
+    void set_row(OuterIndex row, std::initializer_list<T> values) {
+        set_row<std::initializer_list<T>>(row, std::move(values));
+    }
+};
+
+// Half-open range [first, last) of indices from one index domain
+template<StrongIndexType IndexType>
+class IndexRange {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IndexType;
+        using difference_type = std::ptrdiff_t;
+        using reference = IndexType;
+
+        constexpr iterator() noexcept = default;
+        constexpr explicit iterator(size_type pos) noexcept : pos_(pos) {}
+
+        [[nodiscard]] constexpr IndexType operator*() const { return IndexType(pos_); }
+
+        constexpr iterator& operator++() noexcept {
+            ++pos_;
+            return *this;
+        }
+
+        constexpr iterator operator++(int) noexcept {
+            iterator tmp(*this);
+            ++pos_;
+            return tmp;
+        }
+
+        [[nodiscard]] constexpr bool operator==(const iterator&) const noexcept = default;
+
+    private:
+        size_type pos_ = 0;
+    };
+    using const_iterator = iterator;
+
+private:
+    size_type first_ = 0;
+    size_type last_ = 0;
+
+public:
+    // Constructors
+    constexpr IndexRange() noexcept = default;
+    constexpr IndexRange(IndexType first, IndexType last) noexcept
+        : first_(get_index_value(first)), last_(get_index_value(last)) {}
+
+    // Bounds
+    [[nodiscard]] constexpr IndexType first() const { return IndexType(first_); }
+    [[nodiscard]] constexpr IndexType last() const { return IndexType(last_); }
+    [[nodiscard]] constexpr size_type size() const noexcept { return last_ - first_; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return first_ == last_; }
+
+    [[nodiscard]] constexpr bool contains(IndexType idx) const noexcept {
+        return get_index_value(idx) >= first_ && get_index_value(idx) < last_;
+    }
+
+    // Iterators
+    [[nodiscard]] constexpr iterator begin() const noexcept { return iterator(first_); }
+    [[nodiscard]] constexpr iterator end() const noexcept { return iterator(last_); }
+
+    // Splitting
+    [[nodiscard]] constexpr bool is_divisible(size_type grain) const noexcept { return size() > grain; }
+
+    [[nodiscard]] constexpr std::pair<IndexRange, IndexRange> split() const {
+        const auto mid = first_ + size() / 2;
+        return {IndexRange(IndexType(first_), IndexType(mid)), IndexRange(IndexType(mid), IndexType(last_))};
+    }
+
+    [[nodiscard]] constexpr bool operator==(const IndexRange&) const noexcept = default;
+};
+
+// Every index of a container, as a range
+template<typename C>
+    requires requires { typename C::index_type; }
+[[nodiscard]] constexpr IndexRange<typename C::index_type> indices(const C& c) {
+    using Index = typename C::index_type;
+    return IndexRange<Index>(Index(0), Index(c.size()));
+}
+
+// Thread pool configuration
+struct SchedulerOptions {
+    std::size_t threads = 0;   // 0 selects std::thread::hardware_concurrency()
+    bool pin_threads = false;  // Pin worker i to CPU i (Linux only)
+};
+
+// Per-call parallel_for configuration
+struct ParallelForOptions {
+    std::size_t grain = 0;                // Ranges at most this long run serially; 0 picks automatically
+    std::optional<std::size_t> affinity;  // Worker that receives the initial range
+};
+
+// Counters accumulated by each worker since construction or reset_stats()
+struct WorkerStats {
+    std::uint64_t tasks = 0;
+    std::uint64_t steals = 0;
+    std::chrono::nanoseconds idle{0};
+};
+
+namespace detail {
+
+// Identifies the scheduler and worker slot of the current thread
+struct SchedulerThreadContext {
+    const void* scheduler = nullptr;
+    std::size_t worker = 0;
+};
+
+inline thread_local SchedulerThreadContext scheduler_context{};
+
+} // namespace detail
+
+// Work-stealing thread pool whose unit of work is an index range. Ranges are
+// split in half until they reach the grain size; each worker keeps the halves
+// in its own deque and idle workers steal the oldest (largest) pending range.
+class WorkStealingScheduler {
+    struct Job {
+        using run_fn = void (*)(void* body, std::size_t first, std::size_t last);
+
+        run_fn run;
+        void* body;
+        std::size_t grain = 1;
+        std::atomic<std::size_t> pending{1};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+
+        Job(run_fn r, void* b) noexcept : run(r), body(b) {}
+    };
+
+    struct Task {
+        Job* job;
+        std::size_t first;
+        std::size_t last;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;  // owner works at the back, thieves take the front
+        std::atomic<std::uint64_t> tasks_run{0};
+        std::atomic<std::uint64_t> steals{0};
+        std::atomic<std::int64_t> idle_ns{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> sleepers_{0};
+    std::atomic<std::size_t> next_victim_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+
+    void push(std::size_t worker, Task task) {
+        {
+            std::lock_guard lock(workers_[worker]->mutex);
+            workers_[worker]->tasks.push_back(task);
+        }
+        queued_.fetch_add(1);
+        if (sleepers_.load() > 0) {
+            { std::lock_guard lock(sleep_mutex_); }
+            sleep_cv_.notify_one();
+        }
+    }
+
+    std::optional<Task> pop_local(std::size_t worker) {
+        auto& w = *workers_[worker];
+        std::lock_guard lock(w.mutex);
+        if (w.tasks.empty()) return std::nullopt;
+        Task task = w.tasks.back();
+        w.tasks.pop_back();
+        queued_.fetch_sub(1);
+        return task;
+    }
+
+    std::optional<Task> steal(std::size_t thief) {
+        const auto n = workers_.size();
+        const auto start = next_victim_.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t k = 0; k < n; ++k) {
+            const auto victim = (start + k) % n;
+            if (victim == thief) continue;
+            auto& w = *workers_[victim];
+            std::unique_lock lock(w.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || w.tasks.empty()) continue;
+            Task task = w.tasks.front();
+            w.tasks.pop_front();
+            queued_.fetch_sub(1);
+            workers_[thief]->steals.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+        return std::nullopt;
+    }
+
+    void execute(Task task, std::size_t worker) {
+        Job* job = task.job;
+        while (task.last - task.first > job->grain) {
+            const auto mid = task.first + (task.last - task.first) / 2;
+            job->pending.fetch_add(1);
+            push(worker, Task{job, mid, task.last});
+            task.last = mid;
+        }
+        if (!job->failed.load(std::memory_order_relaxed)) {
+            try {
+                job->run(job->body, task.first, task.last);
+            } catch (...) {
+                if (!job->failed.exchange(true)) job->error = std::current_exception();
+            }
+        }
+        workers_[worker]->tasks_run.fetch_add(1, std::memory_order_relaxed);
+        // The job may be destroyed by its waiter as soon as pending reaches zero
+        if (job->pending.fetch_sub(1) == 1) {
+            std::lock_guard lock(done_mutex_);
+            done_cv_.notify_all();
+        }
+    }
+
+    void worker_loop(std::size_t self) {
+        detail::scheduler_context = detail::SchedulerThreadContext{this, self};
+        while (!stop_.load()) {
+            if (auto task = pop_local(self)) {
+                execute(*task, self);
+                continue;
+            }
+            if (auto task = steal(self)) {
+                execute(*task, self);
+                continue;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            {
+                std::unique_lock lock(sleep_mutex_);
+                sleepers_.fetch_add(1);
+                sleep_cv_.wait(lock, [&] { return stop_.load() || queued_.load() > 0; });
+                sleepers_.fetch_sub(1);
+            }
+            const auto idle = std::chrono::steady_clock::now() - start;
+            workers_[self]->idle_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(idle).count(), std::memory_order_relaxed);
+        }
+    }
+
+    void pin(std::size_t worker) {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(threads_[worker].native_handle(), sizeof(cpus), &cpus);
+#else
+        (void)worker;
+#endif
+    }
+
+    template<typename F>
+    static void* erase(F& f) noexcept {
+        return const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+    }
+
+    template<typename IndexType, typename F>
+    static void run_each(void* body, std::size_t first, std::size_t last) {
+        auto& f = *static_cast<F*>(body);
+        for (auto i = first; i < last; ++i) {
+            std::invoke(f, IndexType(i));
+        }
+    }
+
+    template<typename IndexType, typename F>
+    static void run_chunk(void* body, std::size_t first, std::size_t last) {
+        std::invoke(*static_cast<F*>(body), IndexRange<IndexType>(IndexType(first), IndexType(last)));
+    }
+
+    void run(Job& job, std::size_t first, std::size_t last, const ParallelForOptions& options) {
+        if (first == last) return;
+        job.grain = options.grain != 0 ? options.grain
+                                       : std::max<std::size_t>(1, (last - first) / (8 * worker_count()));
+        if (auto self = current_worker()) {
+            // Nested call from a worker: seed our own deque and help until done
+            push(*self, Task{&job, first, last});
+            while (job.pending.load() != 0) {
+                if (auto task = pop_local(*self)) {
+                    execute(*task, *self);
+                } else if (auto stolen = steal(*self)) {
+                    execute(*stolen, *self);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        } else {
+            const auto target = options.affinity.value_or(
+                next_victim_.fetch_add(1, std::memory_order_relaxed)) % worker_count();
+            push(target, Task{&job, first, last});
+            std::unique_lock lock(done_mutex_);
+            done_cv_.wait(lock, [&] { return job.pending.load() == 0; });
+        }
+        if (job.error) std::rethrow_exception(job.error);
+    }
+
+public:
+    explicit WorkStealingScheduler(SchedulerOptions options = {}) {
+        auto count = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+        count = std::max<std::size_t>(1, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            threads_.emplace_back([this, i] { worker_loop(i); });
+            if (options.pin_threads) pin(i);
+        }
+    }
+
+    WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+    ~WorkStealingScheduler() {
+        {
+            std::lock_guard lock(sleep_mutex_);
+            stop_.store(true);
+        }
+        sleep_cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]] std::size_t worker_count() const noexcept { return workers_.size(); }
+
+    // Index of the calling thread if it is one of this scheduler's workers
+    [[nodiscard]] std::optional<std::size_t> current_worker() const noexcept {
+        if (detail::scheduler_context.scheduler == this) return detail::scheduler_context.worker;
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::vector<WorkerStats> stats() const {
+        std::vector<WorkerStats> result;
+        result.reserve(workers_.size());
+        for (const auto& w : workers_) {
+            result.push_back(WorkerStats{w->tasks_run.load(), w->steals.load(),
+                                         std::chrono::nanoseconds(w->idle_ns.load())});
+        }
+        return result;
+    }
+
+    void reset_stats() noexcept {
+        for (auto& w : workers_) {
+            w->tasks_run.store(0);
+            w->steals.store(0);
+            w->idle_ns.store(0);
+        }
+    }
+
+    // Invoke f(IndexType) for every index in range; blocks until all calls return.
+    // The first exception thrown by f is rethrown here.
+    template<StrongIndexType IndexType, typename F>
+        requires std::invocable<F&, IndexType>
+    void parallel_for(IndexRange<IndexType> range, F&& f, ParallelForOptions options = {}) {
+        Job job{&run_each<IndexType, std::remove_reference_t<F>>, erase(f)};
+        run(job, get_index_value(range.first()), get_index_value(range.last()), options);
+    }
+
+    // Invoke f(IndexRange<IndexType>) on disjoint chunks covering range
+    template<StrongIndexType IndexType, typename F>
+        requires std::invocable<F&, IndexRange<IndexType>>
+    void parallel_for_chunks(IndexRange<IndexType> range, F&& f, ParallelForOptions options = {}) {
+        Job job{&run_chunk<IndexType, std::remove_reference_t<F>>, erase(f)};
+        run(job, get_index_value(range.first()), get_index_value(range.last()), options);
+    }
+};
+
+// Process-wide scheduler used by the parallel algorithms in this library
+[[nodiscard]] inline WorkStealingScheduler& default_scheduler() {
+    static WorkStealingScheduler scheduler;
+    return scheduler;
+}
+
+template<StrongIndexType IndexType, typename F>
+    requires std::invocable<F&, IndexType>
+void parallel_for(IndexRange<IndexType> range, F&& f, ParallelForOptions options = {}) {
+    default_scheduler().parallel_for(range, std::forward<F>(f), options);
+}
+
+template<StrongIndexType IndexType, typename F>
+    requires std::invocable<F&, IndexRange<IndexType>>
+void parallel_for_chunks(IndexRange<IndexType> range, F&& f, ParallelForOptions options = {}) {
+    default_scheduler().parallel_for_chunks(range, std::forward<F>(f), options);
+}
+
+namespace detail {
+
+// Internal index domain for fixed-size work chunks
+struct ChunkTag {};
+using ChunkIndex = StrongIndex<ChunkTag>;
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+// Permutation tables for AVX2 compress: nibble k of entry m is the source lane
+// of output lane k when the lanes selected by mask m are packed to the front
+inline constexpr auto compress_lut_8x32 = [] {
+    std::array<std::uint32_t, 256> lut{};
+    for (std::uint32_t m = 0; m < 256; ++m) {
+        std::uint32_t k = 0;
+        for (std::uint32_t lane = 0; lane < 8; ++lane) {
+            if (m & (1u << lane)) lut[m] |= lane << (4 * k++);
+        }
+    }
+    return lut;
+}();
+
+inline constexpr auto compress_lut_4x64 = [] {
+    std::array<std::uint32_t, 16> lut{};
+    for (std::uint32_t m = 0; m < 16; ++m) {
+        std::uint32_t k = 0;
+        for (std::uint32_t lane = 0; lane < 4; ++lane) {
+            if (m & (1u << lane)) {
+                lut[m] |= (2 * lane) << (4 * k++);
+                lut[m] |= (2 * lane + 1) << (4 * k++);
+            }
+        }
+    }
+    return lut;
+}();
+
+inline __m256i expand_nibbles(std::uint32_t packed) noexcept {
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    return _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(packed)), shifts),
+                            _mm256_set1_epi32(0xF));
+}
+#endif
+
+// Pack the elements of src[0, 64) selected by mask to the front of dst.
+// Returns the number of elements written; nothing past them is touched.
+template<typename T>
+inline std::size_t compress_store_64(const T* src, std::uint64_t mask, T* dst) {
+    constexpr bool simd = std::is_trivially_copyable_v<T> && (sizeof(T) == 4 || sizeof(T) == 8);
+    [[maybe_unused]] T* const start = dst;
+    if constexpr (simd && sizeof(T) == 4) {
+#if defined(__AVX512F__)
+        for (int k = 0; k < 4; ++k) {
+            const auto m = static_cast<__mmask16>(mask >> (16 * k));
+            _mm512_mask_compressstoreu_epi32(dst, m, _mm512_loadu_si512(src + 16 * k));
+            dst += std::popcount(static_cast<std::uint16_t>(m));
+        }
+        return static_cast<std::size_t>(dst - start);
+#elif defined(__AVX2__)
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        for (int k = 0; k < 8; ++k) {
+            const auto m = static_cast<std::uint8_t>(mask >> (8 * k));
+            const int count = std::popcount(m);
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 8 * k));
+            const __m256i packed = _mm256_permutevar8x32_epi32(v, expand_nibbles(compress_lut_8x32[m]));
+            _mm256_maskstore_epi32(reinterpret_cast<int*>(dst), _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lanes),
+                                   packed);
+            dst += count;
+        }
+        return static_cast<std::size_t>(dst - start);
+#endif
+    } else if constexpr (simd && sizeof(T) == 8) {
+#if defined(__AVX512F__)
+        for (int k = 0; k < 8; ++k) {
+            const auto m = static_cast<__mmask8>(mask >> (8 * k));
+            _mm512_mask_compressstoreu_epi64(dst, m, _mm512_loadu_si512(src + 8 * k));
+            dst += std::popcount(static_cast<std::uint8_t>(m));
+        }
+        return static_cast<std::size_t>(dst - start);
+#elif defined(__AVX2__)
+        const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+        for (int k = 0; k < 16; ++k) {
+            const auto m = static_cast<std::uint32_t>((mask >> (4 * k)) & 0xF);
+            const int count = std::popcount(m);
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * k));
+            const __m256i packed = _mm256_permutevar8x32_epi32(v, expand_nibbles(compress_lut_4x64[m]));
+            _mm256_maskstore_epi64(reinterpret_cast<long long*>(dst),
+                                   _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), lanes), packed);
+            dst += count;
+        }
+        return static_cast<std::size_t>(dst - start);
+#endif
+    }
+    for_each_set_bit(mask, 0, [&](std::size_t j) { *dst++ = src[j]; });
+    return static_cast<std::size_t>(dst - start);
+}
+
+} // namespace detail
+
+// Output of parallel_filter: the surviving values renumbered densely in NewIndex,
+// and for each of them the index it had in the source container
+template<typename T, StrongIndexType NewIndex, StrongIndexType SourceIndex>
+struct FilterResult {
+    DenseVector<T, NewIndex> values;
+    DenseVector<SourceIndex, NewIndex> sources;
+};
+
+// Stable parallel filter over a contiguous dense container. Each chunk first
+// counts the elements satisfying pred into a bitmask, an exclusive prefix sum
+// over the chunk counts gives every chunk its output offset, and a second pass
+// scatters the survivors with a SIMD compress store.
+template<StrongIndexType NewIndex, typename Container, typename Pred>
+    requires requires(const Container& c) {
+        typename Container::index_type;
+        { c.data() } -> std::convertible_to<const typename Container::value_type*>;
+    } && std::predicate<Pred&, const typename Container::value_type&>
+[[nodiscard]] FilterResult<typename Container::value_type, NewIndex, typename Container::index_type>
+parallel_filter(const Container& container, Pred pred, WorkStealingScheduler& scheduler = default_scheduler()) {
+    using T = typename Container::value_type;
+    using SourceIndex = typename Container::index_type;
+    using detail::ChunkIndex;
+
+    const std::size_t n = container.size();
+    const T* src = container.data();
+    const std::size_t words = (n + 63) / 64;
+    const std::size_t words_per_chunk = std::max<std::size_t>(64, words / (4 * scheduler.worker_count()) + 1);
+    const std::size_t chunks = (words + words_per_chunk - 1) / words_per_chunk;
+    const IndexRange<ChunkIndex> all_chunks(ChunkIndex(0), ChunkIndex(chunks));
+    const ParallelForOptions one_chunk_per_task{.grain = 1, .affinity = std::nullopt};
+
+    // Pass 1: predicate bitmask and survivor count per chunk
+    std::vector<std::uint64_t> masks(words);
+    std::vector<std::size_t> offsets(chunks + 1, 0);
+    scheduler.parallel_for(all_chunks, [&](ChunkIndex chunk) {
+        const auto first_word = get_index_value(chunk) * words_per_chunk;
+        const auto last_word = std::min(words, first_word + words_per_chunk);
+        std::size_t count = 0;
+        for (auto w = first_word; w < last_word; ++w) {
+            const auto base = w * 64;
+            const auto width = std::min<std::size_t>(64, n - base);
+            std::uint64_t word = 0;
+            for (std::size_t j = 0; j < width; ++j) {
+                word |= static_cast<std::uint64_t>(static_cast<bool>(pred(src[base + j]))) << j;
+            }
+            masks[w] = word;
+            count += static_cast<std::size_t>(std::popcount(word));
+        }
+        offsets[get_index_value(chunk) + 1] = count;
+    }, one_chunk_per_task);
+
+    // Exclusive prefix sum gives each chunk its output offset
+    for (std::size_t c = 0; c < chunks; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+
+    // Pass 2: scatter survivors and their source indices
+    FilterResult<T, NewIndex, SourceIndex> result;
+    result.values.resize(offsets[chunks]);
+    result.sources.resize(offsets[chunks]);
+    T* values = result.values.data();
+    SourceIndex* sources = result.sources.data();
+    scheduler.parallel_for(all_chunks, [&](ChunkIndex chunk) {
+        const auto first_word = get_index_value(chunk) * words_per_chunk;
+        const auto last_word = std::min(words, first_word + words_per_chunk);
+        auto out = offsets[get_index_value(chunk)];
+        for (auto w = first_word; w < last_word; ++w) {
+            const auto base = w * 64;
+            if (base + 64 <= n) {
+                detail::compress_store_64(src + base, masks[w], values + out);
+            } else {
+                detail::for_each_set_bit(masks[w], 0, [&, dst = values + out](std::size_t j) mutable {
+                    *dst++ = src[base + j];
+                });
+            }
+            detail::for_each_set_bit(masks[w], base, [&](std::size_t i) { sources[out++] = SourceIndex(i); });
+        }
+    }, one_chunk_per_task);
+    return result;
+}
+
+// Key type produced by a key projection over the elements of Container
+template<typename Container, typename KeyFn>
+using projected_key_t =
+    std::remove_cvref_t<std::invoke_result_t<KeyFn&, std::ranges::range_reference_t<const Container&>>>;
+
+// Number of elements per key. key(element) must return a KeyIndex below key_domain_size.
+template<std::ranges::input_range Container, typename KeyFn>
+    requires StrongIndexType<projected_key_t<Container, KeyFn>>
+[[nodiscard]] DenseVector<std::uint32_t, projected_key_t<Container, KeyFn>>
+histogram(const Container& container, KeyFn key, std::size_t key_domain_size) {
+    DenseVector<std::uint32_t, projected_key_t<Container, KeyFn>> counts(key_domain_size, 0);
+    auto* count = counts.data();
+    for (const auto& element : container) {
+        ++count[get_index_value(std::invoke(key, element))];
+    }
+    return counts;
+}
+
+// Parallel histogram. Every worker counts into a private, lazily allocated
+// histogram so that no two threads write the same cache line; the private
+// histograms are then summed in parallel over disjoint key ranges.
+template<std::ranges::random_access_range Container, typename KeyFn>
+    requires StrongIndexType<projected_key_t<Container, KeyFn>>
+[[nodiscard]] DenseVector<std::uint32_t, projected_key_t<Container, KeyFn>>
+parallel_histogram(const Container& container, KeyFn key, std::size_t key_domain_size,
+                   WorkStealingScheduler& scheduler = default_scheduler()) {
+    using KeyIndex = projected_key_t<Container, KeyFn>;
+    using detail::ChunkIndex;
+
+    const auto first = std::ranges::begin(container);
+    const auto n = static_cast<std::size_t>(std::ranges::size(container));
+    std::vector<std::vector<std::uint32_t>> privates(scheduler.worker_count());
+    scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(n)),
+        [&](IndexRange<ChunkIndex> chunk) {
+            auto& local = privates[*scheduler.current_worker()];
+            if (local.empty()) local.assign(key_domain_size, 0);
+            for (auto i : chunk) {
+                ++local[get_index_value(std::invoke(key, first[static_cast<std::ptrdiff_t>(get_index_value(i))]))];
+            }
+        }, {.grain = std::max<std::size_t>(4096, n / (8 * scheduler.worker_count())), .affinity = std::nullopt});
+
+    // Merge step
+    DenseVector<std::uint32_t, KeyIndex> counts(key_domain_size, 0);
+    auto* count = counts.data();
+    scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(key_domain_size)),
+        [&](IndexRange<ChunkIndex> keys) {
+            for (const auto& local : privates) {
+                if (local.empty()) continue;
+                for (auto k = get_index_value(keys.first()); k < get_index_value(keys.last()); ++k) {
+                    count[k] += local[k];
+                }
+            }
+        }, {.grain = 4096, .affinity = std::nullopt});
+    return counts;
+}
+
+// Elements grouped by key: values holds the elements stable-sorted by key and
+// the elements with key k occupy positions [offsets[k], offsets[k + 1])
+template<typename T, StrongIndexType IndexType, StrongIndexType KeyIndex>
+struct SortedByKey {
+    DenseVector<T, IndexType> values;
+    DenseVector<std::size_t, KeyIndex> offsets;
+
+    [[nodiscard]] IndexRange<IndexType> bucket(KeyIndex key) const {
+        return IndexRange<IndexType>(IndexType(offsets[key]), IndexType(offsets[KeyIndex(get_index_value(key) + 1)]));
+    }
+
+    [[nodiscard]] std::size_t key_domain_size() const noexcept { return offsets.size() - 1; }
+};
+
+// Stable counting sort of a dense container by a projected key in O(n + domain)
+template<typename Container, typename KeyFn>
+    requires requires { typename Container::index_type; } && StrongIndexType<projected_key_t<Container, KeyFn>>
+[[nodiscard]] SortedByKey<typename Container::value_type, typename Container::index_type, projected_key_t<Container, KeyFn>>
+counting_sort_by_key(const Container& container, KeyFn key, std::size_t key_domain_size) {
+    using KeyIndex = projected_key_t<Container, KeyFn>;
+
+    const auto counts = histogram(container, key, key_domain_size);
+    SortedByKey<typename Container::value_type, typename Container::index_type, KeyIndex> result;
+    result.offsets.resize(key_domain_size + 1);
+    auto* offset = result.offsets.data();
+    offset[0] = 0;
+    for (std::size_t k = 0; k < key_domain_size; ++k) {
+        offset[k + 1] = offset[k] + counts.data()[k];
+    }
+
+    std::vector<std::size_t> cursor(offset, offset + key_domain_size);
+    std::vector<typename Container::value_type> sorted(container.size());
+    for (const auto& element : container) {
+        sorted[cursor[get_index_value(std::invoke(key, element))]++] = element;
+    }
+    result.values = DenseVector<typename Container::value_type, typename Container::index_type>(std::move(sorted));
+    return result;
+}
+
+// Element types usable with the atomic dense containers
+template<typename T>
+concept AtomicElement = std::is_trivially_copyable_v<T> && alignof(T) >= std::atomic_ref<T>::required_alignment;
+
+namespace detail {
+
+// Typed atomic operations shared by DenseAtomicView and DenseAtomicVector.
+// Derived provides element(index_type) returning a reference to the slot and
+// ShallowConst, which is true for views that write through a const handle.
+// Owners only expose the mutating operations on non-const objects.
+template<typename Derived, AtomicElement T, StrongIndexType IndexType>
+class AtomicAccess {
+    // Loads never write, and the slot itself is never a const object
+    [[nodiscard]] std::atomic_ref<T> load_ref(IndexType idx) const noexcept {
+        return std::atomic_ref<T>(const_cast<T&>(static_cast<const Derived&>(*this).element(idx)));
+    }
+
+    [[nodiscard]] std::atomic_ref<T> ref(IndexType idx) noexcept {
+        return std::atomic_ref<T>(static_cast<Derived&>(*this).element(idx));
+    }
+
+    // Shallow-const handles forward their const operations to the mutable ones
+    [[nodiscard]] AtomicAccess& writable() const noexcept { return const_cast<AtomicAccess&>(*this); }
+
+    // Read-modify-write through a compare-exchange loop
+    template<typename F>
+    T update(IndexType idx, F f, std::memory_order order) noexcept {
+        auto r = ref(idx);
+        T expected = r.load(std::memory_order_relaxed);
+        while (!r.compare_exchange_weak(expected, f(expected), order, std::memory_order_relaxed)) {}
+        return expected;
+    }
+
+public:
+    using index_type = IndexType;
+    using value_type = T;
+
+    [[nodiscard]] T load(IndexType idx, std::memory_order order = std::memory_order_seq_cst) const noexcept {
+        return load_ref(idx).load(order);
+    }
+
+    void store(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        ref(idx).store(value, order);
+    }
+
+    T exchange(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return ref(idx).exchange(value, order);
+    }
+
+    bool compare_exchange_weak(IndexType idx, T& expected, T desired,
+                               std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return ref(idx).compare_exchange_weak(expected, desired, order);
+    }
+
+    bool compare_exchange_strong(IndexType idx, T& expected, T desired,
+                                 std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return ref(idx).compare_exchange_strong(expected, desired, order);
+    }
+
+    T fetch_add(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> || std::floating_point<T>
+    {
+        return ref(idx).fetch_add(value, order);
+    }
+
+    T fetch_sub(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> || std::floating_point<T>
+    {
+        return ref(idx).fetch_sub(value, order);
+    }
+
+    T fetch_and(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T>
+    {
+        return ref(idx).fetch_and(value, order);
+    }
+
+    T fetch_or(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T>
+    {
+        return ref(idx).fetch_or(value, order);
+    }
+
+    T fetch_xor(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T>
+    {
+        return ref(idx).fetch_xor(value, order);
+    }
+
+    // Relaxed accumulation: a single fetch_add for integers, a CAS loop for floats
+    void add_relaxed(IndexType idx, T value) noexcept
+        requires std::integral<T> || std::floating_point<T>
+    {
+        if constexpr (std::integral<T>) {
+            ref(idx).fetch_add(value, std::memory_order_relaxed);
+        } else {
+            update(idx, [value](T current) { return current + value; }, std::memory_order_relaxed);
+        }
+    }
+
+    // Store min/max of the current and given value; returns the previous value
+    T fetch_min(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::totally_ordered<T>
+    {
+        auto r = ref(idx);
+        T expected = r.load(std::memory_order_relaxed);
+        while (value < expected && !r.compare_exchange_weak(expected, value, order, std::memory_order_relaxed)) {}
+        return expected;
+    }
+
+    T fetch_max(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::totally_ordered<T>
+    {
+        auto r = ref(idx);
+        T expected = r.load(std::memory_order_relaxed);
+        while (expected < value && !r.compare_exchange_weak(expected, value, order, std::memory_order_relaxed)) {}
+        return expected;
+    }
+
+    // Const overloads for shallow-const handles
+    void store(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const
+    {
+        writable().store(idx, value, order);
+    }
+
+    T exchange(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const
+    {
+        return writable().exchange(idx, value, order);
+    }
+
+    bool compare_exchange_weak(IndexType idx, T& expected, T desired,
+                               std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const
+    {
+        return writable().compare_exchange_weak(idx, expected, desired, order);
+    }
+
+    bool compare_exchange_strong(IndexType idx, T& expected, T desired,
+                                 std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const
+    {
+        return writable().compare_exchange_strong(idx, expected, desired, order);
+    }
+
+    T fetch_add(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && (std::integral<T> || std::floating_point<T>)
+    {
+        return writable().fetch_add(idx, value, order);
+    }
+
+    T fetch_sub(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && (std::integral<T> || std::floating_point<T>)
+    {
+        return writable().fetch_sub(idx, value, order);
+    }
+
+    T fetch_and(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && std::integral<T>
+    {
+        return writable().fetch_and(idx, value, order);
+    }
+
+    T fetch_or(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && std::integral<T>
+    {
+        return writable().fetch_or(idx, value, order);
+    }
+
+    T fetch_xor(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && std::integral<T>
+    {
+        return writable().fetch_xor(idx, value, order);
+    }
+
+    void add_relaxed(IndexType idx, T value) const noexcept
+        requires Derived::shallow_const && (std::integral<T> || std::floating_point<T>)
+    {
+        writable().add_relaxed(idx, value);
+    }
+
+    T fetch_min(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && std::totally_ordered<T>
+    {
+        return writable().fetch_min(idx, value, order);
+    }
+
+    T fetch_max(IndexType idx, T value, std::memory_order order = std::memory_order_seq_cst) const noexcept
+        requires Derived::shallow_const && std::totally_ordered<T>
+    {
+        return writable().fetch_max(idx, value, order);
+    }
+};
+
+} // namespace detail
+
+// Atomic, index-typed view over the elements of a contiguous dense container
+template<AtomicElement T, StrongIndexType IndexType>
+class DenseAtomicView : public detail::AtomicAccess<DenseAtomicView<T, IndexType>, T, IndexType> {
+    friend class detail::AtomicAccess<DenseAtomicView, T, IndexType>;
+
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    [[nodiscard]] T& element(IndexType idx) const noexcept { return data_[get_index_value(idx)]; }
+
+public:
+    // A view does not own its elements, so a const view still writes through them
+    static constexpr bool shallow_const = true;
+
+    constexpr DenseAtomicView() noexcept = default;
+    constexpr DenseAtomicView(T* data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+    template<IndexableContainer Container>
+        requires std::same_as<typename Container::value_type, T> && HasData<Container>
+    explicit DenseAtomicView(DenseIndexedContainer<Container, IndexType>& container) noexcept
+        : data_(container.data()), size_(container.size()) {}
+
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return size_; }
+};
+
+template<IndexableContainer Container, StrongIndexType IndexType>
+[[nodiscard]] DenseAtomicView<typename Container::value_type, IndexType>
+atomic_view(DenseIndexedContainer<Container, IndexType>& container) noexcept {
+    return DenseAtomicView<typename Container::value_type, IndexType>(container);
+}
+
+// Dense vector whose elements are only accessed atomically while shared
+template<AtomicElement T, StrongIndexType IndexType>
+class DenseAtomicVector : public detail::AtomicAccess<DenseAtomicVector<T, IndexType>, T, IndexType> {
+    friend class detail::AtomicAccess<DenseAtomicVector, T, IndexType>;
+
+    DenseVector<T, IndexType> values_;
+
+    [[nodiscard]] T& element(IndexType idx) noexcept { return values_[idx]; }
+    [[nodiscard]] const T& element(IndexType idx) const noexcept { return values_[idx]; }
+
+public:
+    static constexpr bool shallow_const = false;
+
+    DenseAtomicVector() = default;
+    explicit DenseAtomicVector(std::size_t count, T value = T{}) : values_(count, value) {}
+    explicit DenseAtomicVector(DenseVector<T, IndexType> values) noexcept : values_(std::move(values)) {}
+
+    [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return values_.empty(); }
+
+    [[nodiscard]] DenseAtomicView<T, IndexType> view() noexcept { return DenseAtomicView<T, IndexType>(values_); }
+
+    // Plain access, for use once no other thread touches the vector
+    [[nodiscard]] const DenseVector<T, IndexType>& values() const noexcept { return values_; }
+    [[nodiscard]] DenseVector<T, IndexType> release() && noexcept { return std::move(values_); }
+};
+
+// Per-thread accumulation into a DenseVector without shared writes. Every
+// scheduler worker owns a shard that starts as a small open-addressing hash map
+// and turns into a dense array once it has touched more than a fraction of the
+// key domain. merge() combines the shards with Op, which must be associative and
+// commutative, and identity must be its neutral element.
+template<typename T, StrongIndexType IndexType, typename Op = std::plus<T>>
+class DenseShardedAccumulator {
+    static constexpr std::size_t empty_key = ~std::size_t{0};
+
+    struct alignas(64) Shard {
+        std::vector<T> dense;            // domain-sized once promoted
+        std::vector<std::size_t> keys;   // sparse: open-addressing keys
+        std::vector<T> values;           // sparse: values parallel to keys
+        std::size_t used = 0;
+        std::mutex mutex;                // guards the shard shared by non-worker threads
+    };
+
+    std::size_t domain_size_;
+    T identity_;
+    Op op_;
+    std::size_t dense_threshold_;
+    WorkStealingScheduler* scheduler_;
+    std::vector<std::unique_ptr<Shard>> shards_;  // one per worker, plus one for other threads
+
+    void promote(Shard& shard) {
+        shard.dense.assign(domain_size_, identity_);
+        for (std::size_t s = 0; s < shard.keys.size(); ++s) {
+            if (shard.keys[s] != empty_key) shard.dense[shard.keys[s]] = std::move(shard.values[s]);
+        }
+        shard.keys = {};
+        shard.values = {};
+    }
+
+    void grow(Shard& shard) {
+        std::vector<std::size_t> keys(std::max<std::size_t>(16, shard.keys.size() * 2), empty_key);
+        std::vector<T> values(keys.size(), identity_);
+        shard.keys.swap(keys);
+        shard.values.swap(values);
+        shard.used = 0;
+        for (std::size_t s = 0; s < keys.size(); ++s) {
+            if (keys[s] != empty_key) *find_slot(shard, keys[s]) = std::move(values[s]);
+        }
+    }
+
+    // Value slot for key in a sparse shard, inserting identity if absent
+    T* find_slot(Shard& shard, std::size_t key) {
+        const auto mask = shard.keys.size() - 1;
+        for (auto h = (key * 0x9E3779B97F4A7C15ull) >> 7 & mask;; h = (h + 1) & mask) {
+            if (shard.keys[h] == key) return &shard.values[h];
+            if (shard.keys[h] == empty_key) {
+                shard.keys[h] = key;
+                ++shard.used;
+                return &shard.values[h];
+            }
+        }
+    }
+
+    void accumulate(Shard& shard, std::size_t key, const T& value) {
+        if (!shard.dense.empty()) {
+            shard.dense[key] = op_(std::move(shard.dense[key]), value);
+            return;
+        }
+        if (shard.used + 1 > dense_threshold_) {
+            promote(shard);
+            shard.dense[key] = op_(std::move(shard.dense[key]), value);
+            return;
+        }
+        if (2 * (shard.used + 1) > shard.keys.size()) grow(shard);
+        T* slot = find_slot(shard, key);
+        *slot = op_(std::move(*slot), value);
+    }
+
+public:
+    using index_type = IndexType;
+    using value_type = T;
+
+    explicit DenseShardedAccumulator(std::size_t domain_size, T identity = T{}, Op op = Op{},
+                                     WorkStealingScheduler& scheduler = default_scheduler())
+        : domain_size_(domain_size), identity_(std::move(identity)), op_(std::move(op)),
+          dense_threshold_(std::max<std::size_t>(16, domain_size / 16)), scheduler_(&scheduler) {
+        for (std::size_t i = 0; i <= scheduler.worker_count(); ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    [[nodiscard]] std::size_t domain_size() const noexcept { return domain_size_; }
+
+    // Accumulate into the calling thread's shard
+    void add(IndexType idx, const T& value) {
+        if (auto worker = scheduler_->current_worker()) {
+            accumulate(*shards_[*worker], get_index_value(idx), value);
+            return;
+        }
+        auto& shared = *shards_.back();
+        std::lock_guard lock(shared.mutex);
+        accumulate(shared, get_index_value(idx), value);
+    }
+
+    // Number of shards that switched to dense storage
+    [[nodiscard]] std::size_t dense_shards() const noexcept {
+        return static_cast<std::size_t>(
+            std::ranges::count_if(shards_, [](const auto& shard) { return !shard->dense.empty(); }));
+    }
+
+    // Combine all shards into one vector. Dense shards are merged in parallel
+    // over disjoint key ranges, sparse shards are applied afterwards.
+    [[nodiscard]] DenseVector<T, IndexType> merge() const {
+        DenseVector<T, IndexType> result(domain_size_, identity_);
+        T* out = result.data();
+        scheduler_->parallel_for_chunks(IndexRange<IndexType>(IndexType(0), IndexType(domain_size_)),
+            [&](IndexRange<IndexType> keys) {
+                for (const auto& shard : shards_) {
+                    if (shard->dense.empty()) continue;
+                    for (auto k = get_index_value(keys.first()); k < get_index_value(keys.last()); ++k) {
+                        out[k] = op_(std::move(out[k]), shard->dense[k]);
+                    }
+                }
+            }, {.grain = 4096, .affinity = std::nullopt});
+        for (const auto& shard : shards_) {
+            for (std::size_t s = 0; s < shard->keys.size(); ++s) {
+                if (shard->keys[s] != empty_key) out[shard->keys[s]] = op_(std::move(out[shard->keys[s]]), shard->values[s]);
+            }
+        }
+        return result;
+    }
+
+    // Drop all accumulated values and return every shard to sparse storage
+    void reset() {
+        for (auto& shard : shards_) {
+            shard->dense = {};
+            shard->keys = {};
+            shard->values = {};
+            shard->used = 0;
+        }
+    }
+};
+
+// Fixed-size set of indices from one domain, one bit per index
+template<StrongIndexType IndexType>
+class DenseBitset {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+    using word_type = std::uint64_t;
+
+    static constexpr size_type bits_per_word = 64;
+
+private:
+    std::vector<word_type> words_;
+    size_type size_ = 0;
+
+    [[nodiscard]] static constexpr size_type word_of(size_type i) noexcept { return i / bits_per_word; }
+    [[nodiscard]] static constexpr word_type bit_of(size_type i) noexcept { return word_type{1} << (i % bits_per_word); }
+
+    // Clear the unused high bits of the last word
+    void trim() noexcept {
+        if (size_ % bits_per_word != 0) words_.back() &= (word_type{1} << (size_ % bits_per_word)) - 1;
+    }
+
+public:
+    // Constructors
+    DenseBitset() = default;
+
+    explicit DenseBitset(size_type size, bool value = false)
+        : words_((size + bits_per_word - 1) / bits_per_word, value ? ~word_type{0} : 0), size_(size) {
+        trim();
+    }
+
+    // Element access
+    [[nodiscard]] bool test(index_type idx) const noexcept {
+        const auto i = get_index_value(idx);
+        return (words_[word_of(i)] & bit_of(i)) != 0;
+    }
+
+    [[nodiscard]] bool operator[](index_type idx) const noexcept { return test(idx); }
+
+    bool operator[](size_type) const = delete;
+
+    // Raw words, for bulk scanning
+    [[nodiscard]] std::span<word_type> words() noexcept { return words_; }
+    [[nodiscard]] std::span<const word_type> words() const noexcept { return words_; }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] size_type count() const noexcept {
+        size_type total = 0;
+        for (auto w : words_) total += static_cast<size_type>(std::popcount(w));
+        return total;
+    }
+
+    [[nodiscard]] bool any() const noexcept {
+        return std::ranges::any_of(words_, [](word_type w) { return w != 0; });
+    }
+
+    [[nodiscard]] bool none() const noexcept { return !any(); }
+
+    // Modifiers
+    void set(index_type idx) noexcept {
+        const auto i = get_index_value(idx);
+        words_[word_of(i)] |= bit_of(i);
+    }
+
+    void reset(index_type idx) noexcept {
+        const auto i = get_index_value(idx);
+        words_[word_of(i)] &= ~bit_of(i);
+    }
+
+    void assign(index_type idx, bool value) noexcept {
+        if (value) {
+            set(idx);
+        } else {
+            reset(idx);
+        }
+    }
+
+    // Set a bit that other threads may set concurrently; true if it was clear
+    bool set_atomic(index_type idx, std::memory_order order = std::memory_order_relaxed) noexcept {
+        const auto i = get_index_value(idx);
+        const auto old = std::atomic_ref<word_type>(words_[word_of(i)]).fetch_or(bit_of(i), order);
+        return (old & bit_of(i)) == 0;
+    }
+
+    void clear() noexcept { std::ranges::fill(words_, 0); }
+
+    void resize(size_type size) {
+        words_.resize((size + bits_per_word - 1) / bits_per_word, 0);
+        size_ = size;
+        if (!words_.empty()) trim();
+    }
+
+    void swap(DenseBitset& other) noexcept {
+        words_.swap(other.words_);
+        std::swap(size_, other.size_);
+    }
+
+    // Set algebra over bitsets of the same size
+    DenseBitset& operator|=(const DenseBitset& other) noexcept {
+        for (size_type w = 0; w < words_.size(); ++w) words_[w] |= other.words_[w];
+        return *this;
+    }
+
+    DenseBitset& operator&=(const DenseBitset& other) noexcept {
+        for (size_type w = 0; w < words_.size(); ++w) words_[w] &= other.words_[w];
+        return *this;
+    }
+
+    // Invoke f(index_type) for every set bit, in increasing order
+    template<typename F>
+    void for_each(F&& f) const {
+        for (size_type w = 0; w < words_.size(); ++w) {
+            detail::for_each_set_bit(words_[w], w * bits_per_word, [&](size_type i) { f(index_type(i)); });
+        }
+    }
+
+    [[nodiscard]] bool operator==(const DenseBitset&) const noexcept = default;
+};
+
+// Set of active indices that switches between a sparse index list and a dense
+// bitset. Inserting past domain/dense_divisor indices switches to the bitset;
+// bulk operations switch back to the list once the set falls below half that.
+// The bitset is kept in step with the list, so contains() is O(1) in both
+// forms, going dense is O(1), and clear() costs O(size) while sparse.
+template<StrongIndexType IndexType>
+class DenseFrontier {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    std::vector<IndexType> list_;
+    DenseBitset<IndexType> bits_;
+    size_type count_ = 0;
+    size_type divisor_ = 32;
+    bool dense_ = false;
+
+    [[nodiscard]] size_type dense_threshold() const noexcept { return bits_.size() / divisor_; }
+
+    // Pick the form that matches the current size, with hysteresis
+    void normalize() {
+        if (!dense_ && count_ > dense_threshold()) {
+            to_dense();
+        } else if (dense_ && count_ < dense_threshold() / 2) {
+            to_sparse();
+        }
+    }
+
+public:
+    // Constructors
+    DenseFrontier() = default;
+
+    explicit DenseFrontier(size_type domain_size, size_type dense_divisor = 32)
+        : bits_(domain_size), divisor_(std::max<size_type>(1, dense_divisor)) {}
+
+    // Capacity
+    [[nodiscard]] size_type domain_size() const noexcept { return bits_.size(); }
+    [[nodiscard]] size_type size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+    [[nodiscard]] bool is_dense() const noexcept { return dense_; }
+
+    // Membership
+    [[nodiscard]] bool contains(index_type idx) const noexcept { return bits_.test(idx); }
+
+    // Bitset view of the set, valid in either form
+    [[nodiscard]] const DenseBitset<IndexType>& bits() const noexcept { return bits_; }
+
+    // Insert one index; true if it was not already present
+    bool insert(index_type idx) {
+        if (bits_.test(idx)) return false;
+        bits_.set(idx);
+        ++count_;
+        if (!dense_) {
+            list_.push_back(idx);
+            if (count_ > dense_threshold()) to_dense();
+        }
+        return true;
+    }
+
+    void insert(std::span<const IndexType> indices) {
+        for (auto idx : indices) insert(idx);
+    }
+
+    // Union with a frontier over the same domain
+    DenseFrontier& operator|=(const DenseFrontier& other) {
+        if (dense_ || other.dense_) {
+            to_dense();
+            bits_ |= other.bits_;
+            count_ = bits_.count();
+            normalize();
+        } else {
+            insert(std::span<const IndexType>(other.list_));
+        }
+        return *this;
+    }
+
+    // Replace the contents with whatever fill(DenseBitset&) sets in a cleared
+    // bitset. fill may write the words from several threads.
+    template<typename F>
+    void assign_dense(F&& fill) {
+        clear();
+        dense_ = true;
+        std::forward<F>(fill)(bits_);
+        count_ = bits_.count();
+        normalize();
+    }
+
+    // Modifiers
+    void clear() noexcept {
+        if (dense_) {
+            bits_.clear();
+        } else {
+            for (auto idx : list_) bits_.reset(idx);
+        }
+        list_.clear();
+        count_ = 0;
+        dense_ = false;
+    }
+
+    void to_dense() noexcept {
+        list_.clear();
+        dense_ = true;
+    }
+
+    void to_sparse() {
+        if (!dense_) return;
+        list_.clear();
+        list_.reserve(count_);
+        bits_.for_each([&](index_type idx) { list_.push_back(idx); });
+        dense_ = false;
+    }
+
+    void swap(DenseFrontier& other) noexcept {
+        list_.swap(other.list_);
+        bits_.swap(other.bits_);
+        std::swap(count_, other.count_);
+        std::swap(divisor_, other.divisor_);
+        std::swap(dense_, other.dense_);
+    }
+
+    // Invoke f(index_type) for every member: in insertion order while sparse,
+    // in increasing order while dense
+    template<typename F>
+    void for_each(F&& f) const {
+        if (dense_) {
+            bits_.for_each(f);
+        } else {
+            for (auto idx : list_) f(idx);
+        }
+    }
+
+    // Parallel for_each; grain is in list entries, and the dense form hands
+    // each task grain / 8 bitset words
+    template<typename F>
+    void parallel_for_each(F&& f, WorkStealingScheduler& scheduler = default_scheduler(), std::size_t grain = 64) const {
+        using detail::ChunkIndex;
+        if (dense_) {
+            const auto words = bits_.words();
+            scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(words.size())),
+                [&](IndexRange<ChunkIndex> chunk) {
+                    for (auto w : chunk) {
+                        const auto i = get_index_value(w);
+                        detail::for_each_set_bit(words[i], i * 64, [&](size_type v) { f(index_type(v)); });
+                    }
+                }, {.grain = std::max<std::size_t>(1, grain / 8), .affinity = std::nullopt});
+        } else {
+            scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(list_.size())),
+                [&](IndexRange<ChunkIndex> chunk) {
+                    for (auto i : chunk) f(list_[get_index_value(i)]);
+                }, {.grain = grain, .affinity = std::nullopt});
+        }
+    }
+};
+
+// Directed graph in compressed sparse row form. Nodes are NodeIndex values in
+// [0, node_count()); edges are renumbered by source node, so the out-edges of a
+// node form a contiguous EdgeIndex range.
+template<StrongIndexType NodeIndex, StrongIndexType EdgeIndex, typename Weight = double>
+class DenseCsrGraph {
+public:
+    using node_index_type = NodeIndex;
+    using edge_index_type = EdgeIndex;
+    using weight_type = Weight;
+
+private:
+    std::vector<std::size_t> offsets_{0};
+    DenseVector<NodeIndex, EdgeIndex> targets_;
+    DenseVector<Weight, EdgeIndex> weights_;  // empty for unweighted graphs
+    bool weighted_ = false;
+
+    // weight is a projection to the edge weight, or nullptr for unweighted graphs
+    template<typename Edges, typename SourceFn, typename TargetFn, typename WeightFn>
+    static DenseCsrGraph build(std::size_t node_count, const Edges& edges, SourceFn source, TargetFn target,
+                               WeightFn weight) {
+        constexpr bool has_weight = !std::is_same_v<WeightFn, std::nullptr_t>;
+        DenseCsrGraph graph;
+        graph.weighted_ = has_weight;
+        const auto degree = histogram(edges, source, node_count);
+        graph.offsets_.resize(node_count + 1);
+        for (std::size_t u = 0; u < node_count; ++u) {
+            graph.offsets_[u + 1] = graph.offsets_[u] + degree.data()[u];
+        }
+        const auto edge_count = graph.offsets_.back();
+        graph.targets_.resize(edge_count);
+        if constexpr (has_weight) graph.weights_.resize(edge_count);
+        std::vector<std::size_t> cursor(graph.offsets_.begin(), graph.offsets_.end() - 1);
+        for (const auto& edge : edges) {
+            const auto e = cursor[get_index_value(std::invoke(source, edge))]++;
+            graph.targets_.data()[e] = std::invoke(target, edge);
+            if constexpr (has_weight) graph.weights_.data()[e] = static_cast<Weight>(std::invoke(weight, edge));
+        }
+        return graph;
+    }
+
+public:
+    DenseCsrGraph() = default;
+
+    // Build from any range of edges; source and target project an edge to its NodeIndex endpoints
+    template<std::ranges::input_range Edges, typename SourceFn, typename TargetFn>
+    [[nodiscard]] static DenseCsrGraph from_edges(std::size_t node_count, const Edges& edges,
+                                                  SourceFn source, TargetFn target) {
+        return build(node_count, edges, source, target, nullptr);
+    }
+
+    template<std::ranges::input_range Edges, typename SourceFn, typename TargetFn, typename WeightFn>
+    [[nodiscard]] static DenseCsrGraph from_edges(std::size_t node_count, const Edges& edges,
+                                                  SourceFn source, TargetFn target, WeightFn weight) {
+        return build(node_count, edges, source, target, weight);
+    }
+
+    // Graph with every edge reversed; its out-edges are this graph's in-edges
+    [[nodiscard]] DenseCsrGraph transpose() const {
+        struct Reversed {
+            NodeIndex from;
+            NodeIndex to;
+            Weight weight;
+        };
+        std::vector<Reversed> reversed;
+        reversed.reserve(edge_count());
+        for (std::size_t u = 0; u < node_count(); ++u) {
+            for (auto e = offsets_[u]; e < offsets_[u + 1]; ++e) {
+                reversed.push_back(Reversed{targets_.data()[e], NodeIndex(u), weighted() ? weights_.data()[e] : Weight{}});
+            }
+        }
+        if (weighted()) return from_edges(node_count(), reversed, &Reversed::from, &Reversed::to, &Reversed::weight);
+        return from_edges(node_count(), reversed, &Reversed::from, &Reversed::to);
+    }
+
+    [[nodiscard]] std::size_t node_count() const noexcept { return offsets_.size() - 1; }
+    [[nodiscard]] std::size_t edge_count() const noexcept { return targets_.size(); }
+    [[nodiscard]] bool weighted() const noexcept { return weighted_; }
+
+    [[nodiscard]] IndexRange<NodeIndex> nodes() const noexcept {
+        return IndexRange<NodeIndex>(NodeIndex(0), NodeIndex(node_count()));
+    }
+
+    [[nodiscard]] IndexRange<EdgeIndex> out_edges(NodeIndex u) const noexcept {
+        const auto i = get_index_value(u);
+        return IndexRange<EdgeIndex>(EdgeIndex(offsets_[i]), EdgeIndex(offsets_[i + 1]));
+    }
+
+    [[nodiscard]] std::size_t degree(NodeIndex u) const noexcept {
+        const auto i = get_index_value(u);
+        return offsets_[i + 1] - offsets_[i];
+    }
+
+    [[nodiscard]] std::span<const NodeIndex> neighbors(NodeIndex u) const noexcept {
+        const auto i = get_index_value(u);
+        return std::span<const NodeIndex>(targets_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    [[nodiscard]] NodeIndex target(EdgeIndex e) const noexcept { return targets_[e]; }
+    [[nodiscard]] Weight weight(EdgeIndex e) const noexcept { return weights_[e]; }
+
+    [[nodiscard]] const DenseVector<NodeIndex, EdgeIndex>& targets() const noexcept { return targets_; }
+    [[nodiscard]] const DenseVector<Weight, EdgeIndex>& weights() const noexcept { return weights_; }
+};
+
+// Tuning for direction-optimizing BFS (Beamer et al.)
+struct BfsOptions {
+    std::size_t alpha = 15;  // go bottom-up once frontier edges exceed unexplored edges / alpha
+    std::size_t beta = 18;   // go top-down once the frontier shrinks below nodes / beta
+};
+
+template<StrongIndexType NodeIndex>
+struct BfsResult {
+    static constexpr std::uint32_t unreachable = ~std::uint32_t{0};
+
+    DenseVector<std::uint32_t, NodeIndex> depth;  // unreachable for nodes not reached
+    DenseVector<NodeIndex, NodeIndex> parent;     // BFS tree parent; the node itself for the source and unreached nodes
+};
+
+// Direction-optimizing breadth-first search. `in` must be the transpose of `out`
+// (the same graph for undirected graphs); the bottom-up steps scan it. Throws
+// std::invalid_argument if options.alpha or options.beta is zero.
+template<typename Graph>
+[[nodiscard]] BfsResult<typename Graph::node_index_type>
+bfs(const Graph& out, const Graph& in, typename Graph::node_index_type source, BfsOptions options = {},
+    WorkStealingScheduler& scheduler = default_scheduler()) {
+    using NodeIndex = typename Graph::node_index_type;
+    using Result = BfsResult<NodeIndex>;
+    using detail::ChunkIndex;
+
+    if (options.alpha == 0 || options.beta == 0) throw std::invalid_argument("dense_index::bfs: alpha and beta must be positive");
+
+    const auto n = out.node_count();
+    Result result{DenseVector<std::uint32_t, NodeIndex>(n, Result::unreachable), {}};
+    result.parent.reserve(n);
+    for (auto u : out.nodes()) [[maybe_unused]] auto _ = result.parent.push_back(u);
+    auto depth = atomic_view(result.depth);
+    auto* parent = result.parent.data();
+
+    result.depth[source] = 0;
+    DenseFrontier<NodeIndex> frontier(n), next(n);
+    frontier.insert(source);
+    std::vector<std::vector<NodeIndex>> local(scheduler.worker_count());
+    std::vector<std::size_t> local_scout(scheduler.worker_count());
+    std::uint32_t level = 0;
+    std::size_t edges_to_check = out.edge_count();
+    std::size_t scout_count = out.degree(source);
+
+    // Expand every frontier node's out-edges, claiming unvisited targets by CAS
+    auto top_down_step = [&] {
+        std::ranges::fill(local_scout, 0);
+        frontier.parallel_for_each([&](NodeIndex u) {
+            const auto worker = *scheduler.current_worker();
+            for (NodeIndex v : out.neighbors(u)) {
+                auto expected = Result::unreachable;
+                if (depth.load(v, std::memory_order_relaxed) == Result::unreachable &&
+                    depth.compare_exchange_strong(v, expected, level + 1, std::memory_order_relaxed)) {
+                    parent[get_index_value(v)] = u;
+                    local[worker].push_back(v);
+                    local_scout[worker] += out.degree(v);
+                }
+            }
+        }, scheduler);
+        next.clear();
+        for (auto& l : local) {
+            next.insert(std::span<const NodeIndex>(l));
+            l.clear();
+        }
+        frontier.swap(next);
+        return std::accumulate(local_scout.begin(), local_scout.end(), std::size_t{0});
+    };
+
+    // Every unvisited node looks for a parent among its in-neighbors. Tasks own
+    // whole bitset words, so the next frontier is written without atomics.
+    auto bottom_up_step = [&] {
+        next.assign_dense([&](DenseBitset<NodeIndex>& bits) {
+            auto next_words = bits.words();
+            scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(next_words.size())),
+                [&](IndexRange<ChunkIndex> words) {
+                    const auto first = get_index_value(words.first()) * 64;
+                    const auto last = std::min(n, get_index_value(words.last()) * 64);
+                    for (auto i = first; i < last; ++i) {
+                        const NodeIndex v(i);
+                        if (depth.load(v, std::memory_order_relaxed) != Result::unreachable) continue;
+                        for (NodeIndex u : in.neighbors(v)) {
+                            if (frontier.contains(u)) {
+                                depth.store(v, level + 1, std::memory_order_relaxed);
+                                parent[i] = u;
+                                next_words[i / 64] |= std::uint64_t{1} << (i % 64);
+                                break;
+                            }
+                        }
+                    }
+                }, {.grain = 16, .affinity = std::nullopt});
+        });
+        frontier.swap(next);
+        return frontier.size();
+    };
+
+    while (!frontier.empty()) {
+        if (scout_count > edges_to_check / options.alpha) {
+            std::size_t awake = frontier.size();
+            std::size_t previous = 0;
+            do {
+                previous = awake;
+                awake = bottom_up_step();
+                ++level;
+            } while (awake >= previous || awake > n / options.beta);
+            scout_count = 1;
+        } else {
+            edges_to_check -= std::min(edges_to_check, scout_count);
+            scout_count = top_down_step();
+            ++level;
+        }
+    }
+    return result;
+}
+
+template<typename Graph>
+[[nodiscard]] BfsResult<typename Graph::node_index_type>
+bfs(const Graph& undirected, typename Graph::node_index_type source, BfsOptions options = {},
+    WorkStealingScheduler& scheduler = default_scheduler()) {
+    return bfs(undirected, undirected, source, options, scheduler);
+}
+
+namespace detail {
+
+// Path length a + b, clamped to the largest value for integral weights so it
+// never wraps past the "unreached" sentinel
+template<typename Weight>
+[[nodiscard]] constexpr Weight saturating_path_add(Weight a, Weight b) noexcept {
+    if constexpr (std::is_integral_v<Weight>) {
+        if (b > Weight{} && a > std::numeric_limits<Weight>::max() - b) return std::numeric_limits<Weight>::max();
+    }
+    return a + b;
+}
+
+} // namespace detail
+
+// Single-source shortest paths by delta-stepping. Nodes are settled in buckets
+// of width delta; each bucket's frontier relaxes its out-edges in parallel with
+// an atomic min, and improved nodes land in per-worker bucket lists. A
+// relaxation lands at most max_weight / delta + 1 buckets ahead, so the lists
+// form a ring of that many buckets. A delta so small that the ring would exceed
+// max_delta_stepping_buckets is widened to fit, which only coarsens the
+// batching. Throws std::invalid_argument for an unweighted graph, a
+// non-positive delta, or a negative or non-finite edge weight.
+inline constexpr std::size_t max_delta_stepping_buckets = 4096;
+
+template<typename Graph>
+[[nodiscard]] DenseVector<typename Graph::weight_type, typename Graph::node_index_type>
+sssp_delta_stepping(const Graph& graph, typename Graph::node_index_type source, typename Graph::weight_type delta,
+                    WorkStealingScheduler& scheduler = default_scheduler()) {
+    using NodeIndex = typename Graph::node_index_type;
+    using Weight = typename Graph::weight_type;
+    using detail::ChunkIndex;
+
+    if (!graph.weighted()) throw std::invalid_argument("dense_index::sssp_delta_stepping: graph has no weights");
+    if (!(delta > Weight{})) throw std::invalid_argument("dense_index::sssp_delta_stepping: delta must be positive");
+    Weight max_weight{};
+    for (const Weight w : graph.weights()) {
+        bool valid = true;
+        if constexpr (std::is_floating_point_v<Weight>) {
+            valid = w >= Weight{} && std::isfinite(w);
+        } else if constexpr (std::is_signed_v<Weight>) {
+            valid = w >= Weight{};
+        }
+        if (!valid) throw std::invalid_argument("dense_index::sssp_delta_stepping: weights must be finite and non-negative");
+        max_weight = std::max(max_weight, w);
+    }
+    constexpr std::uintmax_t limit = max_delta_stepping_buckets - 2;
+    if constexpr (std::is_integral_v<Weight>) {
+        const auto widest = static_cast<std::uintmax_t>(max_weight);
+        if (widest / static_cast<std::uintmax_t>(delta) > limit) {
+            delta = static_cast<Weight>(widest / limit + (widest % limit != 0 ? 1 : 0));
+        }
+    } else if (max_weight / delta > static_cast<Weight>(limit)) {
+        delta = max_weight / static_cast<Weight>(limit);
+    }
+    // Buckets are compared as quotients, so no product with delta can overflow
+    const auto bucket_of = [delta](Weight d) { return static_cast<std::size_t>(d / delta); };
+    const auto ring = bucket_of(max_weight) + 2;
+
+    constexpr Weight infinity = std::numeric_limits<Weight>::has_infinity ? std::numeric_limits<Weight>::infinity()
+                                                                          : std::numeric_limits<Weight>::max();
+    DenseVector<Weight, NodeIndex> dist(graph.node_count(), infinity);
+    auto atomic_dist = atomic_view(dist);
+    dist[source] = Weight{};
+
+    std::vector<std::vector<std::vector<NodeIndex>>> bins(scheduler.worker_count(), std::vector<std::vector<NodeIndex>>(ring));
+    std::vector<NodeIndex> frontier{source};
+    std::size_t bin = 0;
+    while (!frontier.empty()) {
+        scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(frontier.size())),
+            [&](IndexRange<ChunkIndex> chunk) {
+                auto& local = bins[*scheduler.current_worker()];
+                for (auto i : chunk) {
+                    const NodeIndex u = frontier[get_index_value(i)];
+                    const Weight du = atomic_dist.load(u, std::memory_order_relaxed);
+                    // Stale entry: u was settled in an earlier bucket
+                    if (bucket_of(du) < bin) continue;
+                    for (auto e : graph.out_edges(u)) {
+                        const NodeIndex v = graph.target(e);
+                        const Weight candidate = detail::saturating_path_add(du, graph.weight(e));
+                        if (candidate < atomic_dist.fetch_min(v, candidate, std::memory_order_relaxed)) {
+                            local[bucket_of(candidate) % ring].push_back(v);
+                        }
+                    }
+                }
+            }, {.grain = 64, .affinity = std::nullopt});
+
+        // Pending entries all lie in [bin, bin + ring), so the first non-empty
+        // ring slot from bin onwards is the next bucket
+        auto next = std::numeric_limits<std::size_t>::max();
+        for (std::size_t step = 0; step < ring && next == std::numeric_limits<std::size_t>::max(); ++step) {
+            for (const auto& local : bins) {
+                if (!local[(bin + step) % ring].empty()) {
+                    next = bin + step;
+                    break;
+                }
+            }
+        }
+        frontier.clear();
+        if (next == std::numeric_limits<std::size_t>::max()) break;
+        for (auto& local : bins) {
+            auto& slot = local[next % ring];
+            frontier.insert(frontier.end(), slot.begin(), slot.end());
+            slot.clear();
+        }
+        bin = next;
+    }
+    return dist;
+}
+
+struct PageRankOptions {
+    double damping = 0.85;
+    std::size_t max_iterations = 20;
+    double tolerance = 1e-4;  // stop once the L1 change of an iteration drops below this
+};
+
+// Pull-based PageRank: every node sums the contributions of its in-neighbors,
+// so each rank is written by exactly one task. `in` must be the transpose of `out`.
+template<typename Graph>
+[[nodiscard]] DenseVector<double, typename Graph::node_index_type>
+pagerank(const Graph& out, const Graph& in, PageRankOptions options = {},
+         WorkStealingScheduler& scheduler = default_scheduler()) {
+    using NodeIndex = typename Graph::node_index_type;
+
+    struct alignas(64) Partial {
+        double value = 0.0;
+    };
+
+    const auto n = out.node_count();
+    DenseVector<double, NodeIndex> rank(n, n == 0 ? 0.0 : 1.0 / static_cast<double>(n));
+    DenseVector<double, NodeIndex> contribution(n, 0.0);
+    std::vector<Partial> dangling(scheduler.worker_count()), error(scheduler.worker_count());
+    const ParallelForOptions chunking{.grain = 1024, .affinity = std::nullopt};
+
+    for (std::size_t iteration = 0; iteration < options.max_iterations && n > 0; ++iteration) {
+        for (auto& d : dangling) d.value = 0.0;
+        for (auto& e : error) e.value = 0.0;
+        scheduler.parallel_for_chunks(out.nodes(), [&](IndexRange<NodeIndex> chunk) {
+            auto& lost = dangling[*scheduler.current_worker()].value;
+            for (auto u : chunk) {
+                const auto degree = out.degree(u);
+                contribution[u] = degree == 0 ? 0.0 : rank[u] / static_cast<double>(degree);
+                if (degree == 0) lost += rank[u];
+            }
+        }, chunking);
+        double dangling_mass = 0.0;
+        for (const auto& d : dangling) dangling_mass += d.value;
+        const double base = (1.0 - options.damping + options.damping * dangling_mass) / static_cast<double>(n);
+
+        scheduler.parallel_for_chunks(out.nodes(), [&](IndexRange<NodeIndex> chunk) {
+            auto& delta = error[*scheduler.current_worker()].value;
+            for (auto v : chunk) {
+                double incoming = 0.0;
+                for (NodeIndex u : in.neighbors(v)) incoming += contribution[u];
+                const double updated = base + options.damping * incoming;
+                delta += std::abs(updated - rank[v]);
+                rank[v] = updated;
+            }
+        }, chunking);
+        double total_error = 0.0;
+        for (const auto& e : error) total_error += e.value;
+        if (total_error < options.tolerance) break;
+    }
+    return rank;
+}
+
+// Connected components by Afforest (Sutton et al.): link a sample of each node's
+// edges, find the largest intermediate component, then finish linking only the
+// nodes outside it. Links are CAS operations on a parent array. For directed
+// graphs pass the transpose as `in` to compute weakly connected components.
+// Every node is labeled with the smallest node of its component.
+template<typename Graph>
+[[nodiscard]] DenseVector<typename Graph::node_index_type, typename Graph::node_index_type>
+connected_components(const Graph& out, const Graph& in, std::size_t neighbor_rounds = 2,
+                     WorkStealingScheduler& scheduler = default_scheduler()) {
+    using NodeIndex = typename Graph::node_index_type;
+
+    const auto n = out.node_count();
+    DenseVector<NodeIndex, NodeIndex> comp;
+    comp.reserve(n);
+    for (auto u : out.nodes()) [[maybe_unused]] auto _ = comp.push_back(u);
+    auto parent = atomic_view(comp);
+    auto value = [](NodeIndex u) { return get_index_value(u); };
+
+    auto link = [&](NodeIndex u, NodeIndex v) {
+        auto p1 = parent.load(u, std::memory_order_relaxed);
+        auto p2 = parent.load(v, std::memory_order_relaxed);
+        while (value(p1) != value(p2)) {
+            const auto high = value(p1) > value(p2) ? p1 : p2;
+            const auto low = value(p1) > value(p2) ? p2 : p1;
+            auto p_high = parent.load(high, std::memory_order_relaxed);
+            if (value(p_high) == value(low)) break;
+            if (value(p_high) == value(high) &&
+                parent.compare_exchange_strong(high, p_high, low, std::memory_order_relaxed)) {
+                break;
+            }
+            p1 = parent.load(parent.load(high, std::memory_order_relaxed), std::memory_order_relaxed);
+            p2 = parent.load(low, std::memory_order_relaxed);
+        }
+    };
+
+    auto compress = [&] {
+        scheduler.parallel_for(out.nodes(), [&](NodeIndex u) {
+            auto p = parent.load(u, std::memory_order_relaxed);
+            for (auto pp = parent.load(p, std::memory_order_relaxed); value(p) != value(pp);
+                 pp = parent.load(p, std::memory_order_relaxed)) {
+                parent.store(u, pp, std::memory_order_relaxed);
+                p = pp;
+            }
+        }, {.grain = 1024, .affinity = std::nullopt});
+    };
+
+    for (std::size_t round = 0; round < neighbor_rounds; ++round) {
+        scheduler.parallel_for(out.nodes(), [&](NodeIndex u) {
+            const auto adjacent = out.neighbors(u);
+            if (round < adjacent.size()) link(u, adjacent[round]);
+        }, {.grain = 1024, .affinity = std::nullopt});
+        compress();
+    }
+
+    // Most frequent intermediate label among a deterministic sample of nodes
+    std::size_t largest = 0;
+    if (n > 0) {
+        std::unordered_map<std::size_t, std::size_t> frequency;
+        std::uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (int sample = 0; sample < 1024; ++sample) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            ++frequency[value(comp[NodeIndex(state % n)])];
+        }
+        largest = std::ranges::max_element(frequency, {}, [](const auto& entry) { return entry.second; })->first;
+    }
+
+    scheduler.parallel_for(out.nodes(), [&](NodeIndex u) {
+        if (value(parent.load(u, std::memory_order_relaxed)) == largest) return;
+        const auto adjacent = out.neighbors(u);
+        for (auto k = std::min(neighbor_rounds, adjacent.size()); k < adjacent.size(); ++k) link(u, adjacent[k]);
+        if (&in != &out) {
+            for (NodeIndex v : in.neighbors(u)) link(u, v);
+        }
+    }, {.grain = 1024, .affinity = std::nullopt});
+    compress();
+    return comp;
+}
+
+template<typename Graph>
+[[nodiscard]] DenseVector<typename Graph::node_index_type, typename Graph::node_index_type>
+connected_components(const Graph& undirected, std::size_t neighbor_rounds = 2,
+                     WorkStealingScheduler& scheduler = default_scheduler()) {
+    return connected_components(undirected, undirected, neighbor_rounds, scheduler);
+}
+
+namespace detail {
+
+template<typename IndexType>
+struct index_rep {
+    using type = std::size_t;
+};
+
+template<typename IndexType>
+    requires std::unsigned_integral<typename IndexType::underlying_type>
+struct index_rep<IndexType> {
+    using type = typename IndexType::underlying_type;
+};
+
+inline void spin_wait(std::size_t& spins) {
+    if (++spins > 64) std::this_thread::yield();
+}
+
+} // namespace detail
+
+// Stored width of an index type: StrongIndex's Rep, otherwise size_t
+template<StrongIndexType IndexType>
+using index_rep_t = typename detail::index_rep<IndexType>::type;
+
+// Bounded lock-free multi-producer multi-consumer queue of indices (Vyukov's
+// sequenced ring). Indices are stored at index_rep_t width next to a 32-bit
+// sequence number. The batch operations claim a whole run of cells with one
+// CAS and then wait only for the cells' previous occupants to finish.
+template<StrongIndexType IndexType>
+class DenseMpmcQueue {
+public:
+    using index_type = IndexType;
+    using rep_type = index_rep_t<IndexType>;
+    using size_type = std::size_t;
+
+private:
+    struct Cell {
+        std::atomic<std::uint32_t> sequence;
+        rep_type value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_type mask_ = 0;
+    alignas(64) std::atomic<size_type> tail_{0};
+    alignas(64) std::atomic<size_type> head_{0};
+
+    // Positions one cycle apart share a cell; the sequence tells them apart
+    [[nodiscard]] static std::int32_t distance(std::uint32_t sequence, size_type pos) noexcept {
+        return static_cast<std::int32_t>(sequence - static_cast<std::uint32_t>(pos));
+    }
+
+    [[nodiscard]] Cell& cell(size_type pos) const noexcept { return cells_[pos & mask_]; }
+
+    void wait_for(const Cell& c, size_type pos) const noexcept {
+        std::size_t spins = 0;
+        while (distance(c.sequence.load(std::memory_order_acquire), pos) != 0) detail::spin_wait(spins);
+    }
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit DenseMpmcQueue(size_type capacity) {
+        if (capacity == 0 || capacity > (size_type{1} << 30)) {
+            throw std::length_error("DenseMpmcQueue::DenseMpmcQueue");
+        }
+        const auto n = std::bit_ceil(capacity);
+        cells_ = std::make_unique<Cell[]>(n);
+        for (size_type i = 0; i < n; ++i) cells_[i].sequence.store(static_cast<std::uint32_t>(i), std::memory_order_relaxed);
+        mask_ = n - 1;
+    }
+
+    DenseMpmcQueue(const DenseMpmcQueue&) = delete;
+    DenseMpmcQueue& operator=(const DenseMpmcQueue&) = delete;
+
+    [[nodiscard]] size_type capacity() const noexcept { return mask_ + 1; }
+
+    // Approximate while other threads are operating on the queue
+    [[nodiscard]] size_type size() const noexcept {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Single-element operations
+    [[nodiscard]] bool try_push(IndexType idx) noexcept {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& c = cell(pos);
+            const auto d = distance(c.sequence.load(std::memory_order_acquire), pos);
+            if (d == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = static_cast<rep_type>(get_index_value(idx));
+                    c.sequence.store(static_cast<std::uint32_t>(pos + 1), std::memory_order_release);
+                    return true;
+                }
+            } else if (d < 0) {
+                return false;  // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] std::optional<IndexType> try_pop() noexcept {
+        auto pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& c = cell(pos);
+            const auto d = distance(c.sequence.load(std::memory_order_acquire), pos + 1);
+            if (d == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    const auto value = c.value;
+                    c.sequence.store(static_cast<std::uint32_t>(pos + capacity()), std::memory_order_release);
+                    return IndexType(static_cast<std::size_t>(value));
+                }
+            } else if (d < 0) {
+                return std::nullopt;  // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pushes a prefix of `values` that fits; returns its length
+    [[nodiscard]] size_type try_push(std::span<const IndexType> values) noexcept {
+        return push_batch(values.size(), [&](size_type i) { return values[i]; });
+    }
+
+    [[nodiscard]] size_type try_push(IndexRange<IndexType> range) noexcept {
+        const auto first = get_index_value(range.first());
+        return push_batch(range.size(), [&](size_type i) { return IndexType(first + i); });
+    }
+
+    // Pops up to out.size() indices in FIFO order; returns how many were written
+    [[nodiscard]] size_type try_pop(std::span<IndexType> out) noexcept {
+        if (out.empty()) return 0;
+        auto pos = head_.load(std::memory_order_relaxed);
+        size_type k = 0;
+        do {
+            const auto tail = tail_.load(std::memory_order_acquire);
+            if (tail <= pos) return 0;
+            k = std::min(out.size(), tail - pos);
+        } while (!head_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed));
+        // Producers have claimed these cells; wait for each to be published
+        for (size_type i = 0; i < k; ++i) {
+            auto& c = cell(pos + i);
+            wait_for(c, pos + i + 1);
+            out[i] = IndexType(static_cast<std::size_t>(c.value));
+            c.sequence.store(static_cast<std::uint32_t>(pos + i + capacity()), std::memory_order_release);
+        }
+        return k;
+    }
+
+private:
+    template<typename Get>
+    size_type push_batch(size_type n, Get get) noexcept {
+        if (n == 0) return 0;
+        auto pos = tail_.load(std::memory_order_relaxed);
+        size_type k = 0;
+        do {
+            const auto head = head_.load(std::memory_order_acquire);
+            const auto used = pos > head ? pos - head : 0;
+            if (used >= capacity()) return 0;
+            k = std::min(n, capacity() - used);
+        } while (!tail_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed));
+        // Consumers have claimed the previous occupants; wait for each to be read
+        for (size_type i = 0; i < k; ++i) {
+            auto& c = cell(pos + i);
+            wait_for(c, pos + i);
+            c.value = static_cast<rep_type>(get_index_value(get(i)));
+            c.sequence.store(static_cast<std::uint32_t>(pos + i + 1), std::memory_order_release);
+        }
+        return k;
+    }
+};
+
+// Unbounded lock-free MPMC queue of indices built from fixed-size chunks.
+// Producers and consumers claim slots with fetch_add on the current chunk's
+// enqueue and dequeue counters (Ramalhete and Correia's FAAArrayQueue), so a
+// batch of k indices costs one atomic add instead of k. A consumer that
+// overtakes a producer marks the slot taken and the producer retries in a
+// later slot. Drained chunks are reclaimed by epochs: every operation runs
+// inside a guard counted against the global epoch it observed, and a chunk
+// unlinked from the head in epoch E is freed once the epoch has moved three
+// steps on, when no operation that could still hold it is running. Memory is
+// therefore bounded by the queue's peak length, not by its total traffic.
+template<StrongIndexType IndexType, std::size_t ChunkSize = 1024>
+class DenseChunkedQueue {
+    static_assert(ChunkSize > 0);
+
+public:
+    using index_type = IndexType;
+    using rep_type = index_rep_t<IndexType>;
+    using size_type = std::size_t;
+
+private:
+    enum : std::uint8_t { slot_empty, slot_full, slot_taken };
+
+    struct Chunk {
+        alignas(64) std::atomic<size_type> enqueued{0};
+        alignas(64) std::atomic<size_type> dequeued{0};
+        std::atomic<Chunk*> next{nullptr};
+        Chunk* retired_next = nullptr;  // link in a retired list; next stays intact for slow readers
+        std::array<std::atomic<std::uint8_t>, ChunkSize> state{};
+        std::array<rep_type, ChunkSize> values;
+    };
+
+    alignas(64) std::atomic<Chunk*> head_;
+    alignas(64) std::atomic<Chunk*> tail_;
+
+    // Reclamation state; mutable so that const readers can hold a guard too
+    alignas(64) mutable std::atomic<size_type> epoch_{0};
+    mutable std::array<std::atomic<size_type>, 3> active_{};  // running operations per epoch (mod 3)
+    mutable std::array<std::atomic<Chunk*>, 3> retired_{};    // chunks retired per epoch (mod 3)
+    mutable std::atomic<size_type> retired_count_{0};
+    mutable std::atomic_flag reclaiming_;
+    mutable std::atomic<size_type> chunk_count_{0};
+
+    // Scope of one operation: while it lives, no chunk the operation can reach is freed
+    class Guard {
+    public:
+        explicit Guard(const DenseChunkedQueue& queue) noexcept : queue_(queue) {
+            for (;;) {
+                epoch_ = queue_.epoch_.load(std::memory_order_seq_cst);
+                queue_.active_[epoch_ % 3].fetch_add(1, std::memory_order_seq_cst);
+                if (queue_.epoch_.load(std::memory_order_seq_cst) == epoch_) return;
+                queue_.active_[epoch_ % 3].fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ~Guard() {
+            queue_.active_[epoch_ % 3].fetch_sub(1, std::memory_order_seq_cst);
+            if (queue_.retired_count_.load(std::memory_order_relaxed) != 0) queue_.try_reclaim();
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        const DenseChunkedQueue& queue_;
+        size_type epoch_ = 0;
+    };
+
+    [[nodiscard]] Chunk* new_chunk() {
+        auto* chunk = new Chunk;
+        chunk_count_.fetch_add(1, std::memory_order_relaxed);
+        return chunk;
+    }
+
+    void delete_chunk(Chunk* chunk) const noexcept {
+        delete chunk;
+        chunk_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Called by the consumer that unlinked chunk from the head, inside its guard
+    void retire(Chunk* chunk) noexcept {
+        const auto epoch = epoch_.load(std::memory_order_seq_cst);
+        retired_count_.fetch_add(1, std::memory_order_relaxed);
+        auto& list = retired_[epoch % 3];
+        chunk->retired_next = list.load(std::memory_order_relaxed);
+        while (!list.compare_exchange_weak(chunk->retired_next, chunk, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+    }
+
+    // Advance the epoch from e to e + 1 once no operation is left in e - 1,
+    // freeing what was retired in e - 2. Skipped if another thread is at it.
+    void try_reclaim() const noexcept {
+        if (reclaiming_.test_and_set(std::memory_order_acquire)) return;
+        const auto epoch = epoch_.load(std::memory_order_seq_cst);
+        Chunk* expired = nullptr;
+        if (active_[(epoch + 2) % 3].load(std::memory_order_seq_cst) == 0) {
+            // Nothing can be retired into this slot for e + 1 before the store below
+            expired = retired_[(epoch + 1) % 3].exchange(nullptr, std::memory_order_acquire);
+            epoch_.store(epoch + 1, std::memory_order_seq_cst);
+        }
+        reclaiming_.clear(std::memory_order_release);
+        free_list(expired);
+    }
+
+    void free_list(Chunk* chunk) const noexcept {
+        while (chunk != nullptr) {
+            auto* next = chunk->retired_next;
+            delete_chunk(chunk);
+            retired_count_.fetch_sub(1, std::memory_order_relaxed);
+            chunk = next;
+        }
+    }
+
+    // Move `from` forward to its successor, appending a new chunk if needed
+    void advance(std::atomic<Chunk*>& from, Chunk* chunk) {
+        auto* next = chunk->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            std::unique_ptr<Chunk> fresh(new_chunk());
+            if (chunk->next.compare_exchange_strong(next, fresh.get(), std::memory_order_acq_rel)) {
+                next = fresh.release();
+            } else {
+                delete_chunk(fresh.release());
+            }
+        }
+        from.compare_exchange_strong(chunk, next, std::memory_order_acq_rel);
+    }
+
+    // Frees chunk and everything linked after it. Not thread-safe.
+    void release_chunks(Chunk* chunk) noexcept {
+        while (chunk != nullptr) {
+            auto* next = chunk->next.load(std::memory_order_relaxed);
+            delete_chunk(chunk);
+            chunk = next;
+        }
+    }
+
+    void release_retired() noexcept {
+        for (auto& list : retired_) free_list(list.exchange(nullptr, std::memory_order_relaxed));
+    }
+
+    template<typename Get>
+    void push_batch(size_type n, Get get) {
+        const Guard guard(*this);
+        size_type i = 0;
+        while (i < n) {
+            auto* chunk = tail_.load(std::memory_order_acquire);
+            const auto want = n - i;
+            const auto slot = chunk->enqueued.fetch_add(want, std::memory_order_acq_rel);
+            const auto end = std::min(slot + want, ChunkSize);
+            for (auto s = slot; s < end; ++s) {
+                chunk->values[s] = static_cast<rep_type>(get_index_value(get(i)));
+                auto expected = std::uint8_t{slot_empty};
+                if (chunk->state[s].compare_exchange_strong(expected, slot_full, std::memory_order_release,
+                                                            std::memory_order_relaxed)) {
+                    ++i;
+                }
+            }
+            if (slot + want > ChunkSize) advance(tail_, chunk);
+        }
+    }
+
+public:
+    DenseChunkedQueue() {
+        auto* first = new_chunk();
+        head_.store(first, std::memory_order_relaxed);
+        tail_.store(first, std::memory_order_relaxed);
+    }
+
+    ~DenseChunkedQueue() {
+        release_retired();
+        release_chunks(head_.load(std::memory_order_relaxed));
+    }
+
+    DenseChunkedQueue(const DenseChunkedQueue&) = delete;
+    DenseChunkedQueue& operator=(const DenseChunkedQueue&) = delete;
+
+    void push(IndexType idx) {
+        push_batch(1, [&](size_type) { return idx; });
+    }
+
+    void push(std::span<const IndexType> values) {
+        push_batch(values.size(), [&](size_type i) { return values[i]; });
+    }
+
+    void push(IndexRange<IndexType> range) {
+        const auto first = get_index_value(range.first());
+        push_batch(range.size(), [&](size_type i) { return IndexType(first + i); });
+    }
+
+    [[nodiscard]] std::optional<IndexType> try_pop() noexcept {
+        IndexType idx{};
+        if (try_pop(std::span<IndexType>(&idx, 1)) == 0) return std::nullopt;
+        return idx;
+    }
+
+    // Pops up to out.size() indices; returns how many were written. Indices
+    // pushed by one thread are popped in their push order.
+    [[nodiscard]] size_type try_pop(std::span<IndexType> out) noexcept {
+        const Guard guard(*this);
+        size_type got = 0;
+        while (got < out.size()) {
+            auto* chunk = head_.load(std::memory_order_acquire);
+            const auto deq = chunk->dequeued.load(std::memory_order_acquire);
+            const auto enq = std::min(chunk->enqueued.load(std::memory_order_acquire), ChunkSize);
+            if (deq >= enq) {
+                if (deq < ChunkSize) break;  // empty
+                auto* next = chunk->next.load(std::memory_order_acquire);
+                if (next == nullptr) break;
+                // Every slot is claimed; move the tail off the chunk too, so
+                // nothing new can reach it once the head has moved on
+                auto* expected = chunk;
+                tail_.compare_exchange_strong(expected, next, std::memory_order_acq_rel);
+                expected = chunk;
+                if (head_.compare_exchange_strong(expected, next, std::memory_order_acq_rel)) retire(chunk);
+                continue;
+            }
+            const auto want = std::min(out.size() - got, enq - deq);
+            const auto slot = chunk->dequeued.fetch_add(want, std::memory_order_acq_rel);
+            const auto end = std::min(slot + want, ChunkSize);
+            for (auto s = slot; s < end; ++s) {
+                if (chunk->state[s].exchange(slot_taken, std::memory_order_acquire) == slot_full) {
+                    out[got++] = IndexType(static_cast<std::size_t>(chunk->values[s]));
+                }
+            }
+        }
+        return got;
+    }
+
+    // Approximate while other threads are operating on the queue
+    [[nodiscard]] bool empty() const noexcept {
+        const Guard guard(*this);
+        auto* chunk = head_.load(std::memory_order_acquire);
+        for (; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const auto enq = std::min(chunk->enqueued.load(std::memory_order_acquire), ChunkSize);
+            if (chunk->dequeued.load(std::memory_order_acquire) < enq) return false;
+        }
+        return true;
+    }
+
+    // Chunks currently allocated, including drained ones not yet reclaimed
+    [[nodiscard]] size_type chunk_count() const noexcept { return chunk_count_.load(std::memory_order_relaxed); }
+
+    // Drops all contents and frees every chunk but one. Not thread-safe.
+    void clear() noexcept {
+        release_retired();
+        auto* first = head_.load(std::memory_order_relaxed);
+        release_chunks(first->next.load(std::memory_order_relaxed));
+        first->next.store(nullptr, std::memory_order_relaxed);
+        first->enqueued.store(0, std::memory_order_relaxed);
+        first->dequeued.store(0, std::memory_order_relaxed);
+        for (auto& s : first->state) s.store(slot_empty, std::memory_order_relaxed);
+        tail_.store(first, std::memory_order_relaxed);
+    }
+};
+
+namespace detail {
+
+// Position of T in Ts, or sizeof...(Ts) if absent
+template<typename T, typename... Ts>
+consteval std::size_t type_index() {
+    constexpr bool matches[] = {std::is_same_v<T, Ts>..., false};
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+        if (matches[i]) return i;
+    }
+    return sizeof...(Ts);
+}
+
+template<typename... Ts>
+consteval bool distinct_types() {
+    return []<std::size_t... I>(std::index_sequence<I...>) {
+        return ((type_index<Ts, Ts...>() == I) && ...);
+    }(std::index_sequence_for<Ts...>{});
+}
+
+} // namespace detail
+
+// Archetype-based entity-component store. Entities that own exactly the same
+// set of component types share an archetype whose components are stored as one
+// contiguous array per type, so a query walks packed spans instead of looking
+// up components entity by entity. Rows are grouped in chunks of chunk_rows;
+// each chunk records, per component, the tick of its last write access, which
+// queries can filter on. Adding or removing components moves an entity between
+// archetypes; structural changes invalidate spans obtained from queries.
+template<StrongIndexType EntityIndex, typename... Components>
+class DenseWorld {
+    static_assert(sizeof...(Components) > 0 && sizeof...(Components) <= 64, "DenseWorld supports 1 to 64 component types");
+    static_assert(detail::distinct_types<Components...>(), "DenseWorld component types must be distinct");
+
+public:
+    using entity_type = EntityIndex;
+    using size_type = std::size_t;
+    using mask_type = std::uint64_t;
+    using tick_type = std::uint32_t;
+
+    static constexpr size_type component_count = sizeof...(Components);
+    static constexpr size_type chunk_rows = 256;
+
+    template<typename T>
+    [[nodiscard]] static consteval size_type component_index() {
+        constexpr auto i = detail::type_index<std::remove_cvref_t<T>, Components...>();
+        static_assert(i < component_count, "type is not a component of this DenseWorld");
+        return i;
+    }
+
+    template<typename... Ts>
+    static constexpr mask_type mask_of = (mask_type{0} | ... | (mask_type{1} << component_index<Ts>()));
+
+private:
+    struct ArchetypeTag {};
+    using ArchetypeIndex = StrongIndex<ArchetypeTag, std::uint32_t>;
+
+    struct Archetype {
+        mask_type mask = 0;
+        std::vector<EntityIndex> entities;
+        std::tuple<std::vector<Components>...> columns;
+        std::vector<std::array<tick_type, component_count>> ticks;  // per chunk, per component
+
+        [[nodiscard]] size_type size() const noexcept { return entities.size(); }
+        [[nodiscard]] size_type chunk_count() const noexcept { return (size() + chunk_rows - 1) / chunk_rows; }
+    };
+
+    struct Record {
+        ArchetypeIndex archetype{};
+        size_type row = 0;
+        bool alive = false;
+    };
+
+    DenseVector<Archetype, ArchetypeIndex> archetypes_;
+    std::unordered_map<mask_type, ArchetypeIndex> by_mask_;
+    DenseVector<Record, EntityIndex> records_;
+    std::vector<EntityIndex> free_;
+    size_type alive_ = 0;
+    tick_type tick_ = 1;
+
+    // Invoke f(std::integral_constant<size_type, I>) for every component bit in mask
+    template<typename F>
+    static void for_each_component(mask_type mask, F&& f) {
+        [&]<size_type... I>(std::index_sequence<I...>) {
+            ((((mask >> I) & 1) != 0 ? f(std::integral_constant<size_type, I>{}) : void()), ...);
+        }(std::make_index_sequence<component_count>{});
+    }
+
+    [[nodiscard]] ArchetypeIndex archetype_for(mask_type mask) {
+        if (auto it = by_mask_.find(mask); it != by_mask_.end()) return it->second;
+        auto idx = archetypes_.emplace_back();
+        archetypes_[idx].mask = mask;
+        by_mask_.emplace(mask, idx);
+        return idx;
+    }
+
+    [[nodiscard]] Record& record(EntityIndex e, const char* what) {
+        if (get_index_value(e) >= records_.size() || !records_[e].alive) throw std::out_of_range(what);
+        return records_[e];
+    }
+
+    [[nodiscard]] const Record& record(EntityIndex e, const char* what) const {
+        if (get_index_value(e) >= records_.size() || !records_[e].alive) throw std::out_of_range(what);
+        return records_[e];
+    }
+
+    void mark(Archetype& a, size_type row, mask_type mask) noexcept {
+        auto& chunk = a.ticks[row / chunk_rows];
+        for_each_component(mask, [&](auto i) { chunk[i] = tick_; });
+    }
+
+    // Registers a row whose components were already appended to the columns
+    size_type append_row(Archetype& a, EntityIndex e) {
+        a.entities.push_back(e);
+        a.ticks.resize(a.chunk_count());
+        const auto row = a.size() - 1;
+        mark(a, row, a.mask);
+        return row;
+    }
+
+    // Swap-remove a row; the entity moved into the hole keeps a valid record
+    void remove_row(Archetype& a, size_type row) {
+        const auto last = a.size() - 1;
+        if (row != last) {
+            for_each_component(a.mask, [&](auto i) {
+                auto& column = std::get<i>(a.columns);
+                column[row] = std::move(column[last]);
+            });
+            a.entities[row] = a.entities[last];
+            records_[a.entities[row]].row = row;
+            mark(a, row, a.mask);
+        }
+        for_each_component(a.mask, [&](auto i) { std::get<i>(a.columns).pop_back(); });
+        a.entities.pop_back();
+        a.ticks.resize(a.chunk_count());
+    }
+
+    // Move an entity to the archetype for new_mask, carrying the components
+    // both archetypes share; `extra` appends any component the target adds
+    template<typename Extra>
+    void relocate(EntityIndex e, Record& rec, mask_type new_mask, Extra&& extra) {
+        const auto from = rec.archetype;
+        const auto to = archetype_for(new_mask);
+        auto& src = archetypes_[from];
+        auto& dst = archetypes_[to];
+        for_each_component(src.mask & dst.mask, [&](auto i) {
+            std::get<i>(dst.columns).push_back(std::move(std::get<i>(src.columns)[rec.row]));
+        });
+        extra(dst);
+        const auto row = append_row(dst, e);
+        remove_row(src, rec.row);
+        rec.archetype = to;
+        rec.row = row;
+    }
+
+public:
+    // Packed columns of one archetype chunk. Ts are the queried component types;
+    // const-qualified types give read-only spans.
+    template<typename... Ts>
+    class Chunk {
+        std::span<const EntityIndex> entities_;
+        std::tuple<std::span<Ts>...> columns_;
+
+    public:
+        Chunk(std::span<const EntityIndex> entities, std::span<Ts>... columns) noexcept
+            : entities_(entities), columns_(columns...) {}
+
+        [[nodiscard]] size_type size() const noexcept { return entities_.size(); }
+        [[nodiscard]] std::span<const EntityIndex> entities() const noexcept { return entities_; }
+
+        template<typename T>
+        [[nodiscard]] auto get() const noexcept {
+            constexpr auto i = detail::type_index<std::remove_const_t<T>, std::remove_const_t<Ts>...>();
+            static_assert(i < sizeof...(Ts), "component is not part of this query");
+            return std::get<i>(columns_);
+        }
+
+        [[nodiscard]] const std::tuple<std::span<Ts>...>& columns() const noexcept { return columns_; }
+    };
+
+    // Entities owning every component in Ts. Non-const Ts count as writes and
+    // stamp the visited chunks with the current tick.
+    template<typename... Ts>
+    class Query {
+        static constexpr mask_type required_ = mask_of<Ts...>;
+        static constexpr mask_type writes_ = (mask_type{0} | ... | (std::is_const_v<Ts> ? 0 : mask_of<Ts>));
+
+        DenseWorld* world_;
+        mask_type excluded_ = 0;
+        mask_type changed_ = 0;
+        tick_type since_ = 0;
+
+        [[nodiscard]] bool matches(const Archetype& a) const noexcept {
+            return (a.mask & required_) == required_ && (a.mask & excluded_) == 0 && a.size() > 0;
+        }
+
+        [[nodiscard]] bool changed(const Archetype& a, size_type chunk) const noexcept {
+            bool all = true;
+            for_each_component(changed_, [&](auto i) { all = all && a.ticks[chunk][i] > since_; });
+            return all;
+        }
+
+        [[nodiscard]] Chunk<Ts...> make_chunk(Archetype& a, size_type chunk) const {
+            const auto first = chunk * chunk_rows;
+            const auto count = std::min(chunk_rows, a.size() - first);
+            auto column = [&]<typename T>(std::type_identity<T>) {
+                return std::span<T>(std::get<component_index<T>()>(a.columns).data() + first, count);
+            };
+            return Chunk<Ts...>(std::span<const EntityIndex>(a.entities.data() + first, count),
+                                column(std::type_identity<Ts>{})...);
+        }
+
+        // Visit matching chunks in order, stamping write ticks first
+        template<typename F>
+        void visit(F&& f) const {
+            for (auto& a : world_->archetypes_) {
+                if (!matches(a)) continue;
+                for (size_type c = 0; c < a.chunk_count(); ++c) {
+                    if (!changed(a, c)) continue;
+                    for_each_component(writes_, [&](auto i) { a.ticks[c][i] = world_->tick_; });
+                    f(a, c);
+                }
+            }
+        }
+
+    public:
+        explicit Query(DenseWorld& world) noexcept : world_(&world) {}
+
+        // Skip entities that own any of Us
+        template<typename... Us>
+        Query& without() noexcept {
+            excluded_ |= mask_of<Us...>;
+            return *this;
+        }
+
+        // Only visit chunks where every U was written after `tick`
+        template<typename... Us>
+        Query& changed_since(tick_type tick) noexcept {
+            changed_ |= mask_of<Us...>;
+            since_ = tick;
+            return *this;
+        }
+
+        // Number of matching entities, ignoring change filters
+        [[nodiscard]] size_type count() const noexcept {
+            size_type total = 0;
+            for (const auto& a : world_->archetypes_) {
+                if (matches(a)) total += a.size();
+            }
+            return total;
+        }
+
+        // f(Chunk<Ts...>)
+        template<typename F>
+        void for_each_chunk(F&& f) const {
+            visit([&](Archetype& a, size_type c) { f(make_chunk(a, c)); });
+        }
+
+        // f(EntityIndex, Ts&...)
+        template<typename F>
+        void for_each(F&& f) const {
+            for_each_chunk([&](const Chunk<Ts...>& chunk) { run_rows(chunk, f); });
+        }
+
+        // Chunks are distributed over the scheduler; each chunk runs on one worker
+        template<typename F>
+        void parallel_for_each_chunk(F&& f, WorkStealingScheduler& scheduler = default_scheduler()) const {
+            using detail::ChunkIndex;
+            std::vector<Chunk<Ts...>> chunks;
+            visit([&](Archetype& a, size_type c) { chunks.push_back(make_chunk(a, c)); });
+            scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(chunks.size())),
+                [&](ChunkIndex c) { f(chunks[get_index_value(c)]); }, {.grain = 1, .affinity = std::nullopt});
+        }
+
+        template<typename F>
+        void parallel_for_each(F&& f, WorkStealingScheduler& scheduler = default_scheduler()) const {
+            parallel_for_each_chunk([&](const Chunk<Ts...>& chunk) { run_rows(chunk, f); }, scheduler);
+        }
+
+    private:
+        template<typename F>
+        static void run_rows(const Chunk<Ts...>& chunk, F& f) {
+            const auto entities = chunk.entities();
+            std::apply([&](const auto&... columns) {
+                for (size_type i = 0; i < chunk.size(); ++i) f(entities[i], columns[i]...);
+            }, chunk.columns());
+        }
+    };
+
+    // Constructors
+    DenseWorld() = default;
+
+    // Entities
+    template<typename... Ts>
+    [[nodiscard]] EntityIndex create(Ts&&... components) {
+        constexpr auto mask = mask_of<Ts...>;
+        static_assert(std::popcount(mask) == sizeof...(Ts), "duplicate component type");
+
+        EntityIndex e{};
+        if (free_.empty()) {
+            e = records_.push_back(Record{});
+        } else {
+            e = free_.back();
+            free_.pop_back();
+        }
+        const auto idx = archetype_for(mask);
+        auto& a = archetypes_[idx];
+        (std::get<component_index<Ts>()>(a.columns).push_back(std::forward<Ts>(components)), ...);
+        records_[e] = Record{idx, append_row(a, e), true};
+        ++alive_;
+        return e;
+    }
+
+    // Destroyed indices are reused by later create() calls
+    void destroy(EntityIndex e) {
+        auto& rec = record(e, "DenseWorld::destroy");
+        remove_row(archetypes_[rec.archetype], rec.row);
+        rec.alive = false;
+        free_.push_back(e);
+        --alive_;
+    }
+
+    [[nodiscard]] bool alive(EntityIndex e) const noexcept {
+        return get_index_value(e) < records_.size() && records_[e].alive;
+    }
+
+    [[nodiscard]] size_type size() const noexcept { return alive_; }
+    [[nodiscard]] bool empty() const noexcept { return alive_ == 0; }
+    [[nodiscard]] size_type archetype_count() const noexcept { return archetypes_.size(); }
+
+    // Components
+    template<typename T>
+    [[nodiscard]] bool has(EntityIndex e) const {
+        return (archetypes_[record(e, "DenseWorld::has").archetype].mask & mask_of<T>) != 0;
+    }
+
+    // Write access stamps the entity's chunk with the current tick
+    template<typename T>
+    [[nodiscard]] T& get(EntityIndex e) {
+        const auto& rec = record(e, "DenseWorld::get");
+        auto& a = archetypes_[rec.archetype];
+        if ((a.mask & mask_of<T>) == 0) throw std::out_of_range("DenseWorld::get");
+        mark(a, rec.row, mask_of<T>);
+        return std::get<component_index<T>()>(a.columns)[rec.row];
+    }
+
+    template<typename T>
+    [[nodiscard]] const T& get(EntityIndex e) const {
+        const auto& rec = record(e, "DenseWorld::get");
+        const auto& a = archetypes_[rec.archetype];
+        if ((a.mask & mask_of<T>) == 0) throw std::out_of_range("DenseWorld::get");
+        return std::get<component_index<T>()>(a.columns)[rec.row];
+    }
+
+    // Add a component (moving the entity to a new archetype) or overwrite it
+    template<typename T, typename... Args>
+    T& emplace(EntityIndex e, Args&&... args) {
+        auto& rec = record(e, "DenseWorld::emplace");
+        constexpr auto i = component_index<T>();
+        if ((archetypes_[rec.archetype].mask & mask_of<T>) != 0) {
+            auto& value = get<T>(e);
+            value = T(std::forward<Args>(args)...);
+            return value;
+        }
+        relocate(e, rec, archetypes_[rec.archetype].mask | mask_of<T>, [&](Archetype& dst) {
+            std::get<i>(dst.columns).emplace_back(std::forward<Args>(args)...);
+        });
+        return std::get<i>(archetypes_[rec.archetype].columns)[rec.row];
+    }
+
+    // Remove a component; false if the entity did not own it
+    template<typename T>
+    bool remove(EntityIndex e) {
+        auto& rec = record(e, "DenseWorld::remove");
+        const auto mask = archetypes_[rec.archetype].mask;
+        if ((mask & mask_of<T>) == 0) return false;
+        relocate(e, rec, mask & ~mask_of<T>, [](Archetype&) {});
+        return true;
+    }
+
+    // Queries
+    template<typename... Ts>
+    [[nodiscard]] Query<Ts...> query() noexcept {
+        static_assert(sizeof...(Ts) > 0, "query needs at least one component type");
+        return Query<Ts...>(*this);
+    }
+
+    // Change ticks: writes are stamped with tick(); advance_tick() starts a new one
+    [[nodiscard]] tick_type tick() const noexcept { return tick_; }
+    tick_type advance_tick() noexcept { return ++tick_; }
+};
+
+// Point in 3D space; 2D users leave z at 0
+struct Point3 {
+    float x = 0;
+    float y = 0;
+    float z = 0;
+
+    [[nodiscard]] bool operator==(const Point3&) const noexcept = default;
+};
+
+// Axis-aligned box, inclusive on both ends
+struct Box3 {
+    Point3 min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    Point3 max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+    [[nodiscard]] static Box3 around(Point3 center, float radius) noexcept {
+        return {{center.x - radius, center.y - radius, center.z - radius},
+                {center.x + radius, center.y + radius, center.z + radius}};
+    }
+
+    [[nodiscard]] bool contains(Point3 p) const noexcept {
+        return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+    }
+
+    [[nodiscard]] bool overlaps(const Box3& b) const noexcept {
+        return min.x <= b.max.x && b.min.x <= max.x && min.y <= b.max.y && b.min.y <= max.y &&
+               min.z <= b.max.z && b.min.z <= max.z;
+    }
+
+    void expand(Point3 p) noexcept {
+        min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+        max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+    }
+
+    void expand(const Box3& b) noexcept {
+        expand(b.min);
+        expand(b.max);
+    }
+};
+
+// Anything with float-convertible x, y and z members, e.g. a Transform component
+template<typename P>
+concept SpatialPoint = requires(const P& p) {
+    { p.x } -> std::convertible_to<float>;
+    { p.y } -> std::convertible_to<float>;
+    { p.z } -> std::convertible_to<float>;
+};
+
+namespace detail {
+
+template<SpatialPoint P>
+[[nodiscard]] Point3 to_point3(const P& p) noexcept {
+    return {static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z)};
+}
+
+[[nodiscard]] inline float distance_squared(Point3 a, Point3 b) noexcept {
+    const auto dx = a.x - b.x;
+    const auto dy = a.y - b.y;
+    const auto dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+[[nodiscard]] inline float distance_squared(const Box3& box, Point3 p) noexcept {
+    const auto dx = std::max({box.min.x - p.x, 0.0f, p.x - box.max.x});
+    const auto dy = std::max({box.min.y - p.y, 0.0f, p.y - box.max.y});
+    const auto dz = std::max({box.min.z - p.z, 0.0f, p.z - box.max.z});
+    return dx * dx + dy * dy + dz * dz;
+}
+
+struct BucketTag {};
+using BucketIndex = StrongIndex<BucketTag, std::uint32_t>;
+
+} // namespace detail
+
+// Uniform grid over points, hashed into a bucket table so the world needs no
+// bounds. Points are counting-sorted by bucket and copied next to their
+// indices, so a query reads a few contiguous runs. update() keeps a point in
+// place while it stays in its cell and otherwise parks it in a short side
+// list; the grid re-sorts itself once that list passes size() / 16.
+template<StrongIndexType IndexType>
+class DenseSpatialGrid {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+
+    struct Cell {
+        std::int32_t x, y, z;
+        [[nodiscard]] bool operator==(const Cell&) const noexcept = default;
+    };
+
+    struct Moved {
+        rep_type index;
+        Point3 position;
+    };
+
+    float cell_size_;
+    float inv_cell_;
+    size_type mask_ = 0;
+    std::vector<size_type> bucket_start_;  // mask_ + 2 entries once built
+    std::vector<rep_type> items_;          // indices sorted by bucket
+    std::vector<Point3> points_;           // their positions; x is NaN once moved out
+    std::vector<size_type> slot_of_;       // index -> slot in items_, or items_.size() + position in moved_
+    std::vector<Moved> moved_;
+
+    // Cell coordinate along one axis; far-out values clamp to the int32 range and NaN lands in cell 0
+    [[nodiscard]] std::int32_t coord_of(float v) const noexcept {
+        constexpr auto lowest = static_cast<float>(std::numeric_limits<std::int32_t>::min());  // -2^31, exact
+        const auto c = std::floor(v * inv_cell_);
+        if (std::isnan(c)) return 0;
+        if (c < lowest) return std::numeric_limits<std::int32_t>::min();
+        if (c >= -lowest) return std::numeric_limits<std::int32_t>::max();
+        return static_cast<std::int32_t>(c);
+    }
+
+    [[nodiscard]] Cell cell_of(Point3 p) const noexcept { return {coord_of(p.x), coord_of(p.y), coord_of(p.z)}; }
+
+    [[nodiscard]] size_type bucket_of(Cell c) const noexcept {
+        const auto h = (static_cast<std::uint32_t>(c.x) * 73856093u) ^ (static_cast<std::uint32_t>(c.y) * 19349663u) ^
+                       (static_cast<std::uint32_t>(c.z) * 83492791u);
+        return h & mask_;
+    }
+
+    [[nodiscard]] bool in_grid(size_type slot) const noexcept { return slot < items_.size(); }
+
+    void compact(WorkStealingScheduler& scheduler) {
+        std::vector<Point3> positions(slot_of_.size());
+        for (size_type i = 0; i < positions.size(); ++i) {
+            const auto slot = slot_of_[i];
+            positions[i] = in_grid(slot) ? points_[slot] : moved_[slot - items_.size()].position;
+        }
+        build(positions.size(), [&](IndexType i) { return positions[get_index_value(i)]; }, scheduler);
+    }
+
+    // Visit every live grid entry in the cells overlapping `box`
+    template<typename F>
+    void visit_cells(const Box3& box, F&& f) const {
+        if (items_.empty()) return;
+        const auto lo = cell_of(box.min);
+        const auto hi = cell_of(box.max);
+        const auto span = [](std::int32_t a, std::int32_t b) { return static_cast<std::uint64_t>(std::int64_t{b} - a + 1); };
+        const auto cells = span(lo.x, hi.x) * span(lo.y, hi.y) * span(lo.z, hi.z);
+        if (cells > mask_ + 1) {
+            for (size_type s = 0; s < items_.size(); ++s) f(s);
+            return;
+        }
+        // 64-bit counters so a range ending at the int32 maximum terminates
+        for (std::int64_t z = lo.z; z <= hi.z; ++z) {
+            for (std::int64_t y = lo.y; y <= hi.y; ++y) {
+                for (std::int64_t x = lo.x; x <= hi.x; ++x) {
+                    const Cell cell{static_cast<std::int32_t>(x), static_cast<std::int32_t>(y),
+                                    static_cast<std::int32_t>(z)};
+                    const auto b = bucket_of(cell);
+                    for (auto s = bucket_start_[b]; s < bucket_start_[b + 1]; ++s) {
+                        // Other cells hashed to this bucket are skipped; moved-out slots hold NaN and fail the test
+                        if (!std::isnan(points_[s].x) && cell_of(points_[s]) == cell) f(s);
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    // Constructors
+    explicit DenseSpatialGrid(float cell_size) : cell_size_(cell_size), inv_cell_(1.0f / cell_size) {
+        if (!(cell_size > 0)) throw std::invalid_argument("DenseSpatialGrid::DenseSpatialGrid");
+    }
+
+    // Build from pos(IndexType) for every index in [0, count)
+    template<typename PosFn>
+        requires SpatialPoint<std::invoke_result_t<PosFn&, IndexType>>
+    void build(size_type count, PosFn pos, WorkStealingScheduler& scheduler = default_scheduler()) {
+        using detail::BucketIndex;
+        using detail::ChunkIndex;
+        const IndexRange<ChunkIndex> all(ChunkIndex(0), ChunkIndex(count));
+        const ParallelForOptions chunked{.grain = 4096, .affinity = std::nullopt};
+
+        mask_ = std::bit_ceil(std::max<size_type>(count, 1)) - 1;
+        std::vector<Point3> positions(count);
+        std::vector<BucketIndex> buckets(count);
+        scheduler.parallel_for_chunks(all, [&](IndexRange<ChunkIndex> chunk) {
+            for (auto c : chunk) {
+                const auto i = get_index_value(c);
+                positions[i] = detail::to_point3(std::invoke(pos, IndexType(i)));
+                buckets[i] = BucketIndex(bucket_of(cell_of(positions[i])));
+            }
+        }, chunked);
+
+        const auto counts = parallel_histogram(buckets, std::identity{}, mask_ + 1, scheduler);
+        bucket_start_.assign(mask_ + 2, 0);
+        for (size_type b = 0; b <= mask_; ++b) bucket_start_[b + 1] = bucket_start_[b] + counts.data()[b];
+
+        // Scatter; slots within a bucket are claimed atomically
+        std::vector<size_type> cursor(bucket_start_.begin(), bucket_start_.end() - 1);
+        items_.resize(count);
+        points_.resize(count);
+        slot_of_.resize(count);
+        moved_.clear();
+        scheduler.parallel_for_chunks(all, [&](IndexRange<ChunkIndex> chunk) {
+            for (auto c : chunk) {
+                const auto i = get_index_value(c);
+                const auto slot = std::atomic_ref<size_type>(cursor[get_index_value(buckets[i])]).fetch_add(1, std::memory_order_relaxed);
+                items_[slot] = static_cast<rep_type>(i);
+                points_[slot] = positions[i];
+                slot_of_[i] = slot;
+            }
+        }, chunked);
+    }
+
+    template<typename Container, typename Proj = std::identity>
+        requires std::same_as<typename Container::index_type, IndexType>
+    void build(const Container& container, Proj proj = {}, WorkStealingScheduler& scheduler = default_scheduler()) {
+        build(container.size(), [&](IndexType i) { return std::invoke(proj, container[i]); }, scheduler);
+    }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return slot_of_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return slot_of_.empty(); }
+    [[nodiscard]] float cell_size() const noexcept { return cell_size_; }
+    [[nodiscard]] size_type moved_count() const noexcept { return moved_.size(); }
+
+    [[nodiscard]] Point3 position(IndexType idx) const noexcept {
+        const auto slot = slot_of_[get_index_value(idx)];
+        return in_grid(slot) ? points_[slot] : moved_[slot - items_.size()].position;
+    }
+
+    // Incremental updates
+    template<SpatialPoint P>
+    void update(IndexType idx, const P& p, WorkStealingScheduler& scheduler = default_scheduler()) {
+        const auto position = detail::to_point3(p);
+        auto& slot = slot_of_[get_index_value(idx)];
+        if (!in_grid(slot)) {
+            moved_[slot - items_.size()].position = position;
+            return;
+        }
+        if (cell_of(points_[slot]) == cell_of(position)) {
+            points_[slot] = position;
+            return;
+        }
+        points_[slot].x = std::numeric_limits<float>::quiet_NaN();
+        slot = items_.size() + moved_.size();
+        moved_.push_back({static_cast<rep_type>(get_index_value(idx)), position});
+        if (moved_.size() > std::max<size_type>(64, size() / 16)) compact(scheduler);
+    }
+
+    // Re-read every position in parallel; points that stay in their cell are
+    // updated in place and only cell changes go through update()
+    template<typename PosFn>
+        requires SpatialPoint<std::invoke_result_t<PosFn&, IndexType>>
+    void update_all(PosFn pos, WorkStealingScheduler& scheduler = default_scheduler()) {
+        using detail::ChunkIndex;
+        std::vector<std::vector<Moved>> changed(scheduler.worker_count());
+        scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(size())),
+            [&](IndexRange<ChunkIndex> chunk) {
+                auto& local = changed[*scheduler.current_worker()];
+                for (auto c : chunk) {
+                    const auto i = get_index_value(c);
+                    const auto p = detail::to_point3(std::invoke(pos, IndexType(i)));
+                    const auto slot = slot_of_[i];
+                    if (in_grid(slot) && cell_of(points_[slot]) == cell_of(p)) {
+                        points_[slot] = p;
+                    } else {
+                        local.push_back({static_cast<rep_type>(i), p});
+                    }
+                }
+            }, {.grain = 4096, .affinity = std::nullopt});
+        for (const auto& local : changed) {
+            for (const auto& m : local) update(IndexType(static_cast<std::size_t>(m.index)), m.position, scheduler);
+        }
+    }
+
+    // Queries: f(IndexType) for every point inside the box or sphere
+    template<typename F>
+    void for_each_in_box(const Box3& box, F&& f) const {
+        visit_cells(box, [&](size_type s) {
+            if (box.contains(points_[s])) f(IndexType(static_cast<std::size_t>(items_[s])));
+        });
+        for (const auto& m : moved_) {
+            if (box.contains(m.position)) f(IndexType(static_cast<std::size_t>(m.index)));
+        }
+    }
+
+    template<SpatialPoint P, typename F>
+    void for_each_in_radius(const P& center, float radius, F&& f) const {
+        const auto c = detail::to_point3(center);
+        const auto r2 = radius * radius;
+        visit_cells(Box3::around(c, radius), [&](size_type s) {
+            if (detail::distance_squared(points_[s], c) <= r2) f(IndexType(static_cast<std::size_t>(items_[s])));
+        });
+        for (const auto& m : moved_) {
+            if (detail::distance_squared(m.position, c) <= r2) f(IndexType(static_cast<std::size_t>(m.index)));
+        }
+    }
+
+    [[nodiscard]] std::vector<IndexType> query_box(const Box3& box) const {
+        std::vector<IndexType> result;
+        for_each_in_box(box, [&](IndexType i) { result.push_back(i); });
+        return result;
+    }
+
+    template<SpatialPoint P>
+    [[nodiscard]] std::vector<IndexType> query_radius(const P& center, float radius) const {
+        std::vector<IndexType> result;
+        for_each_in_radius(center, radius, [&](IndexType i) { result.push_back(i); });
+        return result;
+    }
+};
+
+// Static bounding volume hierarchy over points, built by median splits on the
+// longest axis. Nodes are laid out depth-first with the left child next to its
+// parent. refit() moves the points and recomputes bounds without rebuilding
+// the topology, which stays efficient while the points keep their layout.
+template<StrongIndexType IndexType>
+class DenseBvh {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+    static constexpr size_type leaf_size = 8;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+
+    struct Node {
+        Box3 bounds;
+        std::uint32_t first = 0;  // first item slot
+        std::uint32_t count = 0;  // items in the subtree
+        std::uint32_t right = 0;  // right child, or 0 for a leaf
+    };
+
+    static constexpr size_type parallel_cutoff = 4096;
+
+    std::vector<Node> nodes_;
+    std::vector<rep_type> items_;
+    std::vector<Point3> points_;
+
+    // Node counts of the subtrees holding n and n + 1 items
+    [[nodiscard]] static std::pair<size_type, size_type> subtree_nodes(size_type n) noexcept {
+        if (n <= leaf_size) return {1, n + 1 <= leaf_size ? 1 : 3};
+        const auto [a, b] = subtree_nodes(n / 2);
+        return n % 2 == 0 ? std::pair{1 + 2 * a, 1 + a + b} : std::pair{1 + a + b, 1 + 2 * b};
+    }
+
+    [[nodiscard]] Box3 leaf_bounds(size_type first, size_type count) const noexcept {
+        Box3 box;
+        for (auto s = first; s < first + count; ++s) box.expand(points_[s]);
+        return box;
+    }
+
+    // Run f(0) and f(1), in parallel for large subtrees
+    template<typename F>
+    static void both(size_type count, WorkStealingScheduler& scheduler, F&& f) {
+        using detail::ChunkIndex;
+        if (count < parallel_cutoff) {
+            f(0);
+            f(1);
+            return;
+        }
+        scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(2)),
+            [&](ChunkIndex side) { f(get_index_value(side)); }, {.grain = 1, .affinity = std::nullopt});
+    }
+
+    void build_node(size_type node, size_type first, size_type count, std::vector<std::pair<Point3, rep_type>>& prims,
+                    WorkStealingScheduler& scheduler) {
+        Box3 box;
+        for (auto s = first; s < first + count; ++s) box.expand(prims[s].first);
+        auto& n = nodes_[node];
+        n.bounds = box;
+        n.first = static_cast<std::uint32_t>(first);
+        n.count = static_cast<std::uint32_t>(count);
+        if (count <= leaf_size) {
+            for (auto s = first; s < first + count; ++s) {
+                points_[s] = prims[s].first;
+                items_[s] = prims[s].second;
+            }
+            return;
+        }
+
+        const Point3 extent{box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z};
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        const auto half = count / 2;
+        auto begin = prims.begin() + static_cast<std::ptrdiff_t>(first);
+        std::nth_element(begin, begin + static_cast<std::ptrdiff_t>(half), begin + static_cast<std::ptrdiff_t>(count),
+            [axis](const auto& a, const auto& b) {
+                return axis == 0 ? a.first.x < b.first.x : (axis == 1 ? a.first.y < b.first.y : a.first.z < b.first.z);
+            });
+        n.right = static_cast<std::uint32_t>(node + 1 + subtree_nodes(half).first);
+        const auto right = n.right;
+        both(count, scheduler, [&](size_type side) {
+            if (side == 0) {
+                build_node(node + 1, first, half, prims, scheduler);
+            } else {
+                build_node(right, first + half, count - half, prims, scheduler);
+            }
+        });
+    }
+
+    template<typename PosFn>
+    void refit_node(size_type node, PosFn& pos, WorkStealingScheduler& scheduler) {
+        auto& n = nodes_[node];
+        if (n.right == 0) {
+            for (auto s = n.first; s < n.first + n.count; ++s) {
+                points_[s] = detail::to_point3(std::invoke(pos, IndexType(static_cast<std::size_t>(items_[s]))));
+            }
+            n.bounds = leaf_bounds(n.first, n.count);
+            return;
+        }
+        both(n.count, scheduler, [&](size_type side) { refit_node(side == 0 ? node + 1 : n.right, pos, scheduler); });
+        n.bounds = nodes_[node + 1].bounds;
+        n.bounds.expand(nodes_[n.right].bounds);
+    }
+
+    // Depth-first traversal of the nodes accepted by `enter`; f(slot) per item of an accepted leaf
+    template<typename Enter, typename F>
+    void traverse(Enter&& enter, F&& f) const {
+        if (nodes_.empty()) return;
+        std::array<std::uint32_t, 64> stack;
+        std::size_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const auto& n = nodes_[stack[--top]];
+            if (!enter(n.bounds)) continue;
+            if (n.right == 0) {
+                for (auto s = n.first; s < n.first + n.count; ++s) f(s);
+            } else {
+                stack[top++] = n.right;
+                stack[top++] = static_cast<std::uint32_t>(&n - nodes_.data()) + 1;
+            }
+        }
+    }
+
+public:
+    DenseBvh() = default;
+
+    // Build from pos(IndexType) for every index in [0, count)
+    template<typename PosFn>
+        requires SpatialPoint<std::invoke_result_t<PosFn&, IndexType>>
+    void build(size_type count, PosFn pos, WorkStealingScheduler& scheduler = default_scheduler()) {
+        using detail::ChunkIndex;
+        if (count > std::numeric_limits<std::uint32_t>::max()) throw std::length_error("DenseBvh::build");
+        std::vector<std::pair<Point3, rep_type>> prims(count);
+        scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(count)), [&](ChunkIndex c) {
+            const auto i = get_index_value(c);
+            prims[i] = {detail::to_point3(std::invoke(pos, IndexType(i))), static_cast<rep_type>(i)};
+        }, {.grain = 4096, .affinity = std::nullopt});
+        items_.resize(count);
+        points_.resize(count);
+        nodes_.assign(count == 0 ? 0 : subtree_nodes(count).first, Node{});
+        if (count > 0) build_node(0, 0, count, prims, scheduler);
+    }
+
+    template<typename Container, typename Proj = std::identity>
+        requires std::same_as<typename Container::index_type, IndexType>
+    void build(const Container& container, Proj proj = {}, WorkStealingScheduler& scheduler = default_scheduler()) {
+        build(container.size(), [&](IndexType i) { return std::invoke(proj, container[i]); }, scheduler);
+    }
+
+    // Re-read all positions and recompute the bounds bottom-up
+    template<typename PosFn>
+        requires SpatialPoint<std::invoke_result_t<PosFn&, IndexType>>
+    void refit(PosFn pos, WorkStealingScheduler& scheduler = default_scheduler()) {
+        if (!nodes_.empty()) refit_node(0, pos, scheduler);
+    }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return items_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return items_.empty(); }
+    [[nodiscard]] size_type node_count() const noexcept { return nodes_.size(); }
+    [[nodiscard]] Box3 bounds() const noexcept { return nodes_.empty() ? Box3{} : nodes_[0].bounds; }
+
+    // Queries: f(IndexType) for every point inside the box or sphere
+    template<typename F>
+    void for_each_in_box(const Box3& box, F&& f) const {
+        traverse([&](const Box3& b) { return b.overlaps(box); }, [&](size_type s) {
+            if (box.contains(points_[s])) f(IndexType(static_cast<std::size_t>(items_[s])));
+        });
+    }
+
+    template<SpatialPoint P, typename F>
+    void for_each_in_radius(const P& center, float radius, F&& f) const {
+        const auto c = detail::to_point3(center);
+        const auto r2 = radius * radius;
+        traverse([&](const Box3& b) { return detail::distance_squared(b, c) <= r2; }, [&](size_type s) {
+            if (detail::distance_squared(points_[s], c) <= r2) f(IndexType(static_cast<std::size_t>(items_[s])));
+        });
+    }
+
+    [[nodiscard]] std::vector<IndexType> query_box(const Box3& box) const {
+        std::vector<IndexType> result;
+        for_each_in_box(box, [&](IndexType i) { result.push_back(i); });
+        return result;
+    }
+
+    template<SpatialPoint P>
+    [[nodiscard]] std::vector<IndexType> query_radius(const P& center, float radius) const {
+        std::vector<IndexType> result;
+        for_each_in_radius(center, radius, [&](IndexType i) { result.push_back(i); });
+        return result;
+    }
+};
+
+// Multidimensional extents, mirroring std::extents<std::size_t, Exts...>:
+// each extent is a compile-time constant or std::dynamic_extent
+template<std::size_t... Exts>
+class extents {
+public:
+    using size_type = std::size_t;
+    using rank_type = std::size_t;
+
+    static constexpr rank_type rank_value = sizeof...(Exts);
+    static constexpr rank_type rank_dynamic_value = ((Exts == std::dynamic_extent ? 1 : 0) + ... + 0);
+
+private:
+    static constexpr std::array<size_type, rank_value> static_ = {Exts...};
+    std::array<size_type, rank_value> extents_ = {(Exts == std::dynamic_extent ? 0 : Exts)...};
+
+public:
+    constexpr extents() noexcept = default;
+
+    // Either the dynamic extents only, or every extent
+    template<std::convertible_to<size_type>... Sizes>
+        requires(sizeof...(Sizes) > 0 && (sizeof...(Sizes) == rank_dynamic_value || sizeof...(Sizes) == rank_value))
+    constexpr explicit extents(Sizes... sizes) noexcept {
+        const std::array<size_type, sizeof...(Sizes)> given{static_cast<size_type>(sizes)...};
+        if constexpr (sizeof...(Sizes) == rank_value) {
+            extents_ = given;
+        } else {
+            for (rank_type r = 0, d = 0; r < rank_value; ++r) {
+                if (static_[r] == std::dynamic_extent) extents_[r] = given[d++];
+            }
+        }
+    }
+
+    [[nodiscard]] static constexpr rank_type rank() noexcept { return rank_value; }
+    [[nodiscard]] static constexpr rank_type rank_dynamic() noexcept { return rank_dynamic_value; }
+    [[nodiscard]] static constexpr size_type static_extent(rank_type r) noexcept { return static_[r]; }
+    [[nodiscard]] constexpr size_type extent(rank_type r) const noexcept { return extents_[r]; }
+
+    [[nodiscard]] constexpr size_type size() const noexcept {
+        size_type n = 1;
+        for (auto e : extents_) n *= e;
+        return n;
+    }
+
+    [[nodiscard]] constexpr bool operator==(const extents&) const noexcept = default;
+};
+
+namespace detail {
+
+template<std::size_t Rank, typename Seq = std::make_index_sequence<Rank>>
+struct dynamic_extents;
+
+template<std::size_t Rank, std::size_t... I>
+struct dynamic_extents<Rank, std::index_sequence<I...>> {
+    using type = extents<(static_cast<void>(I), std::dynamic_extent)...>;
+};
+
+} // namespace detail
+
+// Extents with every extent dynamic
+template<std::size_t Rank>
+using dextents = typename detail::dynamic_extents<Rank>::type;
+
+// Layout mappings turn a multi-index into an offset. Each mapping exposes
+// extents(), operator()(std::array<size_t, rank>), required_span_size(), and
+// stride(r) when is_strided().
+
+// Last index varies fastest (C order)
+struct layout_right {
+    template<typename Extents>
+    class mapping {
+        Extents extents_;
+
+    public:
+        using extents_type = Extents;
+        static constexpr std::size_t rank = Extents::rank();
+
+        constexpr mapping() noexcept = default;
+        constexpr explicit mapping(const Extents& e) noexcept : extents_(e) {}
+
+        [[nodiscard]] constexpr const Extents& extents() const noexcept { return extents_; }
+        [[nodiscard]] static constexpr bool is_strided() noexcept { return true; }
+
+        [[nodiscard]] constexpr std::size_t operator()(const std::array<std::size_t, rank>& idx) const noexcept {
+            std::size_t offset = 0;
+            for (std::size_t r = 0; r < rank; ++r) offset = offset * extents_.extent(r) + idx[r];
+            return offset;
+        }
+
+        [[nodiscard]] constexpr std::size_t stride(std::size_t r) const noexcept {
+            std::size_t s = 1;
+            for (auto k = r + 1; k < rank; ++k) s *= extents_.extent(k);
+            return s;
+        }
+
+        [[nodiscard]] constexpr std::size_t required_span_size() const noexcept { return extents_.size(); }
+    };
+};
+
+// First index varies fastest (Fortran order)
+struct layout_left {
+    template<typename Extents>
+    class mapping {
+        Extents extents_;
+
+    public:
+        using extents_type = Extents;
+        static constexpr std::size_t rank = Extents::rank();
+
+        constexpr mapping() noexcept = default;
+        constexpr explicit mapping(const Extents& e) noexcept : extents_(e) {}
+
+        [[nodiscard]] constexpr const Extents& extents() const noexcept { return extents_; }
+        [[nodiscard]] static constexpr bool is_strided() noexcept { return true; }
+
+        [[nodiscard]] constexpr std::size_t operator()(const std::array<std::size_t, rank>& idx) const noexcept {
+            std::size_t offset = 0;
+            for (std::size_t r = rank; r-- > 0;) offset = offset * extents_.extent(r) + idx[r];
+            return offset;
+        }
+
+        [[nodiscard]] constexpr std::size_t stride(std::size_t r) const noexcept {
+            std::size_t s = 1;
+            for (std::size_t k = 0; k < r; ++k) s *= extents_.extent(k);
+            return s;
+        }
+
+        [[nodiscard]] constexpr std::size_t required_span_size() const noexcept { return extents_.size(); }
+    };
+};
+
+// Arbitrary per-axis strides, as produced by slicing
+struct layout_stride {
+    template<typename Extents>
+    class mapping {
+    public:
+        using extents_type = Extents;
+        static constexpr std::size_t rank = Extents::rank();
+
+    private:
+        Extents extents_;
+        std::array<std::size_t, rank> strides_{};
+
+    public:
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const Extents& e, const std::array<std::size_t, rank>& strides) noexcept
+            : extents_(e), strides_(strides) {}
+
+        [[nodiscard]] constexpr const Extents& extents() const noexcept { return extents_; }
+        [[nodiscard]] static constexpr bool is_strided() noexcept { return true; }
+        [[nodiscard]] constexpr std::size_t stride(std::size_t r) const noexcept { return strides_[r]; }
+
+        [[nodiscard]] constexpr std::size_t operator()(const std::array<std::size_t, rank>& idx) const noexcept {
+            std::size_t offset = 0;
+            for (std::size_t r = 0; r < rank; ++r) offset += idx[r] * strides_[r];
+            return offset;
+        }
+
+        [[nodiscard]] constexpr std::size_t required_span_size() const noexcept {
+            std::size_t last = 0;
+            for (std::size_t r = 0; r < rank; ++r) {
+                if (extents_.extent(r) == 0) return 0;
+                last += (extents_.extent(r) - 1) * strides_[r];
+            }
+            return last + 1;
+        }
+    };
+};
+
+// Blocked layout: the index space is cut into Tile... sized tiles stored one
+// after another in C order, each tile itself in C order. Neighbors along every
+// axis then share cache lines, which suits stencils that sweep all axes.
+// Partial edge tiles are padded, so required_span_size() rounds each extent up.
+template<std::size_t... Tile>
+    requires((Tile > 0) && ...)
+struct layout_tiled {
+    template<typename Extents>
+    class mapping {
+        static_assert(sizeof...(Tile) == Extents::rank(), "layout_tiled needs one tile size per axis");
+        static constexpr std::array<std::size_t, sizeof...(Tile)> tile_ = {Tile...};
+        static constexpr std::size_t tile_volume = (Tile * ... * 1);
+
+        Extents extents_;
+
+        [[nodiscard]] constexpr std::size_t tiles(std::size_t r) const noexcept {
+            return (extents_.extent(r) + tile_[r] - 1) / tile_[r];
+        }
+
+    public:
+        using extents_type = Extents;
+        static constexpr std::size_t rank = Extents::rank();
+
+        constexpr mapping() noexcept = default;
+        constexpr explicit mapping(const Extents& e) noexcept : extents_(e) {}
+
+        [[nodiscard]] constexpr const Extents& extents() const noexcept { return extents_; }
+        [[nodiscard]] static constexpr bool is_strided() noexcept { return false; }
+
+        [[nodiscard]] constexpr std::size_t operator()(const std::array<std::size_t, rank>& idx) const noexcept {
+            std::size_t tile = 0;
+            std::size_t within = 0;
+            for (std::size_t r = 0; r < rank; ++r) {
+                tile = tile * tiles(r) + idx[r] / tile_[r];
+                within = within * tile_[r] + idx[r] % tile_[r];
+            }
+            return tile * tile_volume + within;
+        }
+
+        [[nodiscard]] constexpr std::size_t required_span_size() const noexcept {
+            std::size_t n = tile_volume;
+            for (std::size_t r = 0; r < rank; ++r) n *= tiles(r);
+            return rank == 0 || extents_.size() == 0 ? extents_.size() : n;
+        }
+    };
+};
+
+// Selects a whole axis when slicing
+struct full_extent_t {
+    explicit full_extent_t() = default;
+};
+inline constexpr full_extent_t full_extent{};
+
+// Non-owning multidimensional view whose axis r only accepts the r-th
+// AxisIndices type. m[i, j, k] computes the offset through Layout, so callers
+// never hand-compute linear offsets.
+template<typename T, typename Extents, typename Layout, StrongIndexType... AxisIndices>
+class DenseLayoutMdSpan {
+    static_assert(sizeof...(AxisIndices) == Extents::rank(), "one index type per axis");
+
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using extents_type = Extents;
+    using layout_type = Layout;
+    using mapping_type = typename Layout::template mapping<Extents>;
+    using size_type = std::size_t;
+    using reference = T&;
+
+    template<std::size_t Axis>
+    using axis_index_type = std::tuple_element_t<Axis, std::tuple<AxisIndices...>>;
+
+    static constexpr std::size_t rank = Extents::rank();
+
+private:
+    T* data_ = nullptr;
+    mapping_type mapping_;
+
+    [[nodiscard]] static constexpr std::array<size_type, rank> raw(AxisIndices... idx) noexcept {
+        return {get_index_value(idx)...};
+    }
+
+public:
+    // Constructors
+    constexpr DenseLayoutMdSpan() noexcept = default;
+    constexpr DenseLayoutMdSpan(T* data, const mapping_type& mapping) noexcept : data_(data), mapping_(mapping) {}
+
+    template<std::convertible_to<size_type>... Sizes>
+        requires std::constructible_from<mapping_type, Extents> && std::constructible_from<Extents, Sizes...>
+    constexpr explicit DenseLayoutMdSpan(T* data, Sizes... sizes) noexcept : data_(data), mapping_(Extents(sizes...)) {}
+
+    // Mutable to const conversion
+    template<typename U>
+        requires std::is_convertible_v<U (*)[], T (*)[]>
+    constexpr DenseLayoutMdSpan(const DenseLayoutMdSpan<U, Extents, Layout, AxisIndices...>& other) noexcept
+        : data_(other.data_handle()), mapping_(other.mapping()) {}
+
+    // Element access
+    [[nodiscard]] constexpr reference operator[](AxisIndices... idx) const noexcept { return data_[mapping_(raw(idx...))]; }
+
+    [[nodiscard]] constexpr reference at(AxisIndices... idx) const {
+        const auto i = raw(idx...);
+        for (size_type r = 0; r < rank; ++r) {
+            if (i[r] >= extent(r)) throw std::out_of_range("DenseMdSpan::at");
+        }
+        return data_[mapping_(i)];
+    }
+
+    // Shape
+    [[nodiscard]] constexpr size_type extent(size_type r) const noexcept { return mapping_.extents().extent(r); }
+    [[nodiscard]] constexpr const Extents& extents() const noexcept { return mapping_.extents(); }
+    [[nodiscard]] constexpr size_type size() const noexcept { return mapping_.extents().size(); }
+    [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] constexpr size_type stride(size_type r) const noexcept
+        requires(mapping_type::is_strided())
+    {
+        return mapping_.stride(r);
+    }
+
+    // Every index of one axis, typed
+    template<std::size_t Axis>
+    [[nodiscard]] constexpr IndexRange<axis_index_type<Axis>> axis() const {
+        using Index = axis_index_type<Axis>;
+        return IndexRange<Index>(Index(0), Index(extent(Axis)));
+    }
+
+    [[nodiscard]] constexpr T* data_handle() const noexcept { return data_; }
+    [[nodiscard]] constexpr const mapping_type& mapping() const noexcept { return mapping_; }
+    [[nodiscard]] constexpr size_type required_span_size() const noexcept { return mapping_.required_span_size(); }
+};
+
+template<typename T, typename Extents, StrongIndexType... AxisIndices>
+using DenseMdSpan = DenseLayoutMdSpan<T, Extents, layout_right, AxisIndices...>;
+
+namespace detail {
+
+// Axes kept by a slice: an index fixes its axis, a range or full_extent keeps it
+template<typename Slice, typename Axis>
+using kept_axis_t = std::conditional_t<std::is_same_v<std::remove_cvref_t<Slice>, Axis>, std::tuple<>, std::tuple<Axis>>;
+
+template<typename T, typename Kept>
+struct strided_mdspan;
+
+template<typename T, typename... Axes>
+struct strided_mdspan<T, std::tuple<Axes...>> {
+    using type = DenseLayoutMdSpan<T, dextents<sizeof...(Axes)>, layout_stride, Axes...>;
+};
+
+template<typename Slice, typename Axis>
+concept AxisSlice = std::is_same_v<std::remove_cvref_t<Slice>, Axis> || std::is_same_v<std::remove_cvref_t<Slice>, IndexRange<Axis>> ||
+                    std::is_same_v<std::remove_cvref_t<Slice>, full_extent_t>;
+
+} // namespace detail
+
+// Typed submdspan: per axis, an index of that axis fixes it, an IndexRange of
+// that axis narrows it, and full_extent keeps it. The result is a strided view
+// over the kept axes, in order.
+template<typename T, typename Extents, typename Layout, StrongIndexType... AxisIndices, typename... Slices>
+    requires(sizeof...(Slices) == sizeof...(AxisIndices) && (detail::AxisSlice<Slices, AxisIndices> && ...) &&
+             Layout::template mapping<Extents>::is_strided())
+[[nodiscard]] constexpr auto submdspan(const DenseLayoutMdSpan<T, Extents, Layout, AxisIndices...>& m, Slices... slices) {
+    using Kept = decltype(std::tuple_cat(std::declval<detail::kept_axis_t<Slices, AxisIndices>>()...));
+    using Result = typename detail::strided_mdspan<T, Kept>::type;
+    constexpr std::size_t kept_rank = std::tuple_size_v<Kept>;
+
+    std::array<std::size_t, sizeof...(AxisIndices)> first{};
+    std::array<std::size_t, kept_rank> sizes{};
+    std::array<std::size_t, kept_rank> strides{};
+    std::size_t axis = 0;
+    std::size_t kept = 0;
+    auto apply = [&]<typename Slice, typename Axis>(const Slice& slice, std::type_identity<Axis>) {
+        if constexpr (std::is_same_v<Slice, Axis>) {
+            first[axis] = get_index_value(slice);
+        } else {
+            if constexpr (std::is_same_v<Slice, IndexRange<Axis>>) {
+                first[axis] = get_index_value(slice.first());
+                sizes[kept] = slice.size();
+            } else {
+                sizes[kept] = m.extent(axis);
+            }
+            strides[kept++] = m.stride(axis);
+        }
+        ++axis;
+    };
+    (apply(slices, std::type_identity<AxisIndices>{}), ...);
+
+    const auto offset = m.mapping()(first);
+    const auto e = std::apply([](auto... s) { return dextents<kept_rank>(s...); }, sizes);
+    return Result(m.data_handle() + offset, typename Result::mapping_type(e, strides));
+}
+
+// Row-major matrix whose rows and columns are indexed by their own index
+// domains, so that m[r, c] with swapped or raw indices does not compile
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+class DenseMatrix {
+public:
+    using value_type = T;
+    using row_index_type = RowIndex;
+    using col_index_type = ColIndex;
+    using size_type = std::size_t;
+
+private:
+    size_type rows_ = 0;
+    size_type cols_ = 0;
+    std::vector<T> data_;
+
+public:
+    // Constructors
+    DenseMatrix() = default;
+    DenseMatrix(size_type rows, size_type cols, const T& value = T{}) : rows_(rows), cols_(cols), data_(rows * cols, value) {}
+
+    // Element access
+    [[nodiscard]] T& operator[](RowIndex r, ColIndex c) noexcept {
+        return data_[get_index_value(r) * cols_ + get_index_value(c)];
+    }
+
+    [[nodiscard]] const T& operator[](RowIndex r, ColIndex c) const noexcept {
+        return data_[get_index_value(r) * cols_ + get_index_value(c)];
+    }
+
+    [[nodiscard]] T& at(RowIndex r, ColIndex c) {
+        if (get_index_value(r) >= rows_ || get_index_value(c) >= cols_) throw std::out_of_range("DenseMatrix::at");
+        return (*this)[r, c];
+    }
+
+    [[nodiscard]] const T& at(RowIndex r, ColIndex c) const {
+        if (get_index_value(r) >= rows_ || get_index_value(c) >= cols_) throw std::out_of_range("DenseMatrix::at");
+        return (*this)[r, c];
+    }
+
+    [[nodiscard]] DenseSpan<T, ColIndex> row(RowIndex r) noexcept {
+        return DenseSpan<T, ColIndex>(data_.data() + get_index_value(r) * cols_, cols_);
+    }
+
+    [[nodiscard]] DenseSpan<const T, ColIndex> row(RowIndex r) const noexcept {
+        return DenseSpan<const T, ColIndex>(data_.data() + get_index_value(r) * cols_, cols_);
+    }
+
+    [[nodiscard]] T* data() noexcept { return data_.data(); }
+    [[nodiscard]] const T* data() const noexcept { return data_.data(); }
+
+    // Row-major mdspan view, for submdspan slicing
+    [[nodiscard]] DenseMdSpan<T, dextents<2>, RowIndex, ColIndex> mdspan() noexcept {
+        return DenseMdSpan<T, dextents<2>, RowIndex, ColIndex>(data_.data(), rows_, cols_);
+    }
+
+    [[nodiscard]] DenseMdSpan<const T, dextents<2>, RowIndex, ColIndex> mdspan() const noexcept {
+        return DenseMdSpan<const T, dextents<2>, RowIndex, ColIndex>(data_.data(), rows_, cols_);
+    }
+
+    // Dimensions
+    [[nodiscard]] size_type rows() const noexcept { return rows_; }
+    [[nodiscard]] size_type cols() const noexcept { return cols_; }
+    [[nodiscard]] size_type size() const noexcept { return data_.size(); }
+    [[nodiscard]] IndexRange<RowIndex> row_indices() const { return IndexRange<RowIndex>(RowIndex(0), RowIndex(rows_)); }
+    [[nodiscard]] IndexRange<ColIndex> col_indices() const { return IndexRange<ColIndex>(ColIndex(0), ColIndex(cols_)); }
+
+    // Transpose in 32x32 tiles so both sides are walked cache line by cache line
+    [[nodiscard]] DenseMatrix<T, ColIndex, RowIndex> transpose() const {
+        constexpr size_type tile = 32;
+        DenseMatrix<T, ColIndex, RowIndex> result(cols_, rows_);
+        T* out = result.data();
+        for (size_type r0 = 0; r0 < rows_; r0 += tile) {
+            for (size_type c0 = 0; c0 < cols_; c0 += tile) {
+                for (size_type r = r0; r < std::min(r0 + tile, rows_); ++r) {
+                    for (size_type c = c0; c < std::min(c0 + tile, cols_); ++c) out[c * rows_ + r] = data_[r * cols_ + c];
+                }
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] bool operator==(const DenseMatrix&) const = default;
+};
+
+namespace detail {
+
+// Minimal vector abstraction for the matrix kernels: the widest registers
+// available for float and double, and one-lane scalars for everything else
+template<typename T>
+struct simd {
+    using reg = T;
+    static constexpr std::size_t width = 1;
+    static reg zero() noexcept { return T{}; }
+    static reg broadcast(T v) noexcept { return v; }
+    static reg load(const T* p) noexcept { return *p; }
+    static void store(T* p, reg v) noexcept { *p = v; }
+    static reg fmadd(reg a, reg b, reg c) noexcept { return a * b + c; }
+    static reg add(reg a, reg b) noexcept { return a + b; }
+    static T sum(reg v) noexcept { return v; }
+};
+
+#if defined(__AVX512F__)
+template<>
+struct simd<float> {
+    using reg = __m512;
+    static constexpr std::size_t width = 16;
+    static reg zero() noexcept { return _mm512_setzero_ps(); }
+    static reg broadcast(float v) noexcept { return _mm512_set1_ps(v); }
+    static reg load(const float* p) noexcept { return _mm512_loadu_ps(p); }
+    static void store(float* p, reg v) noexcept { _mm512_storeu_ps(p, v); }
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+    static reg add(reg a, reg b) noexcept { return _mm512_add_ps(a, b); }
+    static float sum(reg v) noexcept {
+        // Masked extracts: GCC 12's unmasked forms trip -Wmaybe-uninitialized
+        const __m512d d = _mm512_castps_pd(v);
+        const __m256 h = _mm256_add_ps(_mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xFF, d, 0)),
+                                       _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xFF, d, 1)));
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+    }
+};
+
+template<>
+struct simd<double> {
+    using reg = __m512d;
+    static constexpr std::size_t width = 8;
+    static reg zero() noexcept { return _mm512_setzero_pd(); }
+    static reg broadcast(double v) noexcept { return _mm512_set1_pd(v); }
+    static reg load(const double* p) noexcept { return _mm512_loadu_pd(p); }
+    static void store(double* p, reg v) noexcept { _mm512_storeu_pd(p, v); }
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+    static reg add(reg a, reg b) noexcept { return _mm512_add_pd(a, b); }
+    static double sum(reg v) noexcept {
+        const __m256d h = _mm256_add_pd(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xFF, v, 0),
+                                        _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xFF, v, 1));
+        const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(h), _mm256_extractf128_pd(h, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+};
+#elif defined(__AVX2__)
+template<>
+struct simd<float> {
+    using reg = __m256;
+    static constexpr std::size_t width = 8;
+    static reg zero() noexcept { return _mm256_setzero_ps(); }
+    static reg broadcast(float v) noexcept { return _mm256_set1_ps(v); }
+    static reg load(const float* p) noexcept { return _mm256_loadu_ps(p); }
+    static void store(float* p, reg v) noexcept { _mm256_storeu_ps(p, v); }
+    static reg add(reg a, reg b) noexcept { return _mm256_add_ps(a, b); }
+#if defined(__FMA__)
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    static float sum(reg v) noexcept {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+    }
+};
+
+template<>
+struct simd<double> {
+    using reg = __m256d;
+    static constexpr std::size_t width = 4;
+    static reg zero() noexcept { return _mm256_setzero_pd(); }
+    static reg broadcast(double v) noexcept { return _mm256_set1_pd(v); }
+    static reg load(const double* p) noexcept { return _mm256_loadu_pd(p); }
+    static void store(double* p, reg v) noexcept { _mm256_storeu_pd(p, v); }
+    static reg add(reg a, reg b) noexcept { return _mm256_add_pd(a, b); }
+#if defined(__FMA__)
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static reg fmadd(reg a, reg b, reg c) noexcept { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    static double sum(reg v) noexcept {
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+};
+#endif
+
+// y[r] = dot(a[r, :], x) for r in [first, last). Four rows share each load of x.
+template<typename T>
+void gemv_rows(const T* a, std::size_t cols, const T* x, T* y, std::size_t first, std::size_t last) noexcept {
+    using V = simd<T>;
+    constexpr std::size_t W = V::width;
+    const std::size_t vec_cols = cols - cols % W;
+    std::size_t r = first;
+    for (; r + 4 <= last; r += 4) {
+        const T* a0 = a + r * cols;
+        const T* a1 = a0 + cols;
+        const T* a2 = a1 + cols;
+        const T* a3 = a2 + cols;
+        auto s0 = V::zero(), s1 = V::zero(), s2 = V::zero(), s3 = V::zero();
+        for (std::size_t c = 0; c < vec_cols; c += W) {
+            const auto xv = V::load(x + c);
+            s0 = V::fmadd(V::load(a0 + c), xv, s0);
+            s1 = V::fmadd(V::load(a1 + c), xv, s1);
+            s2 = V::fmadd(V::load(a2 + c), xv, s2);
+            s3 = V::fmadd(V::load(a3 + c), xv, s3);
+        }
+        T t0 = V::sum(s0), t1 = V::sum(s1), t2 = V::sum(s2), t3 = V::sum(s3);
+        for (std::size_t c = vec_cols; c < cols; ++c) {
+            t0 += a0[c] * x[c];
+            t1 += a1[c] * x[c];
+            t2 += a2[c] * x[c];
+            t3 += a3[c] * x[c];
+        }
+        y[r] = t0;
+        y[r + 1] = t1;
+        y[r + 2] = t2;
+        y[r + 3] = t3;
+    }
+    for (; r < last; ++r) {
+        const T* ar = a + r * cols;
+        auto s = V::zero();
+        for (std::size_t c = 0; c < vec_cols; c += W) s = V::fmadd(V::load(ar + c), V::load(x + c), s);
+        T t = V::sum(s);
+        for (std::size_t c = vec_cols; c < cols; ++c) t += ar[c] * x[c];
+        y[r] = t;
+    }
+}
+
+// Cache blocking for gemm: a kc x nc panel of B stays in L2 while row tiles
+// of A stream past it; each 4 x (2 * width) tile of C lives in registers
+inline constexpr std::size_t gemm_kc = 128;
+inline constexpr std::size_t gemm_nc = 256;
+inline constexpr std::size_t gemm_mr = 4;
+
+// c[rows, cols] += a[rows, k] * b[k, cols] for rows in [first, last); row-major
+// with leading dimensions k (a), n (b and c)
+template<typename T>
+void gemm_rows(const T* a, const T* b, T* c, std::size_t k, std::size_t n, std::size_t first, std::size_t last) noexcept {
+    using V = simd<T>;
+    constexpr std::size_t W = V::width;
+    constexpr std::size_t NR = 2 * W;
+    constexpr std::size_t MR = gemm_mr;
+
+    for (std::size_t j0 = 0; j0 < n; j0 += gemm_nc) {
+        const std::size_t j1 = std::min(j0 + gemm_nc, n);
+        for (std::size_t p0 = 0; p0 < k; p0 += gemm_kc) {
+            const std::size_t p1 = std::min(p0 + gemm_kc, k);
+            std::size_t i = first;
+            for (; i + MR <= last; i += MR) {
+                std::size_t j = j0;
+                for (; j + NR <= j1; j += NR) {
+                    typename V::reg acc[MR][2];
+                    for (std::size_t r = 0; r < MR; ++r) {
+                        acc[r][0] = V::load(c + (i + r) * n + j);
+                        acc[r][1] = V::load(c + (i + r) * n + j + W);
+                    }
+                    for (std::size_t p = p0; p < p1; ++p) {
+                        const auto b0 = V::load(b + p * n + j);
+                        const auto b1 = V::load(b + p * n + j + W);
+                        for (std::size_t r = 0; r < MR; ++r) {
+                            const auto av = V::broadcast(a[(i + r) * k + p]);
+                            acc[r][0] = V::fmadd(av, b0, acc[r][0]);
+                            acc[r][1] = V::fmadd(av, b1, acc[r][1]);
+                        }
+                    }
+                    for (std::size_t r = 0; r < MR; ++r) {
+                        V::store(c + (i + r) * n + j, acc[r][0]);
+                        V::store(c + (i + r) * n + j + W, acc[r][1]);
+                    }
+                }
+                // Column fringe
+                for (std::size_t r = i; r < i + MR; ++r) {
+                    for (std::size_t p = p0; p < p1; ++p) {
+                        const T av = a[r * k + p];
+                        for (std::size_t jj = j; jj < j1; ++jj) c[r * n + jj] += av * b[p * n + jj];
+                    }
+                }
+            }
+            // Row fringe
+            for (; i < last; ++i) {
+                for (std::size_t p = p0; p < p1; ++p) {
+                    const T av = a[i * k + p];
+                    for (std::size_t jj = j0; jj < j1; ++jj) c[i * n + jj] += av * b[p * n + jj];
+                }
+            }
+        }
+    }
+}
+
+inline void check_dimensions(std::size_t inner_left, std::size_t inner_right) {
+    if (inner_left != inner_right) throw std::invalid_argument("dense_index::multiply: dimension mismatch");
+}
+
+} // namespace detail
+
+// Matrix-vector product: the vector is indexed by the matrix's columns and the
+// result by its rows
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> multiply(const DenseMatrix<T, RowIndex, ColIndex>& a, const DenseVector<T, ColIndex>& x) {
+    detail::check_dimensions(a.cols(), x.size());
+    DenseVector<T, RowIndex> y(a.rows(), T{});
+    detail::gemv_rows(a.data(), a.cols(), x.data(), y.data(), 0, a.rows());
+    return y;
+}
+
+// Same, with rows split over the scheduler's workers
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> multiply(const DenseMatrix<T, RowIndex, ColIndex>& a, const DenseVector<T, ColIndex>& x,
+                                                WorkStealingScheduler& scheduler) {
+    detail::check_dimensions(a.cols(), x.size());
+    DenseVector<T, RowIndex> y(a.rows(), T{});
+    scheduler.parallel_for_chunks(a.row_indices(), [&](IndexRange<RowIndex> rows) {
+        detail::gemv_rows(a.data(), a.cols(), x.data(), y.data(), get_index_value(rows.first()), get_index_value(rows.last()));
+    }, {.grain = std::max<std::size_t>(16, 16384 / std::max<std::size_t>(1, a.cols())), .affinity = std::nullopt});
+    return y;
+}
+
+// Matrix product; the shared inner domain must match at compile time
+template<typename T, StrongIndexType RowIndex, StrongIndexType InnerIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseMatrix<T, RowIndex, ColIndex> multiply(const DenseMatrix<T, RowIndex, InnerIndex>& a,
+                                                          const DenseMatrix<T, InnerIndex, ColIndex>& b) {
+    detail::check_dimensions(a.cols(), b.rows());
+    DenseMatrix<T, RowIndex, ColIndex> c(a.rows(), b.cols());
+    detail::gemm_rows(a.data(), b.data(), c.data(), a.cols(), b.cols(), 0, a.rows());
+    return c;
+}
+
+// Same, with row blocks of the result split over the scheduler's workers
+template<typename T, StrongIndexType RowIndex, StrongIndexType InnerIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseMatrix<T, RowIndex, ColIndex> multiply(const DenseMatrix<T, RowIndex, InnerIndex>& a,
+                                                          const DenseMatrix<T, InnerIndex, ColIndex>& b,
+                                                          WorkStealingScheduler& scheduler) {
+    using detail::ChunkIndex;
+    detail::check_dimensions(a.cols(), b.rows());
+    DenseMatrix<T, RowIndex, ColIndex> c(a.rows(), b.cols());
+    constexpr std::size_t block = 16 * detail::gemm_mr;
+    const auto blocks = (a.rows() + block - 1) / block;
+    scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(blocks)), [&](ChunkIndex blk) {
+        const auto first = get_index_value(blk) * block;
+        detail::gemm_rows(a.data(), b.data(), c.data(), a.cols(), b.cols(), first, std::min(first + block, a.rows()));
+    }, {.grain = 1, .affinity = std::nullopt});
+    return c;
+}
+
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> operator*(const DenseMatrix<T, RowIndex, ColIndex>& a, const DenseVector<T, ColIndex>& x) {
+    return multiply(a, x);
+}
+
+template<typename T, StrongIndexType RowIndex, StrongIndexType InnerIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseMatrix<T, RowIndex, ColIndex> operator*(const DenseMatrix<T, RowIndex, InnerIndex>& a,
+                                                           const DenseMatrix<T, InnerIndex, ColIndex>& b) {
+    return multiply(a, b);
+}
+
+// Coordinate-format entry of a sparse matrix
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+struct SparseEntry {
+    RowIndex row;
+    ColIndex col;
+    T value;
+};
+
+// Sparse matrix in compressed sparse row form. Columns within a row are
+// sorted and unique. The CSC form of a matrix is the CSR form of its
+// transpose, which transpose() builds with the row and column domains swapped.
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+class DenseSparseMatrix {
+public:
+    using value_type = T;
+    using row_index_type = RowIndex;
+    using col_index_type = ColIndex;
+    using size_type = std::size_t;
+    using entry_type = SparseEntry<T, RowIndex, ColIndex>;
+
+private:
+    size_type rows_ = 0;
+    size_type cols_ = 0;
+    std::vector<size_type> offsets_{0};
+    std::vector<ColIndex> columns_;
+    std::vector<T> values_;
+
+    [[nodiscard]] size_type find(RowIndex r, ColIndex c) const noexcept {
+        const auto i = get_index_value(r);
+        const auto first = columns_.begin() + static_cast<std::ptrdiff_t>(offsets_[i]);
+        const auto last = columns_.begin() + static_cast<std::ptrdiff_t>(offsets_[i + 1]);
+        const auto it = std::ranges::lower_bound(first, last, get_index_value(c), {},
+                                                 [](ColIndex col) { return get_index_value(col); });
+        return it != last && get_index_value(*it) == get_index_value(c) ? static_cast<size_type>(it - columns_.begin())
+                                                                        : columns_.size();
+    }
+
+public:
+    // Constructors
+    DenseSparseMatrix() = default;
+    DenseSparseMatrix(size_type rows, size_type cols) : rows_(rows), cols_(cols), offsets_(rows + 1, 0) {}
+
+    // COO to CSR: entries are bucketed by row with a counting sort, each row is
+    // sorted by column, and duplicate coordinates are summed. Every row must be
+    // below `rows` and every column below `cols`.
+    template<std::ranges::input_range Entries, typename RowFn, typename ColFn, typename ValueFn>
+    [[nodiscard]] static DenseSparseMatrix from_coo(size_type rows, size_type cols, const Entries& entries,
+                                                    RowFn row, ColFn col, ValueFn value) {
+        DenseSparseMatrix m(rows, cols);
+        const auto counts = histogram(entries, row, rows);
+        for (size_type r = 0; r < rows; ++r) m.offsets_[r + 1] = m.offsets_[r] + counts.data()[r];
+
+        std::vector<std::pair<ColIndex, T>> scattered(m.offsets_.back());
+        std::vector<size_type> cursor(m.offsets_.begin(), m.offsets_.end() - 1);
+        for (const auto& entry : entries) {
+            scattered[cursor[get_index_value(std::invoke(row, entry))]++] = {std::invoke(col, entry),
+                                                                             static_cast<T>(std::invoke(value, entry))};
+        }
+
+        m.columns_.reserve(scattered.size());
+        m.values_.reserve(scattered.size());
+        size_type begin = 0;
+        for (size_type r = 0; r < rows; ++r) {
+            const auto end = m.offsets_[r + 1];
+            std::sort(scattered.begin() + static_cast<std::ptrdiff_t>(begin), scattered.begin() + static_cast<std::ptrdiff_t>(end),
+                      [](const auto& a, const auto& b) { return get_index_value(a.first) < get_index_value(b.first); });
+            for (auto e = begin; e < end; ++e) {
+                if (m.columns_.size() > m.offsets_[r] && get_index_value(m.columns_.back()) == get_index_value(scattered[e].first)) {
+                    m.values_.back() += scattered[e].second;
+                } else {
+                    m.columns_.push_back(scattered[e].first);
+                    m.values_.push_back(scattered[e].second);
+                }
+            }
+            begin = end;
+            m.offsets_[r + 1] = m.columns_.size();
+        }
+        return m;
+    }
+
+    template<std::ranges::input_range Entries>
+        requires std::convertible_to<std::ranges::range_reference_t<const Entries&>, const entry_type&>
+    [[nodiscard]] static DenseSparseMatrix from_coo(size_type rows, size_type cols, const Entries& entries) {
+        return from_coo(rows, cols, entries, &entry_type::row, &entry_type::col, &entry_type::value);
+    }
+
+    // Matrix with rows and columns swapped; equivalently this matrix in CSC form
+    [[nodiscard]] DenseSparseMatrix<T, ColIndex, RowIndex> transpose() const {
+        std::vector<SparseEntry<T, ColIndex, RowIndex>> swapped;
+        swapped.reserve(nonzeros());
+        for (size_type r = 0; r < rows_; ++r) {
+            for (auto e = offsets_[r]; e < offsets_[r + 1]; ++e) swapped.push_back({columns_[e], RowIndex(r), values_[e]});
+        }
+        // Rows are visited in order, so the counting sort leaves every column sorted already
+        return DenseSparseMatrix<T, ColIndex, RowIndex>::from_coo(cols_, rows_, swapped);
+    }
+
+    // Dimensions
+    [[nodiscard]] size_type rows() const noexcept { return rows_; }
+    [[nodiscard]] size_type cols() const noexcept { return cols_; }
+    [[nodiscard]] size_type nonzeros() const noexcept { return values_.size(); }
+    [[nodiscard]] IndexRange<RowIndex> row_indices() const { return IndexRange<RowIndex>(RowIndex(0), RowIndex(rows_)); }
+
+    // Element access; absent entries read as T{}
+    [[nodiscard]] T operator[](RowIndex r, ColIndex c) const noexcept {
+        const auto e = find(r, c);
+        return e == columns_.size() ? T{} : values_[e];
+    }
+
+    [[nodiscard]] T at(RowIndex r, ColIndex c) const {
+        if (get_index_value(r) >= rows_ || get_index_value(c) >= cols_) throw std::out_of_range("DenseSparseMatrix::at");
+        return (*this)[r, c];
+    }
+
+    [[nodiscard]] bool contains(RowIndex r, ColIndex c) const noexcept { return find(r, c) != columns_.size(); }
+
+    // Stored entries of a row
+    [[nodiscard]] std::span<const ColIndex> row_columns(RowIndex r) const noexcept {
+        const auto i = get_index_value(r);
+        return std::span<const ColIndex>(columns_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    [[nodiscard]] std::span<const T> row_values(RowIndex r) const noexcept {
+        const auto i = get_index_value(r);
+        return std::span<const T>(values_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    [[nodiscard]] std::span<T> row_values(RowIndex r) noexcept {
+        const auto i = get_index_value(r);
+        return std::span<T>(values_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    // Raw CSR arrays
+    [[nodiscard]] std::span<const size_type> offsets() const noexcept { return offsets_; }
+    [[nodiscard]] std::span<const ColIndex> columns() const noexcept { return columns_; }
+    [[nodiscard]] std::span<const T> values() const noexcept { return values_; }
+
+    [[nodiscard]] bool operator==(const DenseSparseMatrix&) const = default;
+};
+
+namespace detail {
+
+// y[r] = sum of a[r, c] * x[c] over the stored entries of rows [first, last)
+template<typename T, typename ColIndex>
+void spmv_rows(std::span<const std::size_t> offsets, const ColIndex* columns, const T* values, const T* x, T* y,
+               std::size_t first, std::size_t last) noexcept {
+    for (auto r = first; r < last; ++r) {
+        T sum{};
+        for (auto e = offsets[r]; e < offsets[r + 1]; ++e) sum += values[e] * x[get_index_value(columns[e])];
+        y[r] = sum;
+    }
+}
+
+} // namespace detail
+
+// Sparse matrix-vector product
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> multiply(const DenseSparseMatrix<T, RowIndex, ColIndex>& a,
+                                                const DenseVector<T, ColIndex>& x) {
+    detail::check_dimensions(a.cols(), x.size());
+    DenseVector<T, RowIndex> y(a.rows(), T{});
+    detail::spmv_rows(a.offsets(), a.columns().data(), a.values().data(), x.data(), y.data(), 0, a.rows());
+    return y;
+}
+
+// Parallel SpMV. Rows are cut into chunks of about equal nonzero count, so a
+// few dense rows (hubs of a power-law graph) do not serialize a whole task.
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> multiply(const DenseSparseMatrix<T, RowIndex, ColIndex>& a,
+                                                const DenseVector<T, ColIndex>& x, WorkStealingScheduler& scheduler) {
+    using detail::ChunkIndex;
+    detail::check_dimensions(a.cols(), x.size());
+    DenseVector<T, RowIndex> y(a.rows(), T{});
+    const auto offsets = a.offsets();
+    const auto per_chunk = std::max<std::size_t>(2048, a.nonzeros() / (8 * scheduler.worker_count()));
+    std::vector<std::size_t> bounds{0};
+    while (bounds.back() < a.rows()) {
+        const auto target = offsets[bounds.back()] + per_chunk;
+        const auto it = std::upper_bound(offsets.begin() + static_cast<std::ptrdiff_t>(bounds.back()) + 1, offsets.end() - 1, target);
+        bounds.push_back(std::max(bounds.back() + 1, static_cast<std::size_t>(it - offsets.begin())));
+    }
+    bounds.back() = a.rows();
+    scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(bounds.size() - 1)), [&](ChunkIndex c) {
+        const auto i = get_index_value(c);
+        detail::spmv_rows(offsets, a.columns().data(), a.values().data(), x.data(), y.data(), bounds[i], bounds[i + 1]);
+    }, {.grain = 1, .affinity = std::nullopt});
+    return y;
+}
+
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex>
+[[nodiscard]] DenseVector<T, RowIndex> operator*(const DenseSparseMatrix<T, RowIndex, ColIndex>& a,
+                                                 const DenseVector<T, ColIndex>& x) {
+    return multiply(a, x);
+}
+
+// Adjacency matrix of a graph: entry (u, v) is the summed weight of the edges
+// u -> v, or their count for unweighted graphs
+template<typename Graph, typename T = typename Graph::weight_type>
+[[nodiscard]] DenseSparseMatrix<T, typename Graph::node_index_type, typename Graph::node_index_type>
+adjacency_matrix(const Graph& graph) {
+    using NodeIndex = typename Graph::node_index_type;
+    using Entry = SparseEntry<T, NodeIndex, NodeIndex>;
+    std::vector<Entry> entries;
+    entries.reserve(graph.edge_count());
+    for (auto u : graph.nodes()) {
+        for (auto e : graph.out_edges(u)) {
+            entries.push_back(Entry{u, graph.target(e), graph.weighted() ? static_cast<T>(graph.weight(e)) : T{1}});
+        }
+    }
+    return DenseSparseMatrix<T, NodeIndex, NodeIndex>::from_coo(graph.node_count(), graph.node_count(), entries);
+}
+
+// Signed offset along one axis. IndexDelta<RowIndex> and IndexDelta<ColIndex>
+// are distinct types, so a stencil cannot mix up its axes.
+template<StrongIndexType IndexType>
+struct IndexDelta {
+    using index_type = IndexType;
+
+    std::ptrdiff_t value = 0;
+
+    constexpr IndexDelta() noexcept = default;
+    constexpr explicit IndexDelta(std::ptrdiff_t v) noexcept : value(v) {}
+
+    [[nodiscard]] constexpr IndexDelta operator-() const noexcept { return IndexDelta(-value); }
+    [[nodiscard]] constexpr auto operator<=>(const IndexDelta&) const noexcept = default;
+};
+
+// How neighbours outside the grid are read
+enum class StencilBoundary {
+    clamp, // nearest edge cell
+    wrap,  // periodic
+    zero   // value-initialized T
+};
+
+struct StencilOptions {
+    StencilBoundary boundary = StencilBoundary::clamp;
+};
+
+// The cells around one grid point, as seen by a stencil kernel. n[dy, dx]
+// reads the neighbour at that typed offset; offsets must stay within the
+// radius passed to stencil_apply.
+template<typename T, StrongIndexType... AxisIndices>
+class StencilNeighborhood {
+public:
+    static constexpr std::size_t rank = sizeof...(AxisIndices);
+
+private:
+    const T* center_;
+    // Strides of the outer axes; the innermost axis is always contiguous
+    std::array<std::ptrdiff_t, rank - 1> strides_;
+
+    template<std::size_t... I>
+    [[nodiscard]] constexpr std::ptrdiff_t offset(std::index_sequence<I...>, const std::array<std::ptrdiff_t, rank>& d) const noexcept {
+        return ((d[I] * strides_[I]) + ... + d[rank - 1]);
+    }
+
+public:
+    constexpr StencilNeighborhood(const T* center, const std::array<std::ptrdiff_t, rank - 1>& strides) noexcept
+        : center_(center), strides_(strides) {}
+
+    [[nodiscard]] constexpr const T& operator[](IndexDelta<AxisIndices>... deltas) const noexcept {
+        return center_[offset(std::make_index_sequence<rank - 1>{}, {deltas.value...})];
+    }
+
+    [[nodiscard]] constexpr const T& center() const noexcept { return *center_; }
+};
+
+namespace detail {
+
+// Source coordinate for padded position i - radius; n means "outside" (zero fill)
+[[nodiscard]] inline std::size_t stencil_source(std::ptrdiff_t i, std::size_t n, StencilBoundary boundary) noexcept {
+    const auto size = static_cast<std::ptrdiff_t>(n);
+    if (i >= 0 && i < size) return static_cast<std::size_t>(i);
+    switch (boundary) {
+    case StencilBoundary::clamp: return i < 0 ? 0 : n - 1;
+    case StencilBoundary::wrap: return static_cast<std::size_t>(((i % size) + size) % size);
+    case StencilBoundary::zero: break;
+    }
+    return n;
+}
+
+// Tile shape: long runs along the contiguous axis for the vector loop, short
+// along the outer axes so tile plus halo stays within L2
+template<std::size_t Rank>
+[[nodiscard]] constexpr std::array<std::size_t, Rank> stencil_tile() noexcept {
+    std::array<std::size_t, Rank> tile{};
+    tile.fill(Rank == 2 ? 32 : 8);
+    tile[Rank - 1] = 256;
+    return tile;
+}
+
+// Advance a multi-index over the outer axes [0, Rank - 1); false when done
+template<std::size_t Rank>
+[[nodiscard]] inline bool next_outer(std::array<std::size_t, Rank>& idx, const std::array<std::size_t, Rank>& limit) noexcept {
+    for (auto k = Rank - 1; k-- > 0;) {
+        if (++idx[k] < limit[k]) return true;
+        idx[k] = 0;
+    }
+    return false;
+}
+
+// Apply f to every point in [lo, hi). Points whose whole neighbourhood lies in
+// the grid read the input in place, a unit-stride run per row; the thin shell
+// near the edges gathers each neighbourhood into a small buffer with the
+// boundary rule applied, so the kernel never branches on position.
+template<typename T, typename U, std::size_t Rank, typename F, StrongIndexType... AxisIndices>
+void stencil_tile_apply(const T* in, U* out, const std::array<std::size_t, Rank>& n, std::size_t radius,
+                        const std::array<std::size_t, Rank>& lo, const std::array<std::size_t, Rank>& hi,
+                        StencilBoundary boundary, F& f, std::type_identity<StencilNeighborhood<T, AxisIndices...>>) {
+    using Neighborhood = StencilNeighborhood<T, AxisIndices...>;
+
+    std::array<std::size_t, Rank> stride{};
+    stride[Rank - 1] = 1;
+    for (auto k = Rank - 1; k-- > 0;) stride[k] = stride[k + 1] * n[k + 1];
+    std::array<std::ptrdiff_t, Rank - 1> outer_stride{};
+    for (std::size_t k = 0; k + 1 < Rank; ++k) outer_stride[k] = static_cast<std::ptrdiff_t>(stride[k]);
+
+    // Interior bounds: [inner_lo, inner_hi) per axis, clipped to the tile
+    std::array<std::size_t, Rank> inner_lo{};
+    std::array<std::size_t, Rank> inner_hi{};
+    for (std::size_t k = 0; k < Rank; ++k) {
+        inner_lo[k] = std::min(std::max(lo[k], radius), hi[k]);
+        inner_hi[k] = n[k] > radius ? std::max(std::min(hi[k], n[k] - radius), inner_lo[k]) : inner_lo[k];
+    }
+
+    // Edge points: gather the (2r + 1)^Rank cube around the point
+    const auto side = 2 * radius + 1;
+    std::vector<T> cube;
+    std::array<std::ptrdiff_t, Rank - 1> cube_stride{};
+    const auto gathered = [&](const std::array<std::size_t, Rank>& p) {
+        if (cube.empty()) {
+            std::size_t volume = 1;
+            for (std::size_t k = 0; k < Rank; ++k) volume *= side;
+            cube.resize(volume);
+            std::ptrdiff_t s = 1;
+            for (auto k = Rank - 1; k-- > 0;) cube_stride[k] = s *= static_cast<std::ptrdiff_t>(side);
+        }
+        std::array<std::size_t, Rank> d{};
+        std::array<std::size_t, Rank> all{};
+        all.fill(side);
+        T* slot = cube.data();
+        do {
+            std::size_t src = 0;
+            bool outside = false;
+            for (std::size_t k = 0; k + 1 < Rank; ++k) {
+                const auto s = stencil_source(static_cast<std::ptrdiff_t>(p[k] + d[k]) - static_cast<std::ptrdiff_t>(radius), n[k], boundary);
+                outside = outside || s == n[k];
+                src += s * stride[k];
+            }
+            for (std::size_t c = 0; c < side; ++c) {
+                const auto s = stencil_source(static_cast<std::ptrdiff_t>(p[Rank - 1] + c) - static_cast<std::ptrdiff_t>(radius), n[Rank - 1],
+                                              boundary);
+                *slot++ = outside || s == n[Rank - 1] ? T{} : in[src + s];
+            }
+        } while (next_outer(d, all));
+        std::ptrdiff_t center = static_cast<std::ptrdiff_t>(radius);
+        for (std::size_t k = 0; k + 1 < Rank; ++k) center += static_cast<std::ptrdiff_t>(radius) * cube_stride[k];
+        return f(Neighborhood(cube.data() + center, cube_stride));
+    };
+
+    std::array<std::size_t, Rank> extent{};
+    for (std::size_t k = 0; k < Rank; ++k) extent[k] = hi[k] - lo[k];
+    constexpr auto last = Rank - 1;
+
+    std::array<std::size_t, Rank> q{};
+    do {
+        std::array<std::size_t, Rank> p{};
+        std::size_t row = 0;
+        bool interior_row = true;
+        for (std::size_t k = 0; k < last; ++k) {
+            p[k] = lo[k] + q[k];
+            row += p[k] * stride[k];
+            interior_row = interior_row && p[k] >= inner_lo[k] && p[k] < inner_hi[k];
+        }
+        const T* src = in + row;
+        U* dst = out + row;
+        const auto run_lo = interior_row ? inner_lo[last] : hi[last];
+        const auto run_hi = interior_row ? inner_hi[last] : hi[last];
+        for (p[last] = lo[last]; p[last] < run_lo; ++p[last]) dst[p[last]] = gathered(p);
+        // Unit-stride loop with loop-invariant neighbour offsets; once f is
+        // inlined the compiler vectorizes it
+        for (auto j = run_lo; j < run_hi; ++j) dst[j] = f(Neighborhood(src + j, outer_stride));
+        for (p[last] = run_hi; p[last] < hi[last]; ++p[last]) dst[p[last]] = gathered(p);
+    } while (next_outer(q, extent));
+}
+
+template<typename T, typename U, std::size_t Rank, typename F, StrongIndexType... AxisIndices>
+void stencil_run(const T* in, U* out, const std::array<std::size_t, Rank>& n, std::size_t radius, const F& f,
+                 WorkStealingScheduler& scheduler, StencilOptions options) {
+    static_assert(Rank >= 2, "stencils need at least two axes");
+    for (auto e : n) {
+        if (e == 0) return;
+    }
+    const auto tile = stencil_tile<Rank>();
+    std::array<std::size_t, Rank> tiles{};
+    std::size_t count = 1;
+    for (std::size_t k = 0; k < Rank; ++k) {
+        tiles[k] = (n[k] + tile[k] - 1) / tile[k];
+        count *= tiles[k];
+    }
+    scheduler.parallel_for(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(count)), [&](ChunkIndex t) {
+        auto rest = get_index_value(t);
+        std::array<std::size_t, Rank> lo{};
+        std::array<std::size_t, Rank> hi{};
+        for (auto k = Rank; k-- > 0;) {
+            lo[k] = (rest % tiles[k]) * tile[k];
+            hi[k] = std::min(lo[k] + tile[k], n[k]);
+            rest /= tiles[k];
+        }
+        // Each tile runs its own copy, so kernel state is never shared between workers
+        F kernel = f;
+        stencil_tile_apply(in, out, n, radius, lo, hi, options.boundary, kernel,
+                           std::type_identity<StencilNeighborhood<T, AxisIndices...>>{});
+    }, {.grain = 1, .affinity = std::nullopt});
+}
+
+} // namespace detail
+
+// out[p] = f(neighbourhood of p) for every point p of a row-major grid, in
+// cache-blocked tiles run in parallel. f takes a StencilNeighborhood and reads
+// neighbours with typed deltas, e.g. n[IndexDelta<Y>(-1), IndexDelta<X>(0)].
+// Every tile invokes its own copy of f, so a mutable kernel may keep scratch
+// state, but that state is per tile and is not seen by the caller.
+// in and out must have the same extents and must not overlap; either
+// violation throws std::invalid_argument.
+template<typename T, typename InExtents, typename U, typename OutExtents, StrongIndexType... AxisIndices, typename F>
+    requires std::copy_constructible<F> && std::is_invocable_r_v<std::remove_cv_t<U>, F&, const StencilNeighborhood<std::remove_cv_t<T>, AxisIndices...>&>
+void stencil_apply(DenseMdSpan<T, InExtents, AxisIndices...> in, DenseMdSpan<U, OutExtents, AxisIndices...> out, std::size_t radius,
+                   F f, WorkStealingScheduler& scheduler = default_scheduler(), StencilOptions options = {}) {
+    constexpr std::size_t rank = sizeof...(AxisIndices);
+    std::array<std::size_t, rank> n{};
+    for (std::size_t k = 0; k < rank; ++k) {
+        if (in.extent(k) != out.extent(k)) throw std::invalid_argument("dense_index::stencil_apply: extent mismatch");
+        n[k] = in.extent(k);
+    }
+    const std::remove_cv_t<T>* src = in.data_handle();
+    const auto points = std::accumulate(n.begin(), n.end(), std::size_t{1}, std::multiplies<>{});
+    if (points > 0) {
+        // Tiles read neighbours other tiles are writing, so aliasing would race
+        const auto* in_bytes = reinterpret_cast<const std::byte*>(src);
+        const auto* out_bytes = reinterpret_cast<const std::byte*>(out.data_handle());
+        const std::less<> before;
+        if (before(in_bytes, out_bytes + points * sizeof(U)) && before(out_bytes, in_bytes + points * sizeof(T))) {
+            throw std::invalid_argument("dense_index::stencil_apply: in and out overlap");
+        }
+    }
+    detail::stencil_run<std::remove_cv_t<T>, U, rank, F, AxisIndices...>(src, out.data_handle(), n, radius, f, scheduler, options);
+}
+
+// Matrix form writing into an existing output, for ping-pong iteration
+template<typename T, typename U, StrongIndexType RowIndex, StrongIndexType ColIndex, typename F>
+    requires std::is_invocable_r_v<U, F&, const StencilNeighborhood<T, RowIndex, ColIndex>&>
+void stencil_apply(const DenseMatrix<T, RowIndex, ColIndex>& grid, DenseMatrix<U, RowIndex, ColIndex>& out, std::size_t radius, F f,
+                   WorkStealingScheduler& scheduler = default_scheduler(), StencilOptions options = {}) {
+    stencil_apply(grid.mdspan(), out.mdspan(), radius, std::move(f), scheduler, options);
+}
+
+// Matrix form returning a new grid of f's result type
+template<typename T, StrongIndexType RowIndex, StrongIndexType ColIndex, typename F>
+    requires std::invocable<F&, const StencilNeighborhood<T, RowIndex, ColIndex>&>
+[[nodiscard]] auto stencil_apply(const DenseMatrix<T, RowIndex, ColIndex>& grid, std::size_t radius, F f,
+                                 WorkStealingScheduler& scheduler = default_scheduler(), StencilOptions options = {}) {
+    using U = std::remove_cvref_t<std::invoke_result_t<F&, const StencilNeighborhood<T, RowIndex, ColIndex>&>>;
+    DenseMatrix<U, RowIndex, ColIndex> out(grid.rows(), grid.cols());
+    stencil_apply(grid, out, radius, std::move(f), scheduler, options);
+    return out;
+}
+
+// One-to-one map between two index domains, stored densely in both
+// directions so lookups either way are a single load. Every mutation updates
+// both arrays together, so they cannot drift apart. Indices may be unpaired.
+template<StrongIndexType AIndex, StrongIndexType BIndex>
+class DenseBijection {
+public:
+    using a_index_type = AIndex;
+    using b_index_type = BIndex;
+    using size_type = std::size_t;
+
+private:
+    using a_rep = index_rep_t<AIndex>;
+    using b_rep = index_rep_t<BIndex>;
+
+    static constexpr a_rep no_a = std::numeric_limits<a_rep>::max();
+    static constexpr b_rep no_b = std::numeric_limits<b_rep>::max();
+
+    std::vector<b_rep> forward_;   // A -> B, no_b when unpaired
+    std::vector<a_rep> backward_;  // B -> A, no_a when unpaired
+    size_type pairs_ = 0;
+
+    void unlink(std::size_t a, std::size_t b) noexcept {
+        forward_[a] = no_b;
+        backward_[b] = no_a;
+        --pairs_;
+    }
+
+    void link(std::size_t a, std::size_t b) noexcept {
+        forward_[a] = static_cast<b_rep>(b);
+        backward_[b] = static_cast<a_rep>(a);
+        ++pairs_;
+    }
+
+public:
+    // Constructors
+    DenseBijection() = default;
+    DenseBijection(size_type a_size, size_type b_size) : forward_(a_size, no_b), backward_(b_size, no_a) {
+        if (a_size > no_a || b_size > no_b) throw std::length_error("DenseBijection::DenseBijection");
+    }
+
+    // Bulk build from image[a] = b; image must be a permutation of [0, size)
+    [[nodiscard]] static DenseBijection from_permutation(std::span<const BIndex> image) {
+        DenseBijection result;
+        result.rebuild(image);
+        return result;
+    }
+
+    [[nodiscard]] static DenseBijection from_permutation(const DenseVector<BIndex, AIndex>& image) {
+        return from_permutation(std::span<const BIndex>(image.data(), image.size()));
+    }
+
+    // Replace the whole mapping with image[a] = b, reusing storage. Throws
+    // std::invalid_argument, leaving the bijection empty, if image is not a
+    // permutation.
+    void rebuild(std::span<const BIndex> image) {
+        const auto n = image.size();
+        if (n > no_a || n > no_b) throw std::length_error("DenseBijection::rebuild");
+        forward_.resize(n);
+        backward_.assign(n, no_a);
+        for (std::size_t a = 0; a < n; ++a) {
+            const auto b = get_index_value(image[a]);
+            if (b >= n || backward_[b] != no_a) {
+                forward_.clear();
+                backward_.clear();
+                pairs_ = 0;
+                throw std::invalid_argument("DenseBijection::rebuild: not a permutation");
+            }
+            forward_[a] = static_cast<b_rep>(b);
+            backward_[b] = static_cast<a_rep>(a);
+        }
+        pairs_ = n;
+    }
+
+    // Lookups; map and inverse require the index to be paired
+    [[nodiscard]] BIndex map(AIndex a) const noexcept { return BIndex(forward_[get_index_value(a)]); }
+    [[nodiscard]] AIndex inverse(BIndex b) const noexcept { return AIndex(backward_[get_index_value(b)]); }
+
+    [[nodiscard]] std::optional<BIndex> find(AIndex a) const noexcept {
+        const auto i = get_index_value(a);
+        if (i >= forward_.size() || forward_[i] == no_b) return std::nullopt;
+        return BIndex(forward_[i]);
+    }
+
+    [[nodiscard]] std::optional<AIndex> find_inverse(BIndex b) const noexcept {
+        const auto i = get_index_value(b);
+        if (i >= backward_.size() || backward_[i] == no_a) return std::nullopt;
+        return AIndex(backward_[i]);
+    }
+
+    [[nodiscard]] BIndex at(AIndex a) const {
+        if (auto b = find(a)) return *b;
+        throw std::out_of_range("DenseBijection::at");
+    }
+
+    [[nodiscard]] AIndex at_inverse(BIndex b) const {
+        if (auto a = find_inverse(b)) return *a;
+        throw std::out_of_range("DenseBijection::at_inverse");
+    }
+
+    [[nodiscard]] bool contains(AIndex a) const noexcept { return find(a).has_value(); }
+    [[nodiscard]] bool contains_inverse(BIndex b) const noexcept { return find_inverse(b).has_value(); }
+
+    // Pair a with b, first unpairing whatever either was paired with
+    void assign(AIndex a, BIndex b) noexcept {
+        const auto ai = get_index_value(a);
+        const auto bi = get_index_value(b);
+        if (forward_[ai] == bi) return;
+        if (forward_[ai] != no_b) unlink(ai, forward_[ai]);
+        if (backward_[bi] != no_a) unlink(backward_[bi], bi);
+        link(ai, bi);
+    }
+
+    // Unpair; false if the index was not paired
+    bool erase(AIndex a) noexcept {
+        const auto ai = get_index_value(a);
+        if (forward_[ai] == no_b) return false;
+        unlink(ai, forward_[ai]);
+        return true;
+    }
+
+    bool erase_inverse(BIndex b) noexcept {
+        const auto bi = get_index_value(b);
+        if (backward_[bi] == no_a) return false;
+        unlink(backward_[bi], bi);
+        return true;
+    }
+
+    // Exchange the images of x and y (either may be unpaired)
+    void swap_images(AIndex x, AIndex y) noexcept {
+        const auto xi = get_index_value(x);
+        const auto yi = get_index_value(y);
+        std::swap(forward_[xi], forward_[yi]);
+        if (forward_[xi] != no_b) backward_[forward_[xi]] = static_cast<a_rep>(xi);
+        if (forward_[yi] != no_b) backward_[forward_[yi]] = static_cast<a_rep>(yi);
+    }
+
+    // Exchange the preimages of x and y (either may be unpaired)
+    void swap_preimages(BIndex x, BIndex y) noexcept {
+        const auto xi = get_index_value(x);
+        const auto yi = get_index_value(y);
+        std::swap(backward_[xi], backward_[yi]);
+        if (backward_[xi] != no_a) forward_[backward_[xi]] = static_cast<b_rep>(xi);
+        if (backward_[yi] != no_a) forward_[backward_[yi]] = static_cast<b_rep>(yi);
+    }
+
+    // Dense packing of the B side: push_back pairs a with a new last B, and
+    // swap_erase removes a's pair by moving the last B into the hole, exactly
+    // as swap-and-pop does on arrays indexed by B. swap_erase returns the A
+    // whose image moved, if any.
+    BIndex push_back(AIndex a) {
+        const auto bi = backward_.size();
+        if (bi >= no_b) throw std::length_error("DenseBijection::push_back");
+        backward_.push_back(no_a);
+        const auto ai = get_index_value(a);
+        if (forward_[ai] != no_b) unlink(ai, forward_[ai]);
+        link(ai, bi);
+        return BIndex(bi);
+    }
+
+    std::optional<AIndex> swap_erase(AIndex a) {
+        const auto ai = get_index_value(a);
+        if (ai >= forward_.size() || forward_[ai] == no_b) throw std::out_of_range("DenseBijection::swap_erase");
+        const std::size_t hole = forward_[ai];
+        const auto last = backward_.size() - 1;
+        unlink(ai, hole);
+        std::optional<AIndex> moved;
+        if (hole != last && backward_[last] != no_a) {
+            const std::size_t other = backward_[last];
+            unlink(other, last);
+            link(other, hole);
+            moved = AIndex(other);
+        }
+        backward_.pop_back();
+        return moved;
+    }
+
+    // Domain sizes; shrinking a domain unpairs the indices cut off
+    void resize(size_type a_size, size_type b_size) {
+        if (a_size > no_a || b_size > no_b) throw std::length_error("DenseBijection::resize");
+        for (auto a = a_size; a < forward_.size(); ++a) {
+            if (forward_[a] != no_b) unlink(a, forward_[a]);
+        }
+        for (auto b = b_size; b < backward_.size(); ++b) {
+            if (backward_[b] != no_a) unlink(backward_[b], b);
+        }
+        forward_.resize(a_size, no_b);
+        backward_.resize(b_size, no_a);
+    }
+
+    void reserve(size_type a_size, size_type b_size) {
+        forward_.reserve(a_size);
+        backward_.reserve(b_size);
+    }
+
+    void clear() noexcept {
+        std::fill(forward_.begin(), forward_.end(), no_b);
+        std::fill(backward_.begin(), backward_.end(), no_a);
+        pairs_ = 0;
+    }
+
+    [[nodiscard]] size_type a_size() const noexcept { return forward_.size(); }
+    [[nodiscard]] size_type b_size() const noexcept { return backward_.size(); }
+    [[nodiscard]] size_type size() const noexcept { return pairs_; }
+    [[nodiscard]] bool empty() const noexcept { return pairs_ == 0; }
+    [[nodiscard]] IndexRange<AIndex> a_indices() const { return IndexRange<AIndex>(AIndex(0), AIndex(forward_.size())); }
+    [[nodiscard]] IndexRange<BIndex> b_indices() const { return IndexRange<BIndex>(BIndex(0), BIndex(backward_.size())); }
+
+    // f(AIndex, BIndex) for every pair, in A order
+    template<typename F>
+        requires std::invocable<F&, AIndex, BIndex>
+    void for_each(F&& f) const {
+        for (std::size_t a = 0; a < forward_.size(); ++a) {
+            if (forward_[a] != no_b) f(AIndex(a), BIndex(forward_[a]));
+        }
+    }
+
+    // The same pairs viewed from the B side
+    [[nodiscard]] DenseBijection<BIndex, AIndex> inverted() const {
+        DenseBijection<BIndex, AIndex> result(backward_.size(), forward_.size());
+        for_each([&](AIndex a, BIndex b) { result.assign(b, a); });
+        return result;
+    }
+
+    [[nodiscard]] bool operator==(const DenseBijection& other) const noexcept {
+        return forward_ == other.forward_ && backward_ == other.backward_;
+    }
+};
+
+// Set of indices stored as sorted, disjoint, non-adjacent half-open runs, so a
+// long dirty or free range costs one entry. Point and range updates find their
+// place by binary search and coalesce with their neighbours; set algebra is a
+// linear merge over the runs.
+template<StrongIndexType IndexType>
+class DenseIntervalSet {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+    using range_type = IndexRange<IndexType>;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+
+    struct Run {
+        rep_type first;
+        rep_type last;
+        [[nodiscard]] bool operator==(const Run&) const noexcept = default;
+    };
+
+    std::vector<Run> runs_;
+    size_type head_ = 0;  // runs_[0, head_) were drained by pop_front and await compaction
+    size_type count_ = 0;
+
+    [[nodiscard]] auto live_begin() noexcept { return runs_.begin() + static_cast<std::ptrdiff_t>(head_); }
+    [[nodiscard]] auto live_begin() const noexcept { return runs_.begin() + static_cast<std::ptrdiff_t>(head_); }
+    [[nodiscard]] std::span<const Run> live() const noexcept { return std::span<const Run>(runs_).subspan(head_); }
+
+    void compact() {
+        runs_.erase(runs_.begin(), live_begin());
+        head_ = 0;
+    }
+
+    // First run that ends at or after x (touching runs coalesce)
+    [[nodiscard]] auto touching_from(std::size_t x) noexcept {
+        return std::ranges::lower_bound(live_begin(), runs_.end(), x, std::less<>{},
+                                        [](const Run& r) { return std::size_t{r.last}; });
+    }
+
+    // First run that starts after x
+    [[nodiscard]] auto starting_after(std::size_t x) const noexcept {
+        return std::ranges::upper_bound(live_begin(), runs_.end(), x, std::less<>{},
+                                        [](const Run& r) { return std::size_t{r.first}; });
+    }
+
+    [[nodiscard]] static range_type to_range(const Run& r) { return range_type(IndexType(r.first), IndexType(r.last)); }
+
+    // Append [first, last) to a run list being built in order
+    static void append(std::vector<Run>& out, size_type& count, std::size_t first, std::size_t last) {
+        if (first >= last) return;
+        if (!out.empty() && out.back().last >= first) {
+            if (last > out.back().last) {
+                count += last - out.back().last;
+                out.back().last = static_cast<rep_type>(last);
+            }
+            return;
+        }
+        out.push_back({static_cast<rep_type>(first), static_cast<rep_type>(last)});
+        count += last - first;
+    }
+
+public:
+    // Iterates every contained index in increasing order
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IndexType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IndexType;
+
+        iterator() = default;
+        iterator(const Run* run, const Run* end) noexcept : run_(run), end_(end), pos_(run != end ? run->first : 0) {}
+
+        [[nodiscard]] IndexType operator*() const noexcept { return IndexType(pos_); }
+
+        iterator& operator++() noexcept {
+            if (++pos_ == run_->last) {
+                ++run_;
+                pos_ = run_ != end_ ? run_->first : 0;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) noexcept {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        [[nodiscard]] bool operator==(const iterator& other) const noexcept { return run_ == other.run_ && pos_ == other.pos_; }
+
+    private:
+        const Run* run_ = nullptr;
+        const Run* end_ = nullptr;
+        std::size_t pos_ = 0;
+    };
+    using const_iterator = iterator;
+
+    // Constructors
+    DenseIntervalSet() = default;
+
+    DenseIntervalSet(std::initializer_list<range_type> ranges) {
+        for (const auto& r : ranges) insert(r);
+    }
+
+    // Runs of the set bits of a bitset; whole-zero and whole-one words are
+    // skipped a word at a time
+    [[nodiscard]] static DenseIntervalSet from_bitset(const DenseBitset<IndexType>& bits) {
+        using word_type = typename DenseBitset<IndexType>::word_type;
+        constexpr std::size_t word_bits = DenseBitset<IndexType>::bits_per_word;
+        const auto words = bits.words();
+        DenseIntervalSet result;
+        std::size_t i = 0;
+        const auto total = words.size() * word_bits;
+        // Next position >= i whose bit equals `set`, or total
+        const auto scan = [&](std::size_t from, bool set) {
+            auto w = from / word_bits;
+            if (w >= words.size()) return total;
+            const word_type flip = set ? 0 : ~word_type{0};
+            auto word = (words[w] ^ flip) & (~word_type{0} << (from % word_bits));
+            while (word == 0) {
+                if (++w == words.size()) return total;
+                word = words[w] ^ flip;
+            }
+            return w * word_bits + static_cast<std::size_t>(std::countr_zero(word));
+        };
+        while ((i = scan(i, true)) < total) {
+            const auto end = std::min(scan(i, false), bits.size());
+            append(result.runs_, result.count_, i, end);
+            i = end;
+        }
+        return result;
+    }
+
+    // Bitset over [0, domain_size); throws if an index falls outside it
+    [[nodiscard]] DenseBitset<IndexType> to_bitset(size_type domain_size) const {
+        if (!empty() && runs_.back().last > domain_size) throw std::out_of_range("DenseIntervalSet::to_bitset");
+        using word_type = typename DenseBitset<IndexType>::word_type;
+        constexpr std::size_t word_bits = DenseBitset<IndexType>::bits_per_word;
+        DenseBitset<IndexType> bits(domain_size);
+        auto words = bits.words();
+        for (const auto& r : live()) {
+            const std::size_t first_word = r.first / word_bits;
+            const std::size_t last_word = (r.last - 1) / word_bits;
+            const word_type head = ~word_type{0} << (r.first % word_bits);
+            const word_type tail = ~word_type{0} >> (word_bits - 1 - (r.last - 1) % word_bits);
+            if (first_word == last_word) {
+                words[first_word] |= head & tail;
+                continue;
+            }
+            words[first_word] |= head;
+            std::fill(words.begin() + static_cast<std::ptrdiff_t>(first_word + 1), words.begin() + static_cast<std::ptrdiff_t>(last_word),
+                      ~word_type{0});
+            words[last_word] |= tail;
+        }
+        return bits;
+    }
+
+    // Lookup
+    [[nodiscard]] bool contains(IndexType idx) const noexcept {
+        const auto x = get_index_value(idx);
+        const auto it = starting_after(x);
+        return it != live_begin() && x < std::prev(it)->last;
+    }
+
+    // True if every index of range is in the set
+    [[nodiscard]] bool contains(range_type range) const noexcept {
+        if (range.empty()) return true;
+        const auto x = get_index_value(range.first());
+        const auto it = starting_after(x);
+        return it != live_begin() && get_index_value(range.last()) <= std::prev(it)->last;
+    }
+
+    // First contained index at or after idx
+    [[nodiscard]] std::optional<IndexType> find_next(IndexType idx) const noexcept {
+        const auto x = get_index_value(idx);
+        auto it = starting_after(x);
+        if (it != live_begin() && x < std::prev(it)->last) return idx;
+        if (it == runs_.end()) return std::nullopt;
+        return IndexType(it->first);
+    }
+
+    [[nodiscard]] IndexType front() const noexcept { return IndexType(runs_[head_].first); }
+    [[nodiscard]] IndexType back() const noexcept { return IndexType(runs_.back().last - 1); }
+
+    // Modifiers
+    void insert(IndexType idx) { insert(range_type(idx, IndexType(get_index_value(idx) + 1))); }
+
+    void insert(range_type range) {
+        if (range.empty()) return;
+        auto first = get_index_value(range.first());
+        auto last = get_index_value(range.last());
+        const auto lo = touching_from(first);
+        // Runs in [lo, hi) overlap or touch the new one
+        const auto hi = std::ranges::upper_bound(lo, runs_.end(), last, std::less<>{}, [](const Run& r) { return std::size_t{r.first}; });
+        if (lo == hi) {
+            if (lo == live_begin() && head_ > 0) {
+                // New smallest run; reuse the slot pop_front drained last
+                runs_[--head_] = Run{static_cast<rep_type>(first), static_cast<rep_type>(last)};
+                count_ += last - first;
+                return;
+            }
+            runs_.insert(lo, Run{static_cast<rep_type>(first), static_cast<rep_type>(last)});
+            count_ += last - first;
+            return;
+        }
+        first = std::min<std::size_t>(first, lo->first);
+        last = std::max<std::size_t>(last, std::prev(hi)->last);
+        for (auto it = lo; it != hi; ++it) count_ -= it->last - it->first;
+        count_ += last - first;
+        *lo = Run{static_cast<rep_type>(first), static_cast<rep_type>(last)};
+        runs_.erase(lo + 1, hi);
+    }
+
+    void erase(IndexType idx) { erase(range_type(idx, IndexType(get_index_value(idx) + 1))); }
+
+    void erase(range_type range) {
+        if (range.empty()) return;
+        const auto first = get_index_value(range.first());
+        const auto last = get_index_value(range.last());
+        // Runs in [lo, hi) intersect [first, last)
+        const auto lo = std::ranges::upper_bound(live_begin(), runs_.end(), first, std::less<>{},
+                                                 [](const Run& r) { return std::size_t{r.last}; });
+        const auto hi = std::ranges::lower_bound(lo, runs_.end(), last, std::less<>{}, [](const Run& r) { return std::size_t{r.first}; });
+        if (lo == hi) return;
+        const Run left{lo->first, static_cast<rep_type>(first)};
+        const Run right{static_cast<rep_type>(last), std::prev(hi)->last};
+        for (auto it = lo; it != hi; ++it) count_ -= it->last - it->first;
+        std::array<Run, 2> keep{};
+        std::size_t kept = 0;
+        if (left.first < left.last) keep[kept++] = left;
+        if (right.first < right.last) keep[kept++] = right;
+        for (std::size_t k = 0; k < kept; ++k) count_ += keep[k].last - keep[k].first;
+        const auto at = lo - runs_.begin();
+        const auto removed = static_cast<std::size_t>(hi - lo);
+        if (kept <= removed) {
+            std::copy_n(keep.begin(), kept, lo);
+            runs_.erase(lo + static_cast<std::ptrdiff_t>(kept), hi);
+        } else {
+            // Splitting one run in two
+            *lo = keep[0];
+            runs_.insert(runs_.begin() + at + 1, keep[1]);
+        }
+    }
+
+    // Remove and return the smallest index, e.g. to hand out a free slot.
+    // Amortized O(1): a drained front run is skipped, not erased, and the
+    // skipped prefix is compacted once it makes up half the run vector.
+    std::optional<IndexType> pop_front() {
+        if (empty()) return std::nullopt;
+        auto& front_run = runs_[head_];
+        const IndexType idx(front_run.first);
+        if (++front_run.first == front_run.last && ++head_ * 2 >= runs_.size()) compact();
+        --count_;
+        return idx;
+    }
+
+    void clear() noexcept {
+        runs_.clear();
+        head_ = 0;
+        count_ = 0;
+    }
+
+    void reserve(size_type runs) { runs_.reserve(head_ + runs); }
+
+    // Size
+    [[nodiscard]] size_type size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return head_ == runs_.size(); }
+    [[nodiscard]] size_type run_count() const noexcept { return runs_.size() - head_; }
+
+    // Runs as typed ranges, in increasing order
+    [[nodiscard]] range_type run(size_type i) const { return to_range(runs_[head_ + i]); }
+    [[nodiscard]] auto runs() const { return live() | std::views::transform([](const Run& r) { return to_range(r); }); }
+
+    // Iterators
+    [[nodiscard]] iterator begin() const noexcept {
+        return iterator(runs_.data() + head_, runs_.data() + runs_.size());
+    }
+    [[nodiscard]] iterator end() const noexcept { return iterator(runs_.data() + runs_.size(), runs_.data() + runs_.size()); }
+
+    // f(IndexType) for every index, in increasing order
+    template<typename F>
+        requires std::invocable<F&, IndexType>
+    void for_each(F&& f) const {
+        for (const auto& r : live()) {
+            for (std::size_t i = r.first; i < r.last; ++i) f(IndexType(i));
+        }
+    }
+
+    // f(range_type) for every run, in increasing order
+    template<typename F>
+        requires std::invocable<F&, range_type>
+    void for_each_run(F&& f) const {
+        for (const auto& r : live()) f(to_range(r));
+    }
+
+    // Set algebra, linear in the number of runs
+    DenseIntervalSet& operator|=(const DenseIntervalSet& other) {
+        const auto mine = live();
+        const auto theirs = other.live();
+        std::vector<Run> out;
+        out.reserve(mine.size() + theirs.size());
+        size_type count = 0;
+        auto a = mine.begin();
+        auto b = theirs.begin();
+        while (a != mine.end() || b != theirs.end()) {
+            const bool take_a = b == theirs.end() || (a != mine.end() && a->first <= b->first);
+            const auto& r = take_a ? *a++ : *b++;
+            append(out, count, r.first, r.last);
+        }
+        runs_ = std::move(out);
+        head_ = 0;
+        count_ = count;
+        return *this;
+    }
+
+    DenseIntervalSet& operator&=(const DenseIntervalSet& other) {
+        const auto mine = live();
+        const auto theirs = other.live();
+        std::vector<Run> out;
+        size_type count = 0;
+        auto a = mine.begin();
+        auto b = theirs.begin();
+        while (a != mine.end() && b != theirs.end()) {
+            append(out, count, std::max(a->first, b->first), std::min(a->last, b->last));
+            if (a->last < b->last) {
+                ++a;
+            } else {
+                ++b;
+            }
+        }
+        runs_ = std::move(out);
+        head_ = 0;
+        count_ = count;
+        return *this;
+    }
+
+    DenseIntervalSet& operator-=(const DenseIntervalSet& other) {
+        const auto theirs = other.live();
+        std::vector<Run> out;
+        size_type count = 0;
+        auto b = theirs.begin();
+        for (const auto& r : live()) {
+            std::size_t first = r.first;
+            while (b != theirs.end() && b->last <= first) ++b;
+            for (auto c = b; c != theirs.end() && c->first < r.last; ++c) {
+                append(out, count, first, c->first);
+                first = std::max<std::size_t>(first, c->last);
+            }
+            append(out, count, first, r.last);
+        }
+        runs_ = std::move(out);
+        head_ = 0;
+        count_ = count;
+        return *this;
+    }
+
+    [[nodiscard]] friend DenseIntervalSet operator|(DenseIntervalSet a, const DenseIntervalSet& b) { return a |= b; }
+    [[nodiscard]] friend DenseIntervalSet operator&(DenseIntervalSet a, const DenseIntervalSet& b) { return a &= b; }
+    [[nodiscard]] friend DenseIntervalSet operator-(DenseIntervalSet a, const DenseIntervalSet& b) { return a -= b; }
+
+    [[nodiscard]] bool operator==(const DenseIntervalSet& other) const noexcept {
+        return std::ranges::equal(live(), other.live());
+    }
+};
+
+namespace detail {
+
+// Index of the first nonzero word in [from, n), or n
+[[nodiscard]] inline std::size_t next_nonzero_word(const std::uint64_t* words, std::size_t from, std::size_t n) noexcept {
+    std::size_t i = from;
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+        const __m512i v = _mm512_loadu_si512(words + i);
+        if (const auto mask = _mm512_test_epi64_mask(v, v)) return i + static_cast<std::size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        if (!_mm256_testz_si256(v, v)) break;
+    }
+#endif
+    for (; i < n; ++i) {
+        if (words[i] != 0) return i;
+    }
+    return n;
+}
+
+} // namespace detail
+
+// Vector whose erase leaves a hole instead of shifting, so every other index
+// stays valid. Holes form an intrusive free list threaded through the slots
+// themselves and are reused, most recent first, by the next emplace. An
+// occupancy bitset lets iteration skip holes, 64 slots per word and several
+// words per SIMD test. There are no generations: a stale index to a reused
+// slot is not detected, so callers own handle lifetimes.
+template<typename T, StrongIndexType IndexType>
+class DenseStableVector {
+public:
+    using value_type = T;
+    using index_type = IndexType;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+    static constexpr rep_type no_slot = std::numeric_limits<rep_type>::max();
+
+    union Slot {
+        T value;
+        rep_type next_free;
+
+        Slot() noexcept : next_free(no_slot) {}
+        ~Slot() {}
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_type capacity_ = 0;
+    size_type end_ = 0;  // slots [0, end_) are live or on the free list
+    size_type live_ = 0;
+    rep_type free_head_ = no_slot;
+    DenseBitset<IndexType> occupied_;
+
+    // Move live values and free links into fresh, a buffer of new_capacity
+    // slots. The old values are destroyed only once every new one is built, so
+    // a throwing copy unwinds fresh and leaves this vector as it was.
+    void relocate(std::unique_ptr<Slot[]>& fresh, size_type new_capacity) {
+        size_type built = 0;
+        try {
+            for_each_slot([&](size_type i) {
+                std::construct_at(&fresh[i].value, std::move_if_noexcept(slots_[i].value));
+                ++built;
+            });
+        } catch (...) {
+            for_each_slot([&](size_type i) {
+                if (built > 0) {
+                    std::destroy_at(&fresh[i].value);
+                    --built;
+                }
+            });
+            throw;
+        }
+        for (size_type i = 0; i < end_; ++i) {
+            if (!occupied_.test(IndexType(i))) fresh[i].next_free = slots_[i].next_free;
+        }
+        destroy_all();
+        slots_ = std::move(fresh);
+        capacity_ = new_capacity;
+    }
+
+    void reallocate(size_type new_capacity) {
+        auto fresh = std::make_unique<Slot[]>(new_capacity);
+        relocate(fresh, new_capacity);
+    }
+
+    void destroy_all() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for_each_slot([&](size_type i) { std::destroy_at(&slots_[i].value); });
+        }
+    }
+
+    template<typename F>
+    void for_each_slot(F&& f) const {
+        const auto words = occupied_.words();
+        for (auto w = detail::next_nonzero_word(words.data(), 0, words.size()); w < words.size();
+             w = detail::next_nonzero_word(words.data(), w + 1, words.size())) {
+            detail::for_each_set_bit(words[w], w * 64, f);
+        }
+    }
+
+    // First live slot at or after i, or end_
+    [[nodiscard]] size_type next_live(size_type i) const noexcept {
+        if (i >= end_) return end_;
+        const auto words = occupied_.words();
+        auto w = i / 64;
+        const auto word = words[w] & (~std::uint64_t{0} << (i % 64));
+        if (word != 0) return w * 64 + static_cast<size_type>(std::countr_zero(word));
+        w = detail::next_nonzero_word(words.data(), w + 1, words.size());
+        return w < words.size() ? w * 64 + static_cast<size_type>(std::countr_zero(words[w])) : end_;
+    }
+
+    template<bool Const>
+    class basic_iterator {
+        using owner = std::conditional_t<Const, const DenseStableVector, DenseStableVector>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        basic_iterator() = default;
+        basic_iterator(owner* v, size_type i) noexcept : v_(v), i_(i) {}
+
+        // Implicit mutable to const conversion
+        operator basic_iterator<true>() const noexcept
+            requires(!Const)
+        {
+            return basic_iterator<true>(v_, i_);
+        }
+
+        [[nodiscard]] reference operator*() const noexcept { return v_->slots_[i_].value; }
+        [[nodiscard]] pointer operator->() const noexcept { return &v_->slots_[i_].value; }
+        [[nodiscard]] IndexType index() const noexcept { return IndexType(i_); }
+
+        basic_iterator& operator++() noexcept {
+            i_ = v_->next_live(i_ + 1);
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept { return i_ == other.i_; }
+
+    private:
+        owner* v_ = nullptr;
+        size_type i_ = 0;
+    };
+
+public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // Constructors
+    DenseStableVector() = default;
+
+    DenseStableVector(const DenseStableVector& other)
+        : slots_(other.capacity_ ? std::make_unique<Slot[]>(other.capacity_) : nullptr), capacity_(other.capacity_), end_(other.end_),
+          live_(other.live_), free_head_(other.free_head_), occupied_(other.occupied_) {
+        for (size_type i = 0; i < end_; ++i) {
+            if (!occupied_.test(IndexType(i))) slots_[i].next_free = other.slots_[i].next_free;
+        }
+        size_type built = 0;
+        try {
+            other.for_each_slot([&](size_type i) {
+                std::construct_at(&slots_[i].value, other.slots_[i].value);
+                ++built;
+            });
+        } catch (...) {
+            other.for_each_slot([&](size_type i) {
+                if (built > 0) {
+                    std::destroy_at(&slots_[i].value);
+                    --built;
+                }
+            });
+            throw;
+        }
+    }
+
+    DenseStableVector(DenseStableVector&& other) noexcept
+        : slots_(std::move(other.slots_)), capacity_(std::exchange(other.capacity_, 0)), end_(std::exchange(other.end_, 0)),
+          live_(std::exchange(other.live_, 0)), free_head_(std::exchange(other.free_head_, no_slot)),
+          occupied_(std::move(other.occupied_)) {
+        other.occupied_ = DenseBitset<IndexType>();
+    }
+
+    DenseStableVector& operator=(const DenseStableVector& other) {
+        if (this != &other) {
+            DenseStableVector copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    DenseStableVector& operator=(DenseStableVector&& other) noexcept {
+        if (this != &other) {
+            destroy_all();
+            slots_ = std::move(other.slots_);
+            capacity_ = std::exchange(other.capacity_, 0);
+            end_ = std::exchange(other.end_, 0);
+            live_ = std::exchange(other.live_, 0);
+            free_head_ = std::exchange(other.free_head_, no_slot);
+            occupied_ = std::move(other.occupied_);
+            other.occupied_ = DenseBitset<IndexType>();
+        }
+        return *this;
+    }
+
+    ~DenseStableVector() { destroy_all(); }
+
+    // Element access; the index must refer to a live element
+    [[nodiscard]] reference operator[](IndexType idx) noexcept { return slots_[get_index_value(idx)].value; }
+    [[nodiscard]] const_reference operator[](IndexType idx) const noexcept { return slots_[get_index_value(idx)].value; }
+
+    reference operator[](size_type) = delete;
+    const_reference operator[](size_type) const = delete;
+
+    [[nodiscard]] reference at(IndexType idx) {
+        if (!contains(idx)) throw std::out_of_range("DenseStableVector::at");
+        return (*this)[idx];
+    }
+
+    [[nodiscard]] const_reference at(IndexType idx) const {
+        if (!contains(idx)) throw std::out_of_range("DenseStableVector::at");
+        return (*this)[idx];
+    }
+
+    [[nodiscard]] bool contains(IndexType idx) const noexcept {
+        const auto i = get_index_value(idx);
+        return i < end_ && occupied_.test(idx);
+    }
+
+    // Modifiers
+    template<typename... Args>
+        requires std::constructible_from<T, Args...>
+    [[nodiscard]] IndexType emplace(Args&&... args) {
+        size_type i = free_head_;
+        if (free_head_ != no_slot) {
+            const auto next = slots_[i].next_free;
+            try {
+                std::construct_at(&slots_[i].value, std::forward<Args>(args)...);
+            } catch (...) {
+                slots_[i].next_free = next;
+                throw;
+            }
+            free_head_ = next;
+        } else {
+            if (end_ >= no_slot) throw std::length_error("DenseStableVector::emplace");
+            i = end_;
+            // Grow the bitset first so nothing can throw once the value exists;
+            // a spare clear bit past end_ is harmless if the construction throws
+            occupied_.resize(end_ + 1);
+            if (end_ == capacity_) {
+                // Build the value before relocating, as args may refer to an element
+                const auto new_capacity = std::max<size_type>(16, capacity_ * 2);
+                auto fresh = std::make_unique<Slot[]>(new_capacity);
+                std::construct_at(&fresh[i].value, std::forward<Args>(args)...);
+                try {
+                    relocate(fresh, new_capacity);
+                } catch (...) {
+                    std::destroy_at(&fresh[i].value);
+                    throw;
+                }
+            } else {
+                std::construct_at(&slots_[i].value, std::forward<Args>(args)...);
+            }
+            ++end_;
+        }
+        occupied_.set(IndexType(i));
+        ++live_;
+        return IndexType(i);
+    }
+
+    [[nodiscard]] IndexType insert(const T& value) { return emplace(value); }
+    [[nodiscard]] IndexType insert(T&& value) { return emplace(std::move(value)); }
+
+    // Destroy the element and put its slot on the free list
+    void erase(IndexType idx) noexcept {
+        const auto i = get_index_value(idx);
+        std::destroy_at(&slots_[i].value);
+        slots_[i].next_free = free_head_;
+        free_head_ = static_cast<rep_type>(i);
+        occupied_.reset(idx);
+        --live_;
+    }
+
+    void clear() noexcept {
+        destroy_all();
+        end_ = 0;
+        live_ = 0;
+        free_head_ = no_slot;
+        occupied_ = DenseBitset<IndexType>();
+    }
+
+    void reserve(size_type slots) {
+        if (slots > capacity_) reallocate(slots);
+    }
+
+    void swap(DenseStableVector& other) noexcept {
+        slots_.swap(other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(end_, other.end_);
+        std::swap(live_, other.live_);
+        std::swap(free_head_, other.free_head_);
+        occupied_.swap(other.occupied_);
+    }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return live_; }
+    [[nodiscard]] bool empty() const noexcept { return live_ == 0; }
+    [[nodiscard]] size_type slot_count() const noexcept { return end_; }  // every index ever handed out is below this
+    [[nodiscard]] size_type hole_count() const noexcept { return end_ - live_; }
+    [[nodiscard]] size_type capacity() const noexcept { return capacity_; }
+    [[nodiscard]] const DenseBitset<IndexType>& occupancy() const noexcept { return occupied_; }
+
+    // Iterators over live elements, in index order; it.index() gives the index
+    [[nodiscard]] iterator begin() noexcept { return iterator(this, next_live(0)); }
+    [[nodiscard]] iterator end() noexcept { return iterator(this, end_); }
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, next_live(0)); }
+    [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, end_); }
+
+    // f(IndexType, T&) for every live element, in index order
+    template<typename F>
+        requires std::invocable<F&, IndexType, T&>
+    void for_each(F&& f) {
+        for_each_slot([&](size_type i) { f(IndexType(i), slots_[i].value); });
+    }
+
+    template<typename F>
+        requires std::invocable<F&, IndexType, const T&>
+    void for_each(F&& f) const {
+        for_each_slot([&](size_type i) { f(IndexType(i), static_cast<const T&>(slots_[i].value)); });
+    }
+};
+
+// Pool of T addressed by typed 32-bit indices instead of pointers. Storage is
+// allocated in chunks that never move, so an index stays valid until released.
+// Free indices live on a global lock-free stack whose head packs the top index
+// with a tag bumped on every update (ABA protection); the links are per-slot
+// atomics beside the object storage. Threads with high churn should go through
+// a LocalCache, which moves free indices to and from the global stack in
+// batches. All LocalCaches must be destroyed before the pool.
+template<typename T, StrongIndexType IndexType, std::size_t ChunkSize = 4096>
+    requires(std::has_single_bit(ChunkSize))
+class DenseObjectPool {
+public:
+    using value_type = T;
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+    static_assert(sizeof(rep_type) <= sizeof(std::uint32_t), "DenseObjectPool packs indices with a 32-bit tag");
+
+    static constexpr std::uint32_t end_of_list = std::numeric_limits<rep_type>::max();
+    static constexpr std::uint32_t live_mark = end_of_list - 1;  // link value of a slot holding an object
+
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+        std::atomic<std::uint32_t> next{end_of_list};
+    };
+
+    std::unique_ptr<std::atomic<Slot*>[]> chunks_;
+    size_type chunk_count_;
+    size_type capacity_;
+    alignas(64) std::atomic<std::uint64_t> head_;  // tag << 32 | top index
+    alignas(64) std::atomic<size_type> fresh_{0};  // indices below this have been handed out at least once
+
+    [[nodiscard]] static constexpr std::uint64_t pack(std::uint32_t index, std::uint32_t tag) noexcept {
+        return std::uint64_t{tag} << 32 | index;
+    }
+
+    [[nodiscard]] Slot& slot(std::size_t i) const noexcept {
+        return chunks_[i / ChunkSize].load(std::memory_order_acquire)[i % ChunkSize];
+    }
+
+    void ensure_chunk(std::size_t c) {
+        if (chunks_[c].load(std::memory_order_acquire) != nullptr) return;
+        auto fresh = std::make_unique<Slot[]>(ChunkSize);
+        Slot* expected = nullptr;
+        if (chunks_[c].compare_exchange_strong(expected, fresh.get(), std::memory_order_acq_rel)) fresh.release();
+    }
+
+    // Claim up to n never-used indices; returns the first and how many
+    [[nodiscard]] std::pair<size_type, size_type> claim_fresh(size_type n) {
+        auto first = fresh_.load(std::memory_order_relaxed);
+        size_type count;
+        do {
+            count = std::min(n, capacity_ - first);
+            if (count == 0) return {first, 0};
+        } while (!fresh_.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+        for (auto c = first / ChunkSize; c <= (first + count - 1) / ChunkSize; ++c) ensure_chunk(c);
+        return {first, count};
+    }
+
+    // Push the chain first -> ... -> last (already linked) in one CAS
+    void push_chain(std::uint32_t first, std::uint32_t last) noexcept {
+        auto head = head_.load(std::memory_order_relaxed);
+        Slot& tail = slot(last);
+        do {
+            tail.next.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, pack(first, static_cast<std::uint32_t>(head >> 32) + 1), std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    [[nodiscard]] std::optional<std::uint32_t> pop() noexcept {
+        auto head = head_.load(std::memory_order_acquire);
+        while (true) {
+            const auto top = static_cast<std::uint32_t>(head);
+            if (top == end_of_list) return std::nullopt;
+            // The slot may be popped and reused under us; the tag then fails the CAS
+            const auto next = slot(top).next.load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, pack(next, static_cast<std::uint32_t>(head >> 32) + 1), std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                return top;
+            }
+        }
+    }
+
+    [[nodiscard]] std::uint32_t take_one() {
+        if (auto i = pop()) return *i;
+        const auto [first, count] = claim_fresh(1);
+        if (count == 0) throw std::length_error("DenseObjectPool::acquire: pool exhausted");
+        return static_cast<std::uint32_t>(first);
+    }
+
+    template<typename... Args>
+    [[nodiscard]] IndexType construct(std::uint32_t i, Args&&... args) {
+        Slot& s = slot(i);
+        std::construct_at(reinterpret_cast<T*>(s.storage), std::forward<Args>(args)...);
+        s.next.store(live_mark, std::memory_order_relaxed);
+        return IndexType(i);
+    }
+
+    void destroy(std::uint32_t i) noexcept {
+        Slot& s = slot(i);
+        std::destroy_at(std::launder(reinterpret_cast<T*>(s.storage)));
+        s.next.store(end_of_list, std::memory_order_relaxed);
+    }
+
+public:
+    // Up to max_objects live at once (below 2^32 - 2 and the index type's range)
+    explicit DenseObjectPool(size_type max_objects = size_type{1} << 20)
+        : chunk_count_((max_objects + ChunkSize - 1) / ChunkSize), capacity_(max_objects), head_(pack(end_of_list, 0)) {
+        if (max_objects >= live_mark) throw std::length_error("DenseObjectPool::DenseObjectPool");
+        chunks_ = std::make_unique<std::atomic<Slot*>[]>(chunk_count_);
+        for (size_type c = 0; c < chunk_count_; ++c) chunks_[c].store(nullptr, std::memory_order_relaxed);
+    }
+
+    DenseObjectPool(const DenseObjectPool&) = delete;
+    DenseObjectPool& operator=(const DenseObjectPool&) = delete;
+
+    // Destroys objects still live; no other thread may be using the pool
+    ~DenseObjectPool() {
+        const auto used = fresh_.load(std::memory_order_acquire);
+        for (size_type i = 0; i < used; ++i) {
+            if (slot(i).next.load(std::memory_order_relaxed) == live_mark) destroy(static_cast<std::uint32_t>(i));
+        }
+        for (size_type c = 0; c < chunk_count_; ++c) delete[] chunks_[c].load(std::memory_order_relaxed);
+    }
+
+    // Construct a T in a free slot; thread-safe
+    template<typename... Args>
+        requires std::constructible_from<T, Args...>
+    [[nodiscard]] IndexType acquire(Args&&... args) {
+        const auto i = take_one();
+        try {
+            return construct(i, std::forward<Args>(args)...);
+        } catch (...) {
+            push_chain(i, i);
+            throw;
+        }
+    }
+
+    // Destroy the object and return its slot; thread-safe
+    void release(IndexType idx) noexcept {
+        const auto i = static_cast<std::uint32_t>(get_index_value(idx));
+        destroy(i);
+        push_chain(i, i);
+    }
+
+    // Access a live object
+    [[nodiscard]] T& operator[](IndexType idx) noexcept {
+        return *std::launder(reinterpret_cast<T*>(slot(get_index_value(idx)).storage));
+    }
+
+    [[nodiscard]] const T& operator[](IndexType idx) const noexcept {
+        return *std::launder(reinterpret_cast<const T*>(slot(get_index_value(idx)).storage));
+    }
+
+    T& operator[](size_type) = delete;
+    const T& operator[](size_type) const = delete;
+
+    [[nodiscard]] size_type capacity() const noexcept { return capacity_; }
+    [[nodiscard]] size_type slots_used() const noexcept { return fresh_.load(std::memory_order_relaxed); }
+
+    // Per-thread front end holding up to CacheSize free indices. acquire and
+    // release touch only the cache; the global stack is visited once per
+    // CacheSize / 2 operations. Not thread-safe itself: one per thread.
+    template<std::size_t CacheSize = 64>
+        requires(CacheSize >= 2)
+    class LocalCache {
+        DenseObjectPool* pool_;
+        std::array<std::uint32_t, CacheSize> free_{};
+        std::size_t count_ = 0;
+
+        void refill() {
+            while (count_ < CacheSize / 2) {
+                auto i = pool_->pop();
+                if (!i) break;
+                free_[count_++] = *i;
+            }
+            if (count_ > 0) return;
+            const auto [first, count] = pool_->claim_fresh(CacheSize / 2);
+            if (count == 0) throw std::length_error("DenseObjectPool::LocalCache::acquire: pool exhausted");
+            // Hand out the lowest index first
+            for (auto i = first + count; i-- > first;) free_[count_++] = static_cast<std::uint32_t>(i);
+        }
+
+        // Return the older half of the cache to the global stack as one chain
+        void spill(std::size_t n) noexcept {
+            for (std::size_t k = 0; k + 1 < n; ++k) pool_->slot(free_[k]).next.store(free_[k + 1], std::memory_order_relaxed);
+            pool_->push_chain(free_[0], free_[n - 1]);
+            std::copy(free_.begin() + static_cast<std::ptrdiff_t>(n), free_.begin() + static_cast<std::ptrdiff_t>(count_), free_.begin());
+            count_ -= n;
+        }
+
+    public:
+        explicit LocalCache(DenseObjectPool& pool) noexcept : pool_(&pool) {}
+        LocalCache(const LocalCache&) = delete;
+        LocalCache& operator=(const LocalCache&) = delete;
+        ~LocalCache() { flush(); }
+
+        template<typename... Args>
+            requires std::constructible_from<T, Args...>
+        [[nodiscard]] IndexType acquire(Args&&... args) {
+            if (count_ == 0) refill();
+            const auto i = free_[--count_];
+            try {
+                return pool_->construct(i, std::forward<Args>(args)...);
+            } catch (...) {
+                free_[count_++] = i;
+                throw;
+            }
+        }
+
+        void release(IndexType idx) noexcept {
+            const auto i = static_cast<std::uint32_t>(get_index_value(idx));
+            pool_->destroy(i);
+            if (count_ == CacheSize) spill(CacheSize / 2);
+            free_[count_++] = i;
+        }
+
+        // Give every cached index back to the pool
+        void flush() noexcept {
+            if (count_ > 0) spill(count_);
+        }
+
+        [[nodiscard]] std::size_t cached() const noexcept { return count_; }
+    };
+};
+
+namespace detail {
+
+// Allocator returning 64-byte aligned storage
+template<typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+    static constexpr std::align_val_t alignment{64};
+
+    CacheAlignedAllocator() noexcept = default;
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) noexcept {}
+
+    [[nodiscard]] T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), alignment)); }
+    void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, alignment); }
+
+    template<typename U>
+    [[nodiscard]] bool operator==(const CacheAlignedAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+} // namespace detail
+
+// Addressable d-ary heap over an index domain, with decrease-key. Compare
+// orders priorities (std::less: the top is the smallest). A position map from
+// index to heap slot makes contains O(1) and lets decrease_key, update and
+// erase find their entry directly. The heap array is cache-line aligned and
+// offset so the Arity children of a node share one aligned block; with 16-byte
+// entries and Arity = 4 each sift-down step reads a single cache line.
+template<StrongIndexType IndexType, typename Priority, std::size_t Arity = 4, typename Compare = std::less<Priority>>
+    requires(Arity >= 2)
+class DenseIndexedHeap {
+public:
+    using index_type = IndexType;
+    using priority_type = Priority;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+    static constexpr size_type pad = Arity - 1;  // slots before the root
+
+    struct Entry {
+        Priority priority;
+        rep_type index;
+    };
+
+    std::vector<Entry, detail::CacheAlignedAllocator<Entry>> heap_;  // logical position p lives at heap_[p + pad]
+    DenseVector<std::uint32_t, IndexType> position_;
+    [[no_unique_address]] Compare compare_;
+
+    [[nodiscard]] Entry& at_pos(size_type p) noexcept { return heap_[p + pad]; }
+
+    void place(size_type p, const Entry& e) noexcept {
+        at_pos(p) = e;
+        position_[IndexType(e.index)] = static_cast<std::uint32_t>(p);
+    }
+
+    void sift_up(size_type p, Entry e) noexcept {
+        while (p > 0) {
+            const auto parent = (p - 1) / Arity;
+            if (!compare_(e.priority, at_pos(parent).priority)) break;
+            place(p, at_pos(parent));
+            p = parent;
+        }
+        place(p, e);
+    }
+
+    void sift_down(size_type p, Entry e) noexcept {
+        const auto n = size();
+        while (true) {
+            const auto first = Arity * p + 1;
+            if (first >= n) break;
+            const auto last = std::min(first + Arity, n);
+            auto best = first;
+            for (auto c = first + 1; c < last; ++c) {
+                if (compare_(at_pos(c).priority, at_pos(best).priority)) best = c;
+            }
+            if (!compare_(at_pos(best).priority, e.priority)) break;
+            place(p, at_pos(best));
+            p = best;
+        }
+        place(p, e);
+    }
+
+    // Remove the entry at logical position p
+    void remove_at(size_type p) noexcept {
+        position_[IndexType(at_pos(p).index)] = npos;
+        const Entry last = heap_.back();
+        heap_.pop_back();
+        if (p == size()) return;
+        if (p > 0 && compare_(last.priority, at_pos((p - 1) / Arity).priority)) {
+            sift_up(p, last);
+        } else {
+            sift_down(p, last);
+        }
+    }
+
+public:
+    // Constructors
+    explicit DenseIndexedHeap(size_type domain_size = 0, Compare compare = Compare())
+        : heap_(pad), position_(domain_size, npos), compare_(std::move(compare)) {
+        if (domain_size > npos) throw std::length_error("DenseIndexedHeap::DenseIndexedHeap");
+    }
+
+    // Grow the index domain
+    void resize(size_type domain_size) {
+        if (domain_size > npos) throw std::length_error("DenseIndexedHeap::resize");
+        position_.resize(domain_size, npos);
+    }
+
+    void reserve(size_type entries) { heap_.reserve(entries + pad); }
+
+    // Lookup
+    [[nodiscard]] bool contains(IndexType idx) const noexcept { return position_[idx] != npos; }
+    [[nodiscard]] Priority priority(IndexType idx) const noexcept { return heap_[position_[idx] + pad].priority; }
+    [[nodiscard]] IndexType top() const noexcept { return IndexType(heap_[pad].index); }
+    [[nodiscard]] Priority top_priority() const noexcept { return heap_[pad].priority; }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return heap_.size() - pad; }
+    [[nodiscard]] bool empty() const noexcept { return heap_.size() == pad; }
+    [[nodiscard]] size_type domain_size() const noexcept { return position_.size(); }
+
+    // Modifiers
+    // Insert an index that is not in the heap
+    void push(IndexType idx, Priority priority) {
+        heap_.push_back(Entry{priority, static_cast<rep_type>(get_index_value(idx))});
+        sift_up(size() - 1, heap_.back());
+    }
+
+    // Remove and return the top entry
+    std::pair<IndexType, Priority> pop() noexcept {
+        const Entry top_entry = heap_[pad];
+        remove_at(0);
+        return {IndexType(top_entry.index), top_entry.priority};
+    }
+
+    // Move a contained index to a priority that compares no worse
+    void decrease_key(IndexType idx, Priority priority) noexcept {
+        const auto p = position_[idx];
+        sift_up(p, Entry{priority, static_cast<rep_type>(get_index_value(idx))});
+    }
+
+    // Change a contained index's priority in either direction
+    void update(IndexType idx, Priority priority) noexcept {
+        const auto p = position_[idx];
+        const Entry e{priority, static_cast<rep_type>(get_index_value(idx))};
+        if (compare_(priority, at_pos(p).priority)) {
+            sift_up(p, e);
+        } else {
+            sift_down(p, e);
+        }
+    }
+
+    // Insert, or lower the priority if that improves it; true if anything changed.
+    // This is the relaxation step of Dijkstra and Prim.
+    bool push_or_decrease(IndexType idx, Priority priority) {
+        const auto p = position_[idx];
+        if (p == npos) {
+            push(idx, priority);
+            return true;
+        }
+        if (!compare_(priority, at_pos(p).priority)) return false;
+        sift_up(p, Entry{priority, static_cast<rep_type>(get_index_value(idx))});
+        return true;
+    }
+
+    // Remove an index; false if it was not in the heap
+    bool erase(IndexType idx) noexcept {
+        const auto p = position_[idx];
+        if (p == npos) return false;
+        remove_at(p);
+        return true;
+    }
+
+    // O(size), not O(domain)
+    void clear() noexcept {
+        for (size_type p = 0; p < size(); ++p) position_[IndexType(at_pos(p).index)] = npos;
+        heap_.resize(pad);
+    }
+};
+
+// Monotone addressable priority queue for unsigned integer keys (radix heap,
+// Ahuja et al.). Keys pushed or decreased must be no smaller than the last key
+// popped, as in Dijkstra with non-negative integer weights. An entry sits in
+// the bucket given by the highest bit where its key differs from the last
+// popped key; pop only rescans the first non-empty bucket, so each entry moves
+// at most bit-width times over its life. Every operation is amortized
+// O(bit-width), independent of the heap size.
+template<StrongIndexType IndexType, std::unsigned_integral Key = std::uint32_t>
+class DenseRadixHeap {
+public:
+    using index_type = IndexType;
+    using priority_type = Key;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+    static constexpr std::size_t bucket_count = std::numeric_limits<Key>::digits + 1;
+    static constexpr std::uint8_t absent = 0xFF;
+
+    std::array<std::vector<rep_type>, bucket_count> buckets_;
+    DenseVector<Key, IndexType> key_;
+    DenseVector<std::uint8_t, IndexType> bucket_;
+    DenseVector<std::uint32_t, IndexType> slot_;
+    Key last_ = 0;
+    size_type size_ = 0;
+
+    [[nodiscard]] std::size_t bucket_for(Key key) const noexcept {
+        return static_cast<std::size_t>(std::bit_width(static_cast<Key>(key ^ last_)));
+    }
+
+    void place(IndexType idx, std::size_t b) {
+        bucket_[idx] = static_cast<std::uint8_t>(b);
+        slot_[idx] = static_cast<std::uint32_t>(buckets_[b].size());
+        buckets_[b].push_back(static_cast<rep_type>(get_index_value(idx)));
+    }
+
+    void unplace(IndexType idx) noexcept {
+        auto& bucket = buckets_[bucket_[idx]];
+        const auto s = slot_[idx];
+        const IndexType moved(bucket.back());
+        bucket[s] = bucket.back();
+        slot_[moved] = s;
+        bucket.pop_back();
+        bucket_[idx] = absent;
+    }
+
+public:
+    // Constructors
+    explicit DenseRadixHeap(size_type domain_size = 0) : key_(domain_size, Key{}), bucket_(domain_size, absent), slot_(domain_size, 0) {}
+
+    void resize(size_type domain_size) {
+        key_.resize(domain_size, Key{});
+        bucket_.resize(domain_size, absent);
+        slot_.resize(domain_size, 0);
+    }
+
+    // Lookup
+    [[nodiscard]] bool contains(IndexType idx) const noexcept { return bucket_[idx] != absent; }
+    [[nodiscard]] Key priority(IndexType idx) const noexcept { return key_[idx]; }
+    [[nodiscard]] Key last_popped() const noexcept { return last_; }
+    [[nodiscard]] size_type size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] size_type domain_size() const noexcept { return key_.size(); }
+
+    // Modifiers
+    // Insert an index that is not in the heap; key >= last_popped()
+    void push(IndexType idx, Key key) {
+        key_[idx] = key;
+        place(idx, bucket_for(key));
+        ++size_;
+    }
+
+    // Lower a contained index's key, still >= last_popped()
+    void decrease_key(IndexType idx, Key key) {
+        key_[idx] = key;
+        const auto b = bucket_for(key);
+        if (b == bucket_[idx]) return;
+        unplace(idx);
+        place(idx, b);
+    }
+
+    // Insert, or lower the key if that improves it; true if anything changed
+    bool push_or_decrease(IndexType idx, Key key) {
+        if (!contains(idx)) {
+            push(idx, key);
+            return true;
+        }
+        if (key >= key_[idx]) return false;
+        decrease_key(idx, key);
+        return true;
+    }
+
+    // Remove and return an entry with the smallest key
+    std::pair<IndexType, Key> pop() {
+        if (buckets_[0].empty()) {
+            std::size_t b = 1;
+            while (buckets_[b].empty()) ++b;
+            // New minimum, then redistribute the bucket; every entry lands lower
+            Key smallest = std::numeric_limits<Key>::max();
+            for (auto i : buckets_[b]) smallest = std::min(smallest, key_[IndexType(i)]);
+            last_ = smallest;
+            auto moving = std::move(buckets_[b]);
+            buckets_[b].clear();
+            for (auto i : moving) place(IndexType(i), bucket_for(key_[IndexType(i)]));
+            moving.clear();
+            buckets_[b] = std::move(moving);  // keep its capacity
+        }
+        const IndexType idx(buckets_[0].back());
+        buckets_[0].pop_back();
+        bucket_[idx] = absent;
+        --size_;
+        return {idx, key_[idx]};
+    }
+
+    // Remove an index; false if it was not in the heap
+    bool erase(IndexType idx) noexcept {
+        if (!contains(idx)) return false;
+        unplace(idx);
+        --size_;
+        return true;
+    }
+
+    // Empty the heap and reset the monotone floor to zero
+    void clear() noexcept {
+        for (auto& bucket : buckets_) {
+            for (auto i : bucket) bucket_[IndexType(i)] = absent;
+            bucket.clear();
+        }
+        last_ = 0;
+        size_ = 0;
+    }
+};
+
+namespace detail {
+
+template<typename NodeIndex, typename Weight>
+struct shortest_path_heap {
+    using type = DenseIndexedHeap<NodeIndex, Weight>;
+};
+
+template<typename NodeIndex, std::unsigned_integral Weight>
+struct shortest_path_heap<NodeIndex, Weight> {
+    using type = DenseRadixHeap<NodeIndex, Weight>;
+};
+
+} // namespace detail
+
+// Single-source shortest paths with an addressable heap: no stale entries, and
+// the heap never holds more than one entry per node. Unsigned integer weights
+// use DenseRadixHeap, other weights a 4-ary DenseIndexedHeap. With a target,
+// stops as soon as the target is settled (point-to-point queries); nodes not
+// settled by then keep their tentative or infinite distance. Integral path
+// lengths saturate at the infinite distance instead of wrapping. Throws
+// std::invalid_argument for an unweighted graph.
+template<typename Graph>
+[[nodiscard]] DenseVector<typename Graph::weight_type, typename Graph::node_index_type>
+sssp_dijkstra(const Graph& graph, typename Graph::node_index_type source,
+              std::optional<typename Graph::node_index_type> target = std::nullopt) {
+    using NodeIndex = typename Graph::node_index_type;
+    using Weight = typename Graph::weight_type;
+    using Heap = typename detail::shortest_path_heap<NodeIndex, Weight>::type;
+
+    if (!graph.weighted()) throw std::invalid_argument("dense_index::sssp_dijkstra: graph has no weights");
+
+    constexpr Weight infinity = std::numeric_limits<Weight>::has_infinity ? std::numeric_limits<Weight>::infinity()
+                                                                          : std::numeric_limits<Weight>::max();
+    DenseVector<Weight, NodeIndex> dist(graph.node_count(), infinity);
+    Heap heap(graph.node_count());
+    dist[source] = Weight{};
+    heap.push(source, Weight{});
+    while (!heap.empty()) {
+        const auto [u, du] = heap.pop();
+        if (target && u == *target) break;
+        for (auto e : graph.out_edges(u)) {
+            const NodeIndex v = graph.target(e);
+            const Weight candidate = detail::saturating_path_add(du, graph.weight(e));
+            if (candidate < dist[v]) {
+                dist[v] = candidate;
+                heap.push_or_decrease(v, candidate);
+            }
+        }
+    }
+    return dist;
+}
+
+// Disjoint sets over an index domain, with union by rank and path halving.
+// Parents are stored as IndexType values, so a 32-bit StrongIndex keeps the
+// parent array at 4 bytes per element.
+template<StrongIndexType IndexType>
+class DenseUnionFind {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    DenseVector<IndexType, IndexType> parent_;
+    DenseVector<std::uint8_t, IndexType> rank_;
+    size_type sets_ = 0;
+
+    // Root without compression, for const queries
+    [[nodiscard]] IndexType root(IndexType x) const noexcept {
+        while (parent_[x] != x) x = parent_[x];
+        return x;
+    }
+
+public:
+    // Constructors
+    DenseUnionFind() = default;
+
+    // n singleton sets; throws std::length_error if IndexType cannot address them
+    explicit DenseUnionFind(size_type n) : sets_(n) {
+        detail::check_index_domain<IndexType>(n);
+        rank_.resize(n, std::uint8_t{0});
+        parent_.reserve(n);
+        for (size_type i = 0; i < n; ++i) [[maybe_unused]] auto _ = parent_.push_back(IndexType(i));
+    }
+
+    // Add a singleton set and return its index
+    IndexType add() {
+        const auto idx = parent_.push_back(detail::checked_index<IndexType>(parent_.size()));
+        (void)rank_.push_back(0);
+        ++sets_;
+        return idx;
+    }
+
+    // Representative of x's set; halves the path on the way up
+    [[nodiscard]] IndexType find(IndexType x) noexcept {
+        while (parent_[x] != x) {
+            parent_[x] = parent_[parent_[x]];
+            x = parent_[x];
+        }
+        return x;
+    }
+
+    [[nodiscard]] bool same(IndexType a, IndexType b) noexcept { return find(a) == find(b); }
+
+    // Merge the sets of a and b; false if they were already one set
+    bool unite(IndexType a, IndexType b) noexcept {
+        auto ra = find(a);
+        auto rb = find(b);
+        if (ra == rb) return false;
+        if (rank_[ra] < rank_[rb]) std::swap(ra, rb);
+        parent_[rb] = ra;
+        if (rank_[ra] == rank_[rb]) ++rank_[ra];
+        --sets_;
+        return true;
+    }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return parent_.size(); }
+    [[nodiscard]] size_type set_count() const noexcept { return sets_; }
+
+    // Label every index with a dense ComponentIdx in [0, set_count()); sets are
+    // numbered in order of their smallest index
+    template<StrongIndexType ComponentIdx>
+    [[nodiscard]] DenseVector<ComponentIdx, IndexType> components() const {
+        constexpr auto unlabeled = std::numeric_limits<std::size_t>::max();
+        DenseVector<std::size_t, IndexType> label_of_root(parent_.size(), unlabeled);
+        DenseVector<ComponentIdx, IndexType> labels(parent_.size(), ComponentIdx(0));
+        std::size_t next = 0;
+        for (auto x : indices(parent_)) {
+            auto& label = label_of_root[root(x)];
+            if (label == unlabeled) label = next++;
+            labels[x] = ComponentIdx(label);
+        }
+        return labels;
+    }
+};
+
+// Union-find safe for concurrent unite/find/same calls, e.g. from a
+// parallel_for over edges. A union CASes the larger root to point at the
+// smaller one (Anderson and Woll), which rules out cycles without locks, so
+// each set's representative is its smallest index. find halves paths with
+// benign CASes that only shortcut to an ancestor.
+template<StrongIndexType IndexType>
+class DenseConcurrentUnionFind {
+public:
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+
+    mutable std::vector<rep_type> parent_;
+
+    [[nodiscard]] std::atomic_ref<rep_type> parent(std::size_t x) const noexcept { return std::atomic_ref<rep_type>(parent_[x]); }
+
+    [[nodiscard]] std::size_t find_rep(std::size_t x) const noexcept {
+        while (true) {
+            auto p = parent(x).load(std::memory_order_relaxed);
+            if (p == x) return x;
+            const auto gp = parent(p).load(std::memory_order_relaxed);
+            if (gp == p) return p;
+            parent(x).compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            x = gp;
+        }
+    }
+
+public:
+    // n singleton sets
+    explicit DenseConcurrentUnionFind(size_type n = 0) : parent_(n) {
+        if (n > 0 && n - 1 > std::numeric_limits<rep_type>::max()) throw std::length_error("DenseConcurrentUnionFind");
+        std::iota(parent_.begin(), parent_.end(), rep_type{0});
+    }
+
+    // Representative (the smallest index) of x's set at some point during the call
+    [[nodiscard]] IndexType find(IndexType x) const noexcept { return IndexType(find_rep(get_index_value(x))); }
+
+    // Merge the sets of a and b; false if they were already one set
+    bool unite(IndexType a, IndexType b) noexcept {
+        auto ra = find_rep(get_index_value(a));
+        auto rb = find_rep(get_index_value(b));
+        while (ra != rb) {
+            if (ra < rb) std::swap(ra, rb);
+            auto expected = static_cast<rep_type>(ra);
+            if (parent(ra).compare_exchange_strong(expected, static_cast<rep_type>(rb), std::memory_order_relaxed)) return true;
+            // ra stopped being a root; retry from the new roots
+            ra = find_rep(ra);
+            rb = find_rep(rb);
+        }
+        return false;
+    }
+
+    // True if a and b are in one set; linearizable against concurrent unites
+    [[nodiscard]] bool same(IndexType a, IndexType b) const noexcept {
+        auto ra = find_rep(get_index_value(a));
+        auto rb = find_rep(get_index_value(b));
+        while (ra != rb) {
+            // Both still roots: they were distinct sets when we looked
+            if (parent(ra).load(std::memory_order_relaxed) == ra) return false;
+            ra = find_rep(ra);
+            rb = find_rep(rb);
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_type size() const noexcept { return parent_.size(); }
+
+    // Point every index directly at its root; call once unions have finished
+    void compress(WorkStealingScheduler& scheduler = default_scheduler()) {
+        using detail::ChunkIndex;
+        scheduler.parallel_for_chunks(IndexRange<ChunkIndex>(ChunkIndex(0), ChunkIndex(parent_.size())),
+            [&](IndexRange<ChunkIndex> chunk) {
+                for (auto i : chunk) {
+                    const auto x = get_index_value(i);
+                    parent(x).store(static_cast<rep_type>(find_rep(x)), std::memory_order_relaxed);
+                }
+            }, {.grain = 4096, .affinity = std::nullopt});
+    }
+
+    // Dense ComponentIdx labels in order of each set's smallest index; call
+    // once unions have finished
+    template<StrongIndexType ComponentIdx>
+    [[nodiscard]] DenseVector<ComponentIdx, IndexType> components(WorkStealingScheduler& scheduler = default_scheduler()) {
+        compress(scheduler);
+        // Roots are the smallest index of their set, so one ordered pass
+        // labels each root before any of its members
+        DenseVector<ComponentIdx, IndexType> labels(parent_.size(), ComponentIdx(0));
+        std::size_t next = 0;
+        for (std::size_t x = 0; x < parent_.size(); ++x) {
+            const auto r = parent_[x];
+            labels[IndexType(x)] = r == x ? ComponentIdx(next++) : labels[IndexType(r)];
+        }
+        return labels;
+    }
+
+    // Number of sets; call once unions have finished
+    [[nodiscard]] size_type set_count() const noexcept {
+        size_type roots = 0;
+        for (std::size_t x = 0; x < parent_.size(); ++x) roots += parent_[x] == x;
+        return roots;
+    }
+};
+
+// Binary indexed tree of running sums over an index domain. prefix(i) sums the
+// values at indices [0, i) and range(first, last) those in [first, last), both
+// in O(log n); T needs + and -. Building from a vector is O(n).
+template<typename T, StrongIndexType IndexType>
+class DenseFenwick {
+public:
+    using value_type = T;
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    std::vector<T> tree_;  // 1-based: tree_[i] covers (i - lowbit(i), i]
+
+public:
+    // Constructors
+    DenseFenwick() : tree_(1, T{}) {}
+    explicit DenseFenwick(size_type n) : tree_(n + 1, T{}) {}
+
+    explicit DenseFenwick(const DenseVector<T, IndexType>& values) : tree_(values.size() + 1, T{}) {
+        std::copy(values.begin(), values.end(), tree_.begin() + 1);
+        // Push each node's partial sum into its parent once
+        for (size_type i = 1; i < tree_.size(); ++i) {
+            const auto parent = i + (i & (~i + 1));
+            if (parent < tree_.size()) tree_[parent] += tree_[i];
+        }
+    }
+
+    // Modifiers
+    void add(IndexType idx, const T& delta) noexcept {
+        for (auto i = get_index_value(idx) + 1; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+    }
+
+    void set(IndexType idx, const T& value) noexcept { add(idx, value - at(idx)); }
+
+    // Queries
+    [[nodiscard]] T prefix(IndexType end) const noexcept {
+        T sum{};
+        for (auto i = get_index_value(end); i > 0; i &= i - 1) sum += tree_[i];
+        return sum;
+    }
+
+    [[nodiscard]] T range(IndexType first, IndexType last) const noexcept { return prefix(last) - prefix(first); }
+    [[nodiscard]] T range(IndexRange<IndexType> r) const noexcept { return range(r.first(), r.last()); }
+    [[nodiscard]] T at(IndexType idx) const noexcept { return range(idx, IndexType(get_index_value(idx) + 1)); }
+    [[nodiscard]] T total() const noexcept { return prefix(IndexType(size())); }
+
+    // Smallest index i with prefix(i + 1) >= target, or size() if none; values
+    // must be non-negative. Weighted sampling and percentile lookups use this.
+    [[nodiscard]] IndexType lower_bound(T target) const noexcept {
+        size_type pos = 0;
+        for (auto step = std::bit_floor(size()); step > 0; step >>= 1) {
+            if (pos + step < tree_.size() && tree_[pos + step] < target) {
+                pos += step;
+                target -= tree_[pos];
+            }
+        }
+        return IndexType(pos);
+    }
+
+    [[nodiscard]] size_type size() const noexcept { return tree_.size() - 1; }
+};
+
+// Associative operations with a known identity, for DenseSegmentTree
+struct MinOp {
+    template<typename T>
+    [[nodiscard]] constexpr T operator()(const T& a, const T& b) const {
+        return b < a ? b : a;
+    }
+
+    template<typename T>
+    [[nodiscard]] static constexpr T identity() noexcept {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+};
+
+struct MaxOp {
+    template<typename T>
+    [[nodiscard]] constexpr T operator()(const T& a, const T& b) const {
+        return a < b ? b : a;
+    }
+
+    template<typename T>
+    [[nodiscard]] static constexpr T identity() noexcept {
+        return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+};
+
+namespace detail {
+
+// Identity element of Op over T, where it can be inferred
+template<typename T, typename Op>
+[[nodiscard]] constexpr T op_identity() {
+    if constexpr (requires { { Op::template identity<T>() } -> std::convertible_to<T>; }) {
+        return Op::template identity<T>();
+    } else if constexpr (std::is_same_v<Op, std::multiplies<T>> || std::is_same_v<Op, std::multiplies<>>) {
+        return T(1);
+    } else if constexpr (std::is_same_v<Op, std::bit_and<T>> || std::is_same_v<Op, std::bit_and<>>) {
+        return static_cast<T>(~T{});
+    } else {
+        static_assert(std::is_same_v<Op, std::plus<T>> || std::is_same_v<Op, std::plus<>> || std::is_same_v<Op, std::bit_or<T>> ||
+                          std::is_same_v<Op, std::bit_or<>> || std::is_same_v<Op, std::bit_xor<T>> || std::is_same_v<Op, std::bit_xor<>>,
+                      "pass the identity of this operation to the constructor");
+        return T{};
+    }
+}
+
+} // namespace detail
+
+// Segment tree for any associative Op (not necessarily commutative). Nodes are
+// stored in BFS (Eytzinger) order: the root at 1, node k's children at 2k and
+// 2k + 1, and the leaves padded to a power of two. The upper levels then share
+// a few cache lines at the front of one aligned array, and updates and queries
+// are branch-light bottom-up walks.
+template<typename T, StrongIndexType IndexType, typename Op = std::plus<T>>
+class DenseSegmentTree {
+public:
+    using value_type = T;
+    using index_type = IndexType;
+    using size_type = std::size_t;
+
+private:
+    std::vector<T, detail::CacheAlignedAllocator<T>> tree_;
+    size_type size_ = 0;
+    size_type leaves_ = 1;
+    T identity_;
+    [[no_unique_address]] Op op_;
+
+    void rebuild_internal() {
+        for (auto k = leaves_; k-- > 1;) tree_[k] = op_(tree_[2 * k], tree_[2 * k + 1]);
+    }
+
+public:
+    // Constructors
+    explicit DenseSegmentTree(size_type n = 0, T identity = detail::op_identity<T, Op>(), Op op = Op())
+        : size_(n), leaves_(std::bit_ceil(std::max<size_type>(n, 1))), identity_(identity), op_(std::move(op)) {
+        tree_.assign(2 * leaves_, identity_);
+    }
+
+    // Bulk O(n) build
+    explicit DenseSegmentTree(const DenseVector<T, IndexType>& values, T identity = detail::op_identity<T, Op>(), Op op = Op())
+        : DenseSegmentTree(values.size(), std::move(identity), std::move(op)) {
+        std::copy(values.begin(), values.end(), tree_.begin() + static_cast<std::ptrdiff_t>(leaves_));
+        rebuild_internal();
+    }
+
+    // Modifiers
+    void set(IndexType idx, T value) {
+        auto k = get_index_value(idx) + leaves_;
+        tree_[k] = std::move(value);
+        for (k >>= 1; k > 0; k >>= 1) tree_[k] = op_(tree_[2 * k], tree_[2 * k + 1]);
+    }
+
+    // Queries
+    [[nodiscard]] const T& operator[](IndexType idx) const noexcept { return tree_[get_index_value(idx) + leaves_]; }
+    const T& operator[](size_type) const = delete;
+
+    // Fold of Op over [first, last), in index order
+    [[nodiscard]] T range(IndexType first, IndexType last) const {
+        T left = identity_;
+        T right = identity_;
+        for (auto lo = get_index_value(first) + leaves_, hi = get_index_value(last) + leaves_; lo < hi; lo >>= 1, hi >>= 1) {
+            if (lo & 1) left = op_(left, tree_[lo++]);
+            if (hi & 1) right = op_(tree_[--hi], right);
+        }
+        return op_(left, right);
+    }
+
+    [[nodiscard]] T range(IndexRange<IndexType> r) const { return range(r.first(), r.last()); }
+    [[nodiscard]] T prefix(IndexType end) const { return range(IndexType(0), end); }
+    [[nodiscard]] const T& total() const noexcept { return tree_[1]; }
+
+    [[nodiscard]] size_type size() const noexcept { return size_; }
+    [[nodiscard]] const T& identity() const noexcept { return identity_; }
+};
+
+template<typename IndexType>
+struct TreeOrderTag {};
+
+// Rooted forest over an index domain, built in O(n) from parent links (a root
+// is its own parent, or has a parent outside [0, n)). Children are kept in CSR
+// form in index order. Nodes are numbered in pre- and post-order with
+// positions of type order_index_type, and every subtree occupies a contiguous
+// run of the preorder.
+//
+// lca() is O(1) after an O(n log n) build. It uses a sparse-table minimum over
+// the preorder, which is the Euler-tour RMQ folded down to n entries: for
+// pre(u) < pre(v), the LCA is the parent with the smallest preorder position
+// among the nodes in (pre(u), pre(v)].
+template<StrongIndexType IndexType>
+class DenseTree {
+public:
+    using index_type = IndexType;
+    using order_index_type = StrongIndex<TreeOrderTag<IndexType>, index_rep_t<IndexType>>;
+    using size_type = std::size_t;
+
+private:
+    using rep_type = index_rep_t<IndexType>;
+    static constexpr rep_type no_parent = std::numeric_limits<rep_type>::max();
+
+    std::vector<rep_type> parent_;
+    std::vector<rep_type> child_offsets_{0};
+    std::vector<IndexType> children_;
+    std::vector<IndexType> roots_;
+    std::vector<rep_type> depth_;
+    std::vector<rep_type> pre_;
+    std::vector<rep_type> subtree_size_;
+    DenseVector<IndexType, order_index_type> preorder_;
+    DenseVector<IndexType, order_index_type> postorder_;
+    // Level k holds, for each window of 2^k preorder positions starting at i,
+    // the smallest preorder position of a parent in it; level 0 is at [0, n)
+    std::vector<rep_type> sparse_;
+    std::vector<size_type> level_offsets_;
+
+    void build() {
+        const auto n = parent_.size();
+        if (n >= no_parent) throw std::length_error("DenseTree: too many nodes for the index type");
+
+        // Children CSR by counting sort, so siblings stay in index order
+        child_offsets_.assign(n + 1, 0);
+        roots_.clear();
+        for (size_type v = 0; v < n; ++v) {
+            if (parent_[v] >= n || parent_[v] == v) {
+                parent_[v] = no_parent;
+                roots_.push_back(IndexType(v));
+            } else {
+                ++child_offsets_[parent_[v] + 1];
+            }
+        }
+        for (size_type v = 0; v < n; ++v) child_offsets_[v + 1] += child_offsets_[v];
+        children_.resize(child_offsets_[n]);
+        std::vector<rep_type> cursor(child_offsets_.begin(), child_offsets_.end() - 1);
+        for (size_type v = 0; v < n; ++v) {
+            if (parent_[v] != no_parent) children_[cursor[parent_[v]]++] = IndexType(v);
+        }
+
+        // Preorder with an explicit stack; children are pushed in reverse
+        depth_.assign(n, 0);
+        pre_.assign(n, 0);
+        preorder_.clear();
+        preorder_.reserve(n);
+        std::vector<rep_type> stack;
+        for (auto root = roots_.rbegin(); root != roots_.rend(); ++root) stack.push_back(static_cast<rep_type>(get_index_value(*root)));
+        while (!stack.empty()) {
+            const auto v = stack.back();
+            stack.pop_back();
+            pre_[v] = static_cast<rep_type>(preorder_.size());
+            [[maybe_unused]] auto _ = preorder_.push_back(IndexType(v));
+            for (auto c = child_offsets_[v + 1]; c-- > child_offsets_[v];) {
+                const auto child = static_cast<rep_type>(get_index_value(children_[c]));
+                depth_[child] = depth_[v] + 1;
+                stack.push_back(child);
+            }
+        }
+        if (preorder_.size() != n) throw std::invalid_argument("DenseTree: parent links contain a cycle");
+
+        // Subtree sizes bottom-up in reverse preorder; then postorder from
+        // post(v) = pre(v) + size(v) - 1 - depth(v)
+        subtree_size_.assign(n, 1);
+        for (size_type p = n; p-- > 0;) {
+            const auto v = get_index_value(preorder_.data()[p]);
+            if (parent_[v] != no_parent) subtree_size_[parent_[v]] += subtree_size_[v];
+        }
+        postorder_.resize(n);
+        for (size_type v = 0; v < n; ++v) postorder_.data()[pre_[v] + subtree_size_[v] - 1 - depth_[v]] = IndexType(v);
+
+        // Sparse table; a root's entry is 0, which makes cross-tree queries
+        // land on a non-ancestor that lca() rejects
+        level_offsets_.assign(1, 0);
+        sparse_.resize(n);
+        for (size_type p = 0; p < n; ++p) {
+            const auto v = get_index_value(preorder_.data()[p]);
+            sparse_[p] = parent_[v] == no_parent ? 0 : pre_[parent_[v]];
+        }
+        for (size_type width = 1; 2 * width <= n; width *= 2) {
+            const auto prev = level_offsets_.back();
+            const auto count = n - 2 * width + 1;
+            level_offsets_.push_back(sparse_.size());
+            sparse_.resize(sparse_.size() + count);
+            const auto* below = sparse_.data() + prev;
+            auto* level = sparse_.data() + level_offsets_.back();
+            for (size_type i = 0; i < count; ++i) level[i] = std::min(below[i], below[i + width]);
+        }
+    }
+
+public:
+    // Constructors
+    DenseTree() = default;
+
+    explicit DenseTree(const DenseVector<IndexType, IndexType>& parent) : parent_(parent.size()) {
+        for (size_type v = 0; v < parent.size(); ++v) {
+            const auto p = get_index_value(parent.data()[v]);
+            parent_[v] = p >= parent.size() ? no_parent : static_cast<rep_type>(p);
+        }
+        build();
+    }
+
+    // Build from any range of nodes; parent projects a node to its parent index
+    template<std::ranges::input_range Nodes, typename ParentFn>
+    [[nodiscard]] static DenseTree from_parents(const Nodes& nodes, ParentFn parent) {
+        DenseTree tree;
+        for (const auto& node : nodes) {
+            const auto p = get_index_value(static_cast<IndexType>(std::invoke(parent, node)));
+            tree.parent_.push_back(p >= no_parent ? no_parent : static_cast<rep_type>(p));
+        }
+        tree.build();
+        return tree;
+    }
+
+    // Structure
+    [[nodiscard]] size_type size() const noexcept { return parent_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return parent_.empty(); }
+    [[nodiscard]] IndexRange<IndexType> nodes() const noexcept { return IndexRange<IndexType>(IndexType(0), IndexType(size())); }
+    [[nodiscard]] std::span<const IndexType> roots() const noexcept { return roots_; }
+
+    [[nodiscard]] std::optional<IndexType> parent(IndexType v) const noexcept {
+        const auto p = parent_[get_index_value(v)];
+        if (p == no_parent) return std::nullopt;
+        return IndexType(p);
+    }
+
+    [[nodiscard]] bool is_root(IndexType v) const noexcept { return parent_[get_index_value(v)] == no_parent; }
+
+    [[nodiscard]] std::span<const IndexType> children(IndexType v) const noexcept {
+        const auto i = get_index_value(v);
+        return std::span<const IndexType>(children_.data() + child_offsets_[i], child_offsets_[i + 1] - child_offsets_[i]);
+    }
+
+    [[nodiscard]] size_type depth(IndexType v) const noexcept { return depth_[get_index_value(v)]; }
+    [[nodiscard]] size_type subtree_size(IndexType v) const noexcept { return subtree_size_[get_index_value(v)]; }
+
+    // Orders
+    [[nodiscard]] order_index_type pre_index(IndexType v) const noexcept { return order_index_type(pre_[get_index_value(v)]); }
+
+    [[nodiscard]] order_index_type post_index(IndexType v) const noexcept {
+        const auto i = get_index_value(v);
+        return order_index_type(pre_[i] + subtree_size_[i] - 1 - depth_[i]);
+    }
+
+    [[nodiscard]] const DenseVector<IndexType, order_index_type>& preorder() const noexcept { return preorder_; }
+    [[nodiscard]] const DenseVector<IndexType, order_index_type>& postorder() const noexcept { return postorder_; }
+
+    // Preorder positions of v's subtree, v first
+    [[nodiscard]] IndexRange<order_index_type> subtree_range(IndexType v) const noexcept {
+        const auto i = get_index_value(v);
+        return IndexRange<order_index_type>(order_index_type(pre_[i]), order_index_type(pre_[i] + subtree_size_[i]));
+    }
+
+    // Nodes of v's subtree in preorder, v first
+    [[nodiscard]] std::span<const IndexType> subtree(IndexType v) const noexcept {
+        const auto i = get_index_value(v);
+        return std::span<const IndexType>(preorder_.data() + pre_[i], subtree_size_[i]);
+    }
+
+    // Ancestry
+    [[nodiscard]] bool is_ancestor(IndexType ancestor, IndexType v) const noexcept {
+        const auto a = get_index_value(ancestor);
+        const auto p = pre_[get_index_value(v)];
+        return pre_[a] <= p && p < pre_[a] + subtree_size_[a];
+    }
+
+    // Lowest common ancestor, or nullopt if u and v are in different trees
+    [[nodiscard]] std::optional<IndexType> lca(IndexType u, IndexType v) const noexcept {
+        if (u == v) return u;
+        auto lo = pre_[get_index_value(u)];
+        auto hi = pre_[get_index_value(v)];
+        if (lo > hi) std::swap(lo, hi);
+        const size_type first = lo + 1;
+        const size_type len = hi - lo;
+        const auto level = static_cast<size_type>(std::bit_width(len) - 1);
+        const auto* row = sparse_.data() + level_offsets_[level];
+        const auto candidate = preorder_.data()[std::min(row[first], row[hi + 1 - (size_type{1} << level)])];
+        if (!is_ancestor(candidate, u) || !is_ancestor(candidate, v)) return std::nullopt;
+        return candidate;
+    }
+
+    // Edges on the path between u and v, or nullopt if they are in different trees
+    [[nodiscard]] std::optional<size_type> distance(IndexType u, IndexType v) const noexcept {
+        const auto a = lca(u, v);
+        if (!a) return std::nullopt;
+        return depth(u) + depth(v) - 2 * depth(*a);
+    }
+
+    // Aggregates
+
+    // Op folded over every subtree, for all nodes at once in O(n): result[v]
+    // = op(values[v], results of v's children). One sweep over the reverse
+    // preorder, with no recursion
+    template<typename T, typename Op = std::plus<T>>
+    [[nodiscard]] DenseVector<T, IndexType> subtree_reduce(const DenseVector<T, IndexType>& values, Op op = Op()) const {
+        if (values.size() != size()) throw std::invalid_argument("DenseTree::subtree_reduce: size mismatch");
+        DenseVector<T, IndexType> result(values);
+        for (size_type p = size(); p-- > 0;) {
+            const auto v = get_index_value(preorder_.data()[p]);
+            if (parent_[v] != no_parent) result.data()[parent_[v]] = op(result.data()[parent_[v]], result.data()[v]);
+        }
+        return result;
+    }
+
+    // Relayout into DFS order. In the relaid tree node ids equal preorder
+    // positions, so every subtree is the contiguous id run [v, v + size(v))
+    // and subtree scans stream through memory.
+
+    // New id of v after relayout
+    [[nodiscard]] IndexType dfs_index(IndexType v) const noexcept { return IndexType(pre_[get_index_value(v)]); }
+
+    // Per-node values gathered into DFS order
+    template<typename T>
+    [[nodiscard]] DenseVector<T, IndexType> relayout(const DenseVector<T, IndexType>& values) const {
+        if (values.size() != size()) throw std::invalid_argument("DenseTree::relayout: size mismatch");
+        DenseVector<T, IndexType> result;
+        result.reserve(size());
+        for (auto v : preorder_) [[maybe_unused]] auto _ = result.push_back(values[v]);
+        return result;
+    }
+
+    // This tree renumbered into DFS order
+    [[nodiscard]] DenseTree relayout() const {
+        DenseTree tree;
+        tree.parent_.resize(size());
+        for (size_type p = 0; p < size(); ++p) {
+            const auto v = get_index_value(preorder_.data()[p]);
+            tree.parent_[p] = parent_[v] == no_parent ? no_parent : pre_[parent_[v]];
+        }
+        tree.build();
+        return tree;
+    }
+};
+
+// Fixed-capacity circular buffer addressed by an ever-increasing sequence
+// number. push_back returns the SeqIndex of the new element and, once the
+// buffer is full, drops the oldest; the live window is [front_index(),
+// next_index()). A sequence maps to its slot with a power-of-two mask.
+// operator[] only asserts that the sequence is in the window, in debug
+// builds; at() throws if the element has left the window or was never
+// pushed. Sequence numbers must be 64-bit so they never wrap.
+template<typename T, StrongIndexType SeqIndex>
+class DenseRingBuffer {
+    static_assert(std::numeric_limits<index_rep_t<SeqIndex>>::digits >= 64, "DenseRingBuffer needs a 64-bit sequence index");
+
+public:
+    using value_type = T;
+    using index_type = SeqIndex;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    union Slot {
+        T value;
+
+        Slot() noexcept {}
+        ~Slot() {}
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_type mask_ = 0;
+    size_type front_ = 0;  // sequence of the oldest live element
+    size_type next_ = 0;   // sequence the next push_back gets
+
+    [[nodiscard]] T& slot(size_type seq) const noexcept { return slots_[seq & mask_].value; }
+
+    template<bool Const>
+    class basic_iterator {
+        using owner = std::conditional_t<Const, const DenseRingBuffer, DenseRingBuffer>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<Const, const T&, T&>;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+
+        basic_iterator() noexcept = default;
+        basic_iterator(owner* buffer, size_type seq) noexcept : buffer_(buffer), seq_(seq) {}
+
+        [[nodiscard]] reference operator*() const noexcept { return buffer_->slot(seq_); }
+        [[nodiscard]] pointer operator->() const noexcept { return &buffer_->slot(seq_); }
+        [[nodiscard]] SeqIndex index() const noexcept { return SeqIndex(seq_); }
+
+        basic_iterator& operator++() noexcept {
+            ++seq_;
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++seq_;
+            return tmp;
+        }
+
+        [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept { return seq_ == other.seq_; }
+
+    private:
+        owner* buffer_ = nullptr;
+        size_type seq_ = 0;
+    };
+
+public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // Constructors; capacity is rounded up to a power of two
+    explicit DenseRingBuffer(size_type capacity) {
+        if (capacity == 0 || capacity > (size_type{1} << 62)) throw std::length_error("DenseRingBuffer::DenseRingBuffer");
+        const auto n = std::bit_ceil(capacity);
+        slots_ = std::make_unique<Slot[]>(n);
+        mask_ = n - 1;
+    }
+
+    DenseRingBuffer(const DenseRingBuffer& other) : DenseRingBuffer(other.capacity()) {
+        front_ = next_ = other.front_;
+        for (const auto& value : other) emplace_back(value);
+    }
+
+    DenseRingBuffer(DenseRingBuffer&& other) noexcept
+        : slots_(std::move(other.slots_)), mask_(other.mask_), front_(other.front_), next_(other.next_) {
+        other.mask_ = 0;
+        other.front_ = other.next_ = 0;
+    }
+
+    DenseRingBuffer& operator=(DenseRingBuffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~DenseRingBuffer() {
+        if (slots_) clear();
+    }
+
+    void swap(DenseRingBuffer& other) noexcept {
+        std::swap(slots_, other.slots_);
+        std::swap(mask_, other.mask_);
+        std::swap(front_, other.front_);
+        std::swap(next_, other.next_);
+    }
+
+    // Modifiers; a full buffer drops its oldest element to make room
+    template<typename... Args>
+    SeqIndex emplace_back(Args&&... args) {
+        if (full()) {
+            // The new element reuses the oldest one's slot, and args may refer
+            // to that element, so build the value before dropping it
+            T value(std::forward<Args>(args)...);
+            pop_front();
+            std::construct_at(&slots_[next_ & mask_].value, std::move(value));
+        } else {
+            std::construct_at(&slots_[next_ & mask_].value, std::forward<Args>(args)...);
+        }
+        return SeqIndex(next_++);
+    }
+
+    SeqIndex push_back(const T& value) { return emplace_back(value); }
+    SeqIndex push_back(T&& value) { return emplace_back(std::move(value)); }
+
+    void pop_front() noexcept {
+        std::destroy_at(&slot(front_));
+        ++front_;
+    }
+
+    // Drops every element; sequence numbers keep increasing
+    void clear() noexcept {
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            front_ = next_;
+        } else {
+            while (front_ != next_) pop_front();
+        }
+    }
+
+    // Element access
+    [[nodiscard]] T& operator[](SeqIndex seq) noexcept {
+        assert(contains(seq) && "DenseRingBuffer: sequence outside the window");
+        return slot(get_index_value(seq));
+    }
+
+    [[nodiscard]] const T& operator[](SeqIndex seq) const noexcept {
+        assert(contains(seq) && "DenseRingBuffer: sequence outside the window");
+        return slot(get_index_value(seq));
+    }
+
+    T& operator[](size_type) = delete;
+    const T& operator[](size_type) const = delete;
+
+    [[nodiscard]] T& at(SeqIndex seq) {
+        if (!contains(seq)) throw std::out_of_range("DenseRingBuffer::at");
+        return (*this)[seq];
+    }
+
+    [[nodiscard]] const T& at(SeqIndex seq) const {
+        if (!contains(seq)) throw std::out_of_range("DenseRingBuffer::at");
+        return (*this)[seq];
+    }
+
+    [[nodiscard]] bool contains(SeqIndex seq) const noexcept {
+        const auto s = get_index_value(seq);
+        return front_ <= s && s < next_;
+    }
+
+    [[nodiscard]] T& front() noexcept { return slot(front_); }
+    [[nodiscard]] const T& front() const noexcept { return slot(front_); }
+    [[nodiscard]] T& back() noexcept { return slot(next_ - 1); }
+    [[nodiscard]] const T& back() const noexcept { return slot(next_ - 1); }
+
+    // Sequence window
+    [[nodiscard]] SeqIndex front_index() const noexcept { return SeqIndex(front_); }
+    [[nodiscard]] SeqIndex next_index() const noexcept { return SeqIndex(next_); }
+    [[nodiscard]] IndexRange<SeqIndex> window() const noexcept { return IndexRange<SeqIndex>(SeqIndex(front_), SeqIndex(next_)); }
+
+    // Iterators, oldest first
+    [[nodiscard]] iterator begin() noexcept { return iterator(this, front_); }
+    [[nodiscard]] iterator end() noexcept { return iterator(this, next_); }
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, front_); }
+    [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, next_); }
+
+    // f(SeqIndex, T&) for each element of the window, oldest first
+    template<typename F>
+    void for_each(F&& f) {
+        for (auto seq = front_; seq != next_; ++seq) f(SeqIndex(seq), slot(seq));
+    }
+
+    template<typename F>
+    void for_each(F&& f) const {
+        for (auto seq = front_; seq != next_; ++seq) f(SeqIndex(seq), std::as_const(slot(seq)));
+    }
+
+    // Capacity
+    [[nodiscard]] size_type size() const noexcept { return next_ - front_; }
+    [[nodiscard]] size_type capacity() const noexcept { return mask_ + 1; }
+    [[nodiscard]] bool empty() const noexcept { return front_ == next_; }
+    [[nodiscard]] bool full() const noexcept { return size() == capacity(); }
+};
+
+// Lock-free single-producer single-consumer ring. The producer publishes the
+// sequence after its last written element (published()) with a release
+// store, and the consumer publishes the sequence after its last consumed
+// element (consumed()). Each side keeps a cached copy of the other's
+// watermark and reloads it only when the cached value says full or empty, so
+// steady-state traffic costs one shared cache-line transfer per batch rather
+// than per element. Unlike DenseRingBuffer, a full ring rejects pushes
+// instead of overwriting.
+template<typename T, StrongIndexType SeqIndex>
+class DenseSpscRingBuffer {
+    static_assert(std::numeric_limits<index_rep_t<SeqIndex>>::digits >= 64, "DenseSpscRingBuffer needs a 64-bit sequence index");
+    static_assert(std::is_default_constructible_v<T> && std::is_move_assignable_v<T>);
+
+public:
+    using value_type = T;
+    using index_type = SeqIndex;
+    using size_type = std::size_t;
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_type mask_ = 0;
+    alignas(64) std::atomic<size_type> published_{0};
+    size_type consumed_cache_ = 0;  // producer's view of consumed_
+    alignas(64) std::atomic<size_type> consumed_{0};
+    size_type published_cache_ = 0;  // consumer's view of published_
+
+    // Producer: free slots, reloading the consumer's watermark only when needed
+    [[nodiscard]] size_type free_slots(size_type tail, size_type wanted) noexcept {
+        auto free = capacity() - (tail - consumed_cache_);
+        if (free < wanted) {
+            consumed_cache_ = consumed_.load(std::memory_order_acquire);
+            free = capacity() - (tail - consumed_cache_);
+        }
+        return free;
+    }
+
+    // Consumer: readable elements, reloading the producer's watermark only when needed
+    [[nodiscard]] size_type readable(size_type head) noexcept {
+        if (published_cache_ == head) published_cache_ = published_.load(std::memory_order_acquire);
+        return published_cache_ - head;
+    }
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit DenseSpscRingBuffer(size_type capacity) {
+        if (capacity == 0 || capacity > (size_type{1} << 62)) throw std::length_error("DenseSpscRingBuffer::DenseSpscRingBuffer");
+        const auto n = std::bit_ceil(capacity);
+        slots_ = std::make_unique<T[]>(n);
+        mask_ = n - 1;
+    }
+
+    DenseSpscRingBuffer(const DenseSpscRingBuffer&) = delete;
+    DenseSpscRingBuffer& operator=(const DenseSpscRingBuffer&) = delete;
+
+    // Producer side
+    template<typename U>
+        requires std::assignable_from<T&, U&&>
+    [[nodiscard]] std::optional<SeqIndex> try_push(U&& value) {
+        const auto tail = published_.load(std::memory_order_relaxed);
+        if (free_slots(tail, 1) == 0) return std::nullopt;
+        slots_[tail & mask_] = std::forward<U>(value);
+        published_.store(tail + 1, std::memory_order_release);
+        return SeqIndex(tail);
+    }
+
+    // Pushes the prefix of values that fits and publishes it at once; returns its length
+    [[nodiscard]] size_type try_push(std::span<const T> values) {
+        const auto tail = published_.load(std::memory_order_relaxed);
+        const auto k = std::min(values.size(), free_slots(tail, values.size()));
+        for (size_type i = 0; i < k; ++i) slots_[(tail + i) & mask_] = values[i];
+        if (k > 0) published_.store(tail + k, std::memory_order_release);
+        return k;
+    }
+
+    // Consumer side
+    [[nodiscard]] std::optional<T> try_pop() {
+        const auto head = consumed_.load(std::memory_order_relaxed);
+        if (readable(head) == 0) return std::nullopt;
+        std::optional<T> value(std::move(slots_[head & mask_]));
+        consumed_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Calls f(SeqIndex, T&) for up to max_count published elements, then
+    // releases their slots with one store; returns how many were consumed
+    template<typename F>
+    size_type consume(F&& f, size_type max_count = std::numeric_limits<size_type>::max()) {
+        const auto head = consumed_.load(std::memory_order_relaxed);
+        const auto k = std::min(max_count, readable(head));
+        for (size_type i = 0; i < k; ++i) f(SeqIndex(head + i), slots_[(head + i) & mask_]);
+        if (k > 0) consumed_.store(head + k, std::memory_order_release);
+        return k;
+    }
+
+    // Watermarks: everything before published() has been written, and
+    // everything before consumed() has been read
+    [[nodiscard]] SeqIndex published() const noexcept { return SeqIndex(published_.load(std::memory_order_acquire)); }
+    [[nodiscard]] SeqIndex consumed() const noexcept { return SeqIndex(consumed_.load(std::memory_order_acquire)); }
+
+    // Approximate while the other side is running
+    [[nodiscard]] size_type size() const noexcept {
+        const auto head = consumed_.load(std::memory_order_acquire);
+        const auto tail = published_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] size_type capacity() const noexcept { return mask_ + 1; }
+};
+
+} // namespace dense_index
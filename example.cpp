@@ -108,6 +108,13 @@ void demonstrate() {
     for (const auto& [dept_id, total] : dept_salaries) {
         std::cout << "  " << departments[dept_id].name << ": $" << total << std::endl;
     }
+
+    // Headcount per department, counted directly into a department-indexed vector
+    auto headcount = histogram(employees, &Employee::department, departments.size());
+    std::cout << "\nDepartment Headcounts:" << std::endl;
+    for (DepartmentId dept_id{}; dept_id.value() < departments.size(); ++dept_id) {
+        std::cout << "  " << departments[dept_id].name << ": " << headcount[dept_id] << std::endl;
+    }
 }
 
 } // namespace employee_example
@@ -116,12 +123,12 @@ void demonstrate() {
 namespace game_example {
 
 struct EntityTag {};
-struct ComponentTag {};
-struct SystemTag {};
 
 using EntityId = StrongIndex<EntityTag>;
-using ComponentId = StrongIndex<ComponentTag>;
-using SystemId = StrongIndex<SystemTag>;
+
+struct Name {
+    std::string value;
+};
 
 struct Transform {
     float x, y, z;
@@ -133,56 +140,54 @@ struct Health {
     int max;
 };
 
-struct Entity {
-    std::string name;
-    ComponentId transform_component;
-    ComponentId health_component;
-    bool active;
-};
+using World = DenseWorld<EntityId, Name, Transform, Health>;
+
+void print_state(World& world) {
+    world.query<const Name, const Transform, const Health>().for_each(
+        [](EntityId, const Name& name, const Transform& transform, const Health& health) {
+            std::cout << "  " << name.value
+                      << " - Pos(" << transform.x << "," << transform.y << "," << transform.z << ")"
+                      << " - Health: " << health.current << "/" << health.max << std::endl;
+        });
+}
 
 void demonstrate() {
     std::cout << "\n=== Game Entity System Example ===" << std::endl;
 
-    DenseIndexedContainer<std::vector<Entity>, EntityId> entities;
-    DenseIndexedContainer<std::vector<Transform>, ComponentId> transforms;
-    DenseIndexedContainer<std::vector<Health>, ComponentId> healths;
-
-    // Create game entities with components
-    auto player_transform = transforms.emplace_back(0.0f, 0.0f, 0.0f, 0.0f);
-    auto player_health = healths.emplace_back(100, 100);
-    auto player = entities.emplace_back("Player", player_transform, player_health, true);
-
-    auto enemy_transform = transforms.emplace_back(10.0f, 0.0f, 5.0f, 180.0f);
-    auto enemy_health = healths.emplace_back(50, 50);
-    auto enemy = entities.emplace_back("Enemy", enemy_transform, enemy_health, true);
+    // Components live in packed per-archetype arrays, not behind per-entity ids
+    World world;
+    auto player = world.create(Name{"Player"}, Transform{0.0f, 0.0f, 0.0f, 0.0f}, Health{100, 100});
+    auto enemy = world.create(Name{"Enemy"}, Transform{10.0f, 0.0f, 5.0f, 180.0f}, Health{50, 50});
 
     // Update game state
     std::cout << "\nInitial State:" << std::endl;
-    for (EntityId id{}; id.value() < entities.size(); ++id) {
-        const auto& entity = entities[id];
-        const auto& transform = transforms[entity.transform_component];
-        const auto& health = healths[entity.health_component];
-
-        std::cout << "  " << entity.name
-                  << " - Pos(" << transform.x << "," << transform.y << "," << transform.z << ")"
-                  << " - Health: " << health.current << "/" << health.max << std::endl;
-    }
+    print_state(world);
+
+    const auto last_frame = world.tick();
+    world.advance_tick();
 
     // Simulate damage
-    healths[entities[enemy].health_component].current -= 20;
+    world.get<Health>(enemy).current -= 20;
 
     // Move player
-    transforms[entities[player].transform_component].x += 5.0f;
+    world.get<Transform>(player).x += 5.0f;
 
     std::cout << "\nAfter Update:" << std::endl;
-    for (EntityId id{}; id.value() < entities.size(); ++id) {
-        const auto& entity = entities[id];
-        const auto& transform = transforms[entity.transform_component];
-        const auto& health = healths[entity.health_component];
-
-        std::cout << "  " << entity.name
-                  << " - Pos(" << transform.x << "," << transform.y << "," << transform.z << ")"
-                  << " - Health: " << health.current << "/" << health.max << std::endl;
+    print_state(world);
+
+    // Change ticks let systems skip chunks nobody wrote since their last run
+    std::size_t health_changed = 0;
+    world.query<const Health>().changed_since<Health>(last_frame).for_each(
+        [&](EntityId, const Health&) { ++health_changed; });
+    std::cout << "  Entities in chunks with new health writes: " << health_changed << std::endl;
+
+    // Proximity queries through a spatial grid instead of scanning every entity
+    const World& view = world;
+    DenseSpatialGrid<EntityId> grid(10.0f);
+    grid.build(world.size(), [&](EntityId e) { return view.get<Transform>(e); });
+    std::cout << "\nWithin 8 units of Player:" << std::endl;
+    for (EntityId e : grid.query_radius(view.get<Transform>(player), 8.0f)) {
+        std::cout << "  " << view.get<Name>(e).value << std::endl;
     }
 }
 
@@ -227,26 +232,46 @@ void demonstrate() {
     edges.emplace_back(node_a, node_c, 3.5);
     edges.emplace_back(node_b, node_d, 2.5);
 
+    // Compressed sparse row form: each node's out-edges are one contiguous range
+    auto graph = DenseCsrGraph<NodeId, EdgeId>::from_edges(nodes.size(), edges, &Edge::from, &Edge::to, &Edge::weight);
+
     // Find neighbors of each node
     std::cout << "\nGraph Structure:" << std::endl;
-    for (NodeId node_id{}; node_id.value() < nodes.size(); ++node_id) {
+    for (NodeId node_id : graph.nodes()) {
         std::cout << "Node " << nodes[node_id].label << " connects to: ";
 
-        for (EdgeId edge_id{}; edge_id.value() < edges.size(); ++edge_id) {
-            const auto& edge = edges[edge_id];
-            if (edge.from == node_id) {
-                std::cout << nodes[edge.to].label << " (weight: " << edge.weight << ") ";
-            }
+        for (EdgeId edge_id : graph.out_edges(node_id)) {
+            std::cout << nodes[graph.target(edge_id)].label << " (weight: " << graph.weight(edge_id) << ") ";
         }
         std::cout << std::endl;
     }
 
+    // Hop counts and weighted distances from A, both indexed by NodeId
+    auto hops = bfs(graph, graph.transpose(), node_a);
+    auto distance = sssp_delta_stepping(graph, node_a, 1.0);
+    std::cout << "\nFrom " << nodes[node_a].label << ":" << std::endl;
+    for (NodeId node_id : graph.nodes()) {
+        std::cout << "  " << nodes[node_id].label << ": " << hops.depth[node_id] << " hops, distance "
+                  << distance[node_id] << std::endl;
+    }
+
     // Calculate total edge weight
     double total_weight = 0.0;
     for (const auto& edge : edges) {
         total_weight += edge.weight;
     }
     std::cout << "\nTotal graph weight: " << total_weight << std::endl;
+
+    // Keep only the heavy edges, renumbered densely in their own index domain
+    struct HeavyEdgeTag {};
+    using HeavyEdgeId = StrongIndex<HeavyEdgeTag>;
+    auto heavy = parallel_filter<HeavyEdgeId>(edges, [](const Edge& e) { return e.weight >= 2.0; });
+    std::cout << "Heavy edges:" << std::endl;
+    for (HeavyEdgeId h{}; h.value() < heavy.values.size(); ++h) {
+        const auto& edge = heavy.values[h];
+        std::cout << "  " << nodes[edge.from].label << " -> " << nodes[edge.to].label
+                  << " (edge " << heavy.sources[h].value() << ")" << std::endl;
+    }
 }
 
 } // namespace graph_example
@@ -260,62 +285,40 @@ struct ColTag {};
 using RowIndex = StrongIndex<RowTag>;
 using ColIndex = StrongIndex<ColTag>;
 
-template<typename T>
-class Matrix {
-private:
-    std::size_t rows_;
-    std::size_t cols_;
-    std::vector<T> data_;
-
-public:
-    Matrix(std::size_t rows, std::size_t cols)
-        : rows_(rows), cols_(cols), data_(rows * cols) {}
-
-    T& at(RowIndex row, ColIndex col) {
-        return data_[row.value() * cols_ + col.value()];
-    }
-
-    const T& at(RowIndex row, ColIndex col) const {
-        return data_[row.value() * cols_ + col.value()];
-    }
-
-    std::size_t rows() const { return rows_; }
-    std::size_t cols() const { return cols_; }
-};
+using Matrix = DenseMatrix<double, RowIndex, ColIndex>;
 
 void demonstrate() {
     std::cout << "\n=== Matrix with Strong Typing Example ===" << std::endl;
 
-    Matrix<double> matrix(3, 4);
+    Matrix matrix(3, 4);
 
     // Initialize matrix
-    for (RowIndex row{}; row.value() < matrix.rows(); ++row) {
-        for (ColIndex col{}; col.value() < matrix.cols(); ++col) {
-            matrix.at(row, col) = row.value() * 10 + col.value();
+    for (auto row : matrix.row_indices()) {
+        for (auto col : matrix.col_indices()) {
+            matrix[row, col] = row.value() * 10 + col.value();
         }
     }
 
     // These would not compile:
-    // matrix.at(ColIndex(0), RowIndex(0));  // Error: wrong order
-    // matrix.at(0, 0);                      // Error: raw indices
+    // matrix[ColIndex(0), RowIndex(0)];     // Error: wrong order
+    // matrix[0, 0];                         // Error: raw indices
+    // matrix * matrix;                      // Error: ColIndex and RowIndex domains differ
 
     // Display matrix
     std::cout << "\nMatrix contents:" << std::endl;
-    for (RowIndex row{}; row.value() < matrix.rows(); ++row) {
-        for (ColIndex col{}; col.value() < matrix.cols(); ++col) {
-            std::cout << matrix.at(row, col) << "\t";
+    for (auto row : matrix.row_indices()) {
+        for (auto col : matrix.col_indices()) {
+            std::cout << matrix[row, col] << "\t";
         }
         std::cout << std::endl;
     }
 
-    // Row sum
+    // Row sums as a matrix-vector product: a ColIndex vector in, a RowIndex vector out
+    DenseVector<double, ColIndex> ones(matrix.cols(), 1.0);
+    DenseVector<double, RowIndex> sums = matrix * ones;
     std::cout << "\nRow sums:" << std::endl;
-    for (RowIndex row{}; row.value() < matrix.rows(); ++row) {
-        double sum = 0.0;
-        for (ColIndex col{}; col.value() < matrix.cols(); ++col) {
-            sum += matrix.at(row, col);
-        }
-        std::cout << "Row " << row.value() << ": " << sum << std::endl;
+    for (auto row : matrix.row_indices()) {
+        std::cout << "Row " << row.value() << ": " << sums[row] << std::endl;
     }
 }
 
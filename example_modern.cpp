@@ -136,6 +136,20 @@ void demonstrate() {
                       << employees[lead].name << std::endl;
         }
     }
+
+    // Rosters packed into one buffer: one allocation instead of one vector per project
+    std::cout << "\nRosters (DenseJaggedArray):" << std::endl;
+    DenseJaggedArray<EmployeeId, ProjectId, TeamMemberIndex> rosters;
+    for (ProjectId proj_id(0); proj_id.get() < projects.size(); ++proj_id) {
+        [[maybe_unused]] auto row = rosters.push_row(projects[proj_id].team_members);
+    }
+    for (ProjectId proj_id(0); proj_id.get() < rosters.size(); ++proj_id) {
+        std::cout << "  " << projects[proj_id].name << ": ";
+        for (EmployeeId emp_id : rosters[proj_id]) {
+            std::cout << employees[emp_id].name << " ";
+        }
+        std::cout << std::endl;
+    }
 }
 
 } // namespace modern_example
@@ -12,6 +12,10 @@
 #include <sstream>
 #include <cstring>
 #include <cmath>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <set>
 
 // Define test index tags
 struct EmployeeTag {};
@@ -496,6 +500,2319 @@ void test_type_aliases() {
     std::cout << "  ✓ Type aliases work" << std::endl;
 }
 
+// Test arena-backed string column
+void test_dense_string_column() {
+    std::cout << "Testing DenseStringColumn..." << std::endl;
+
+    using Names = dense_index::DenseStringColumn<EmployeeIndex>;
+
+    for (auto encoding : {dense_index::StringEncoding::plain, dense_index::StringEncoding::dictionary}) {
+        Names names(encoding);
+        const char* pool[] = {"Alice", "Bob", "Alicia", "", "Bob", "Charlie", "Al"};
+        for (int i = 0; i < 100; ++i) {
+            auto idx = names.push_back(pool[i % 7]);
+            assert(idx.value() == static_cast<std::size_t>(i));
+        }
+        assert(names.size() == 100);
+        assert(names[EmployeeIndex(0)] == "Alice");
+        assert(names[EmployeeIndex(3)].empty());
+        assert(names.at(EmployeeIndex(99)) == pool[99 % 7]);
+
+        // Equality and prefix scans match a scalar reference
+        for (std::string_view needle : {"Bob", "", "Al", "Alice", "Zed"}) {
+            std::vector<EmployeeIndex> expected_eq, expected_prefix;
+            for (EmployeeIndex i{}; i.value() < names.size(); ++i) {
+                if (names[i] == needle) expected_eq.push_back(i);
+                if (names[i].starts_with(needle)) expected_prefix.push_back(i);
+            }
+            assert(names.find_equal(needle) == expected_eq);
+            assert(names.find_prefix(needle) == expected_prefix);
+            assert(names.count_equal(needle) == expected_eq.size());
+        }
+
+        // Pushing a view into the column itself is safe
+        auto copy = names.push_back(names[EmployeeIndex(5)]);
+        assert(names[copy] == "Charlie");
+
+        std::size_t rows = 0;
+        for (std::string_view name : names) {
+            rows += name.size() <= 7;
+        }
+        assert(rows == names.size());
+
+        if (encoding == dense_index::StringEncoding::dictionary) {
+            assert(names.dictionary_size() == 6);
+            assert(names.code(EmployeeIndex(1)) == names.code(EmployeeIndex(4)));
+            auto code = names.find_code("Charlie");
+            assert(code && names.dictionary_value(*code) == "Charlie");
+            assert(!names.find_code("Zed"));
+        }
+
+        names.clear();
+        assert(names.empty());
+    }
+
+    std::cout << "  ✓ String column access and scans" << std::endl;
+}
+
+// Test typed spans and jagged arrays
+void test_dense_jagged_array() {
+    std::cout << "Testing DenseSpan and DenseJaggedArray..." << std::endl;
+
+    struct TeamTag {};
+    struct MemberTag {};
+    using TeamIndex = dense_index::StrongIndex<TeamTag>;
+    using MemberIndex = dense_index::StrongIndex<MemberTag>;
+    using Teams = dense_index::DenseJaggedArray<EmployeeIndex, TeamIndex, MemberIndex>;
+
+    Teams teams;
+    auto web = teams.push_row(std::vector{EmployeeIndex(0), EmployeeIndex(1)});
+    auto empty = teams.push_row({});
+    auto sales = teams.push_row({EmployeeIndex(2), EmployeeIndex(3), EmployeeIndex(4)});
+    assert(teams.size() == 3);
+    assert(teams.total_size() == 5);
+    assert(teams.row_size(empty) == 0);
+    assert(teams[empty].empty());
+
+    // Rows are typed spans into the shared buffer
+    dense_index::DenseSpan<EmployeeIndex, MemberIndex> sales_team = teams[sales];
+    assert(sales_team.size() == 3);
+    assert(sales_team[MemberIndex(1)] == EmployeeIndex(3));
+    assert(sales_team.back() == EmployeeIndex(4));
+    assert(teams[web].data() + 2 == teams[sales].data());
+    sales_team[MemberIndex(0)] = EmployeeIndex(7);
+    assert(teams[sales].front() == EmployeeIndex(7));
+    assert(teams[sales].subspan(MemberIndex(1), 2)[MemberIndex(0)] == EmployeeIndex(3));
+
+    const Teams& const_teams = teams;
+    dense_index::DenseSpan<const EmployeeIndex, MemberIndex> view = const_teams[web];
+    assert(view.index_of(view.begin() + 1) == MemberIndex(1));
+
+    // Growing the last row in place
+    auto pos = teams.push_back_to_last(EmployeeIndex(5));
+    assert(pos == MemberIndex(3));
+    assert(teams[sales][pos] == EmployeeIndex(5));
+
+    // Same-length edits are in place, others compact the buffer
+    teams.set_row(web, {EmployeeIndex(8), EmployeeIndex(9)});
+    assert(teams[web][MemberIndex(0)] == EmployeeIndex(8));
+    teams.set_row(empty, {EmployeeIndex(6)});
+    assert(teams.row_size(empty) == 1);
+    assert(teams[sales][MemberIndex(3)] == EmployeeIndex(5));
+    assert(teams.total_size() == 7);
+
+    teams.rebuild([](TeamIndex, std::vector<EmployeeIndex>& members) {
+        std::erase_if(members, [](EmployeeIndex e) { return e.value() % 2 == 1; });
+    });
+    std::size_t members = 0;
+    for (auto row : teams) {
+        members += row.size();
+    }
+    assert(members == teams.total_size());
+    assert(teams.total_size() == 3);
+    assert(teams[sales].size() == 1 && teams[sales].front() == EmployeeIndex(4));
+
+    teams.pop_row();
+    assert(teams.size() == 2);
+    assert(teams.total_size() == 2);
+
+    // An array without rows has no last row to grow or pop
+    Teams none;
+    int rejected = 0;
+    try {
+        (void)none.push_back_to_last(EmployeeIndex(1));
+    } catch (const std::out_of_range&) {
+        ++rejected;
+    }
+    try {
+        none.pop_row();
+    } catch (const std::out_of_range&) {
+        ++rejected;
+    }
+    assert(rejected == 2 && none.empty() && none.total_size() == 0);
+
+    // Rows of the array itself are valid sources for push_row and set_row
+    dense_index::DenseJaggedArray<std::string, TeamIndex, MemberIndex> names;
+    auto first = names.push_row(std::vector<std::string>{"a long name that is heap allocated", "b"});
+    auto second = names.push_row(std::vector<std::string>{"c"});
+    for (int i = 0; i < 8; ++i) {
+        [[maybe_unused]] auto _ = names.push_row(names[first]);
+    }
+    assert(names.size() == 10);
+    assert(names[TeamIndex(9)][MemberIndex(0)] == "a long name that is heap allocated");
+    names.set_row(second, names[first]);
+    assert(names.row_size(second) == 2);
+    assert(names[second][MemberIndex(0)] == "a long name that is heap allocated");
+    assert(names[second][MemberIndex(1)] == "b");
+
+    std::cout << "  ✓ Jagged array rows and rebuild" << std::endl;
+}
+
+// Test index ranges and the work-stealing scheduler
+void test_work_stealing_scheduler() {
+    std::cout << "Testing WorkStealingScheduler..." << std::endl;
+
+    using Range = dense_index::IndexRange<EmployeeIndex>;
+    Range range(EmployeeIndex(2), EmployeeIndex(10));
+    assert(range.size() == 8);
+    assert(range.contains(EmployeeIndex(2)) && !range.contains(EmployeeIndex(10)));
+    auto [lo, hi] = range.split();
+    assert(lo.size() == 4 && hi.first() == EmployeeIndex(6));
+    assert(std::distance(range.begin(), range.end()) == 8);
+
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+    assert(scheduler.worker_count() == 4);
+    assert(!scheduler.current_worker());
+
+    // Every index visited exactly once
+    dense_index::DenseVector<int, EmployeeIndex> hits(10000, 0);
+    scheduler.parallel_for(dense_index::indices(hits), [&](EmployeeIndex i) { ++hits[i]; }, {.grain = 64, .affinity = std::nullopt});
+    assert(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+
+    // Chunks are disjoint, respect the grain and cover the range
+    std::atomic<std::size_t> covered{0};
+    scheduler.parallel_for_chunks(Range(EmployeeIndex(0), EmployeeIndex(1000)), [&](Range chunk) {
+        assert(chunk.size() <= 100);
+        covered += chunk.size();
+    }, {.grain = 100, .affinity = 2});
+    assert(covered == 1000);
+
+    // Nested loops run on the workers without deadlocking
+    std::atomic<std::size_t> inner{0};
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(8)), [&](EmployeeIndex) {
+        assert(scheduler.current_worker());
+        scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(100)), [&](EmployeeIndex) { ++inner; },
+                               {.grain = 10, .affinity = std::nullopt});
+    }, {.grain = 1, .affinity = std::nullopt});
+    assert(inner == 800);
+
+    // Exceptions propagate to the caller
+    bool caught = false;
+    try {
+        scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(100)), [](EmployeeIndex i) {
+            if (i == EmployeeIndex(42)) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+
+    auto stats = scheduler.stats();
+    assert(stats.size() == 4);
+    std::uint64_t tasks = 0;
+    for (const auto& s : stats) tasks += s.tasks;
+    assert(tasks > 0);
+    scheduler.reset_stats();
+    assert(scheduler.stats()[0].tasks == 0);
+
+    // Free functions use the default scheduler
+    std::atomic<std::size_t> sum{0};
+    dense_index::parallel_for(Range(EmployeeIndex(0), EmployeeIndex(100)),
+                              [&](EmployeeIndex i) { sum += i.value(); });
+    assert(sum == 4950);
+
+    std::cout << "  ✓ Parallel loops, nesting, exceptions and stats" << std::endl;
+}
+
+// Test parallel filter/compaction
+void test_parallel_filter() {
+    std::cout << "Testing parallel_filter..." << std::endl;
+
+    struct ActiveTag {};
+    using ActiveIndex = dense_index::StrongIndex<ActiveTag>;
+
+    auto check = [](const auto& source, auto pred) {
+        auto result = dense_index::parallel_filter<ActiveIndex>(source, pred);
+        std::size_t expected = 0;
+        for (EmployeeIndex i{}; i.value() < source.size(); ++i) {
+            if (!pred(source[i])) continue;
+            ActiveIndex out(expected++);
+            assert(result.sources[out] == i);
+            assert(result.values[out] == source[i]);
+        }
+        assert(result.values.size() == expected);
+        assert(result.sources.size() == expected);
+    };
+
+    // 4-byte, 8-byte and non-trivial element types, with ragged tails
+    dense_index::DenseVector<int, EmployeeIndex> ints;
+    dense_index::DenseVector<double, EmployeeIndex> weights;
+    dense_index::DenseVector<std::string, EmployeeIndex> names;
+    for (int i = 0; i < 100003; ++i) {
+        [[maybe_unused]] auto a = ints.push_back((i * 7919) % 1000);
+        [[maybe_unused]] auto b = weights.push_back(static_cast<double>((i * 31) % 997) / 997.0);
+        if (i < 5000) [[maybe_unused]] auto c = names.push_back(std::to_string(i));
+    }
+    check(ints, [](int v) { return v < 300; });
+    check(ints, [](int) { return true; });
+    check(ints, [](int) { return false; });
+    check(weights, [](double w) { return w > 0.75; });
+    check(names, [](const std::string& s) { return s.back() == '7'; });
+    check(dense_index::DenseVector<int, EmployeeIndex>{}, [](int) { return true; });
+    check(dense_index::DenseVector<int, EmployeeIndex>{1, 2, 3}, [](int v) { return v != 2; });
+
+    std::cout << "  ✓ Filter matches serial copy_if" << std::endl;
+}
+
+// Test histograms and counting sort over strong keys
+void test_histogram_and_counting_sort() {
+    std::cout << "Testing histogram and counting_sort_by_key..." << std::endl;
+
+    struct Hire {
+        DepartmentIndex department;
+        int id;
+    };
+    dense_index::DenseVector<Hire, EmployeeIndex> hires;
+    const std::size_t departments = 37;
+    for (int i = 0; i < 50000; ++i) {
+        [[maybe_unused]] auto _ = hires.push_back(Hire{DepartmentIndex((static_cast<std::size_t>(i) * 7) % departments), i});
+    }
+
+    auto counts = dense_index::histogram(hires, &Hire::department, departments);
+    static_assert(std::is_same_v<decltype(counts), dense_index::DenseVector<std::uint32_t, DepartmentIndex>>);
+    assert(counts.size() == departments);
+    assert(std::accumulate(counts.begin(), counts.end(), 0u) == hires.size());
+    assert(counts[DepartmentIndex(0)] == 1352);
+
+    dense_index::WorkStealingScheduler scheduler({.threads = 3});
+    auto parallel_counts = dense_index::parallel_histogram(
+        hires, [](const Hire& h) { return h.department; }, departments, scheduler);
+    assert(parallel_counts == counts);
+
+    auto sorted = dense_index::counting_sort_by_key(hires, &Hire::department, departments);
+    assert(sorted.values.size() == hires.size());
+    assert(sorted.key_domain_size() == departments);
+    for (DepartmentIndex d{}; d.value() < departments; ++d) {
+        auto bucket = sorted.bucket(d);
+        assert(bucket.size() == counts[d]);
+        int previous = -1;
+        for (EmployeeIndex pos : bucket) {
+            assert(sorted.values[pos].department == d);
+            assert(sorted.values[pos].id > previous);  // stable
+            previous = sorted.values[pos].id;
+        }
+    }
+
+    std::cout << "  ✓ Serial, privatized parallel and sort agree" << std::endl;
+}
+
+// Whether a const A accepts an atomic store
+template<typename A>
+concept ConstAtomicStorable = requires(const A& a, typename A::index_type i) { a.store(i, 1); };
+
+// Test atomic element access
+void test_dense_atomic() {
+    std::cout << "Testing DenseAtomicView and DenseAtomicVector..." << std::endl;
+
+    struct NodeTag {};
+    using NodeIndex = dense_index::StrongIndex<NodeTag>;
+    using Range = dense_index::IndexRange<EmployeeIndex>;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Degree counting into a DenseVector through a typed atomic view
+    const std::size_t nodes = 64;
+    dense_index::DenseVector<std::uint32_t, NodeIndex> degree(nodes, 0);
+    auto counters = dense_index::atomic_view(degree);
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(20000)), [&](EmployeeIndex e) {
+        counters.fetch_add(NodeIndex(e.value() % nodes), 1, std::memory_order_relaxed);
+    });
+    assert(std::all_of(degree.begin(), degree.end(), [](std::uint32_t d) { return d == 312 || d == 313; }));
+    assert(std::accumulate(degree.begin(), degree.end(), 0u) == 20000);
+
+    // Float accumulation falls back to a CAS loop
+    dense_index::DenseAtomicVector<double, NodeIndex> scores(nodes, 0.0);
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(8192)), [&](EmployeeIndex e) {
+        scores.add_relaxed(NodeIndex(e.value() % nodes), 0.5);
+    });
+    for (NodeIndex n{}; n.value() < nodes; ++n) {
+        assert(scores.load(n) == 64.0);
+    }
+
+    // Min, CAS, exchange and store
+    dense_index::DenseAtomicVector<int, NodeIndex> dist(4, 1000);
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(500)), [&](EmployeeIndex e) {
+        dist.fetch_min(NodeIndex(1), 1000 - static_cast<int>(e.value()));
+    });
+    assert(dist.load(NodeIndex(1)) == 501);
+    int expected = 1000;
+    assert(dist.compare_exchange_strong(NodeIndex(2), expected, 7));
+    assert(!dist.compare_exchange_strong(NodeIndex(2), expected, 8) && expected == 7);
+    assert(dist.exchange(NodeIndex(2), 9) == 7);
+    dist.view().store(NodeIndex(3), 3, std::memory_order_release);
+    assert(dist.fetch_or(NodeIndex(3), 4) == 3);
+    // Owners are deep-const, views shallow-const
+    using AtomicInts = dense_index::DenseAtomicVector<int, NodeIndex>;
+    using AtomicIntView = dense_index::DenseAtomicView<int, NodeIndex>;
+    static_assert(!ConstAtomicStorable<AtomicInts>);
+    static_assert(ConstAtomicStorable<AtomicIntView>);
+    const auto const_view = dist.view();
+    assert(const_view.fetch_add(NodeIndex(0), 1) == 1000);
+    assert(dist.load(NodeIndex(0)) == 1001);
+    auto plain = std::move(dist).release();
+    assert(plain[NodeIndex(3)] == 7 && plain[NodeIndex(2)] == 9);
+
+    std::cout << "  ✓ Typed atomic operations" << std::endl;
+}
+
+// Test sharded accumulation
+void test_sharded_accumulator() {
+    std::cout << "Testing DenseShardedAccumulator..." << std::endl;
+
+    struct NodeTag {};
+    using NodeIndex = dense_index::StrongIndex<NodeTag>;
+    using Range = dense_index::IndexRange<EmployeeIndex>;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Scatter over the whole domain promotes shards to dense storage
+    const std::size_t nodes = 1000;
+    dense_index::DenseShardedAccumulator<double, NodeIndex> rank(nodes, 0.0, {}, scheduler);
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(100000)), [&](EmployeeIndex e) {
+        rank.add(NodeIndex((e.value() * 13) % nodes), 0.25);
+    }, {.grain = 1000, .affinity = std::nullopt});
+    assert(rank.dense_shards() >= 1);
+    auto merged = rank.merge();
+    for (NodeIndex n{}; n.value() < nodes; ++n) {
+        assert(merged[n] == 25.0);
+    }
+
+    // Few hot keys stay in hash shards; calls from outside the pool also work
+    dense_index::DenseShardedAccumulator<int, NodeIndex, decltype([](int a, int b) { return std::max(a, b); })>
+        peak(1 << 20, 0, {}, scheduler);
+    scheduler.parallel_for(Range(EmployeeIndex(0), EmployeeIndex(5000)), [&](EmployeeIndex e) {
+        peak.add(NodeIndex(e.value() % 3), static_cast<int>(e.value()));
+    });
+    peak.add(NodeIndex(7), 42);
+    assert(peak.dense_shards() == 0);
+    auto peaks = peak.merge();
+    assert(peaks[NodeIndex(0)] == 4998 && peaks[NodeIndex(1)] == 4999 && peaks[NodeIndex(2)] == 4997);
+    assert(peaks[NodeIndex(7)] == 42 && peaks[NodeIndex(8)] == 0);
+
+    peak.reset();
+    assert(peak.merge()[NodeIndex(0)] == 0);
+
+    std::cout << "  ✓ Sparse and dense shards merge correctly" << std::endl;
+}
+
+// Test typed CSR graph algorithms against serial references
+void test_graph_algorithms() {
+    std::cout << "Testing graph algorithms..." << std::endl;
+
+    struct NodeTag {};
+    struct EdgeTag {};
+    using NodeId = dense_index::StrongIndex<NodeTag>;
+    using EdgeId = dense_index::StrongIndex<EdgeTag>;
+    using Graph = dense_index::DenseCsrGraph<NodeId, EdgeId>;
+
+    struct Edge {
+        NodeId from;
+        NodeId to;
+        double weight;
+    };
+
+    // Random sparse directed graph with a few isolated nodes and a skewed hub
+    const std::size_t n = 2000;
+    dense_index::DenseVector<Edge, EdgeId> edges;
+    std::uint64_t state = 12345;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+    for (int i = 0; i < 6000; ++i) {
+        const auto u = next() % (n - 50);
+        const auto v = next() % (n - 50);
+        [[maybe_unused]] auto _ = edges.push_back(Edge{NodeId(u), NodeId(v), 1.0 + static_cast<double>(next() % 100) / 10.0});
+    }
+    for (std::size_t v = 1; v < 300; ++v) {
+        [[maybe_unused]] auto _ = edges.push_back(Edge{NodeId(0), NodeId(v), 5.0});
+    }
+
+    auto out = Graph::from_edges(n, edges, &Edge::from, &Edge::to, &Edge::weight);
+    auto in = out.transpose();
+    assert(out.node_count() == n && out.edge_count() == edges.size());
+    assert(out.weighted() && in.edge_count() == out.edge_count());
+    assert(out.degree(NodeId(0)) >= 299);
+    for (auto e : out.out_edges(NodeId(5))) {
+        assert(out.target(e).value() < n);
+    }
+
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // BFS depths match a serial queue-based BFS, and parents are consistent
+    const NodeId source(0);
+    std::vector<std::uint32_t> expected_depth(n, ~0u);
+    std::deque<NodeId> queue{source};
+    expected_depth[0] = 0;
+    while (!queue.empty()) {
+        auto u = queue.front();
+        queue.pop_front();
+        for (NodeId v : out.neighbors(u)) {
+            if (expected_depth[v.value()] == ~0u) {
+                expected_depth[v.value()] = expected_depth[u.value()] + 1;
+                queue.push_back(v);
+            }
+        }
+    }
+    for (auto options : {dense_index::BfsOptions{}, dense_index::BfsOptions{.alpha = 1000000, .beta = 1}}) {
+        auto result = dense_index::bfs(out, in, source, options, scheduler);
+        for (auto v : out.nodes()) {
+            assert(result.depth[v] == expected_depth[v.value()]);
+            if (v != source && result.depth[v] != result.unreachable) {
+                assert(result.depth[result.parent[v]] + 1 == result.depth[v]);
+            }
+        }
+    }
+
+    // Delta-stepping agrees with Dijkstra
+    std::vector<double> expected_dist(n, std::numeric_limits<double>::infinity());
+    std::vector<std::pair<double, std::size_t>> heap{{0.0, 0}};
+    expected_dist[0] = 0.0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+        auto [d, u] = heap.back();
+        heap.pop_back();
+        if (d > expected_dist[u]) continue;
+        for (auto e : out.out_edges(NodeId(u))) {
+            const auto v = out.target(e).value();
+            if (d + out.weight(e) < expected_dist[v]) {
+                expected_dist[v] = d + out.weight(e);
+                heap.emplace_back(expected_dist[v], v);
+                std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+            }
+        }
+    }
+    for (double delta : {0.5, 3.0, 50.0}) {
+        auto dist = dense_index::sssp_delta_stepping(out, source, delta, scheduler);
+        for (auto v : out.nodes()) {
+            assert(dist[v] == expected_dist[v.value()] || std::abs(dist[v] - expected_dist[v.value()]) < 1e-9);
+        }
+    }
+
+    // PageRank sums to one and matches a serial power iteration
+    auto ranks = dense_index::pagerank(out, in, {.damping = 0.85, .max_iterations = 30, .tolerance = 0.0}, scheduler);
+    std::vector<double> expected_rank(n, 1.0 / n);
+    for (int iteration = 0; iteration < 30; ++iteration) {
+        std::vector<double> updated(n, 0.0);
+        double dangling = 0.0;
+        for (std::size_t u = 0; u < n; ++u) {
+            const auto degree = out.degree(NodeId(u));
+            if (degree == 0) dangling += expected_rank[u];
+            for (NodeId v : out.neighbors(NodeId(u))) updated[v.value()] += expected_rank[u] / degree;
+        }
+        for (auto& r : updated) r = (1.0 - 0.85 + 0.85 * dangling) / n + 0.85 * r;
+        expected_rank = updated;
+    }
+    assert(std::abs(std::accumulate(ranks.begin(), ranks.end(), 0.0) - 1.0) < 1e-9);
+    for (auto v : out.nodes()) {
+        assert(std::abs(ranks[v] - expected_rank[v.value()]) < 1e-12);
+    }
+
+    // Weakly connected components match a serial union-find
+    std::vector<std::size_t> root(n);
+    std::iota(root.begin(), root.end(), 0);
+    auto find = [&](std::size_t x) {
+        while (root[x] != x) x = root[x] = root[root[x]];
+        return x;
+    };
+    for (const auto& e : edges) {
+        auto a = find(e.from.value()), b = find(e.to.value());
+        if (a != b) root[std::max(a, b)] = std::min(a, b);
+    }
+    auto labels = dense_index::connected_components(out, in, 2, scheduler);
+    for (auto v : out.nodes()) {
+        assert(labels[v].value() == find(v.value()));
+    }
+
+    // Undirected overload on a symmetric graph
+    auto both = Graph::from_edges(4, std::vector<std::pair<NodeId, NodeId>>{
+        {NodeId(1), NodeId(3)}, {NodeId(3), NodeId(1)}}, &std::pair<NodeId, NodeId>::first, &std::pair<NodeId, NodeId>::second);
+    assert(!both.weighted());
+    auto small = dense_index::connected_components(both);
+    assert(small[NodeId(3)] == NodeId(1) && small[NodeId(2)] == NodeId(2));
+    assert(dense_index::bfs(both, NodeId(3)).depth[NodeId(1)] == 1);
+
+    // Delta-stepping needs non-negative edge weights and a positive bucket width
+    const std::vector<Edge> negative_edge{{NodeId(0), NodeId(1), -1.0}};
+    auto negative = Graph::from_edges(2, negative_edge, &Edge::from, &Edge::to, &Edge::weight);
+    int rejected = 0;
+    for (auto [graph, delta] : {std::pair{&both, 1.0}, std::pair{&out, 0.0}, std::pair{&negative, 1.0}}) {
+        try {
+            [[maybe_unused]] auto d = dense_index::sssp_delta_stepping(*graph, NodeId(0), delta, scheduler);
+        } catch (const std::invalid_argument&) {
+            ++rejected;
+        }
+    }
+    assert(rejected == 3);
+    for (auto options : {dense_index::BfsOptions{.alpha = 0, .beta = 18}, dense_index::BfsOptions{.alpha = 15, .beta = 0}}) {
+        try {
+            [[maybe_unused]] auto r = dense_index::bfs(both, NodeId(3), options);
+        } catch (const std::invalid_argument&) {
+            ++rejected;
+        }
+    }
+    assert(rejected == 5);
+
+    // A delta far below the heaviest edge keeps the bucket ring bounded
+    const std::vector<Edge> heavy_edges{{NodeId(0), NodeId(1), 4e9}, {NodeId(1), NodeId(2), 0.5}};
+    const auto heavy = Graph::from_edges(3, heavy_edges, &Edge::from, &Edge::to, &Edge::weight);
+    const auto heavy_dist = dense_index::sssp_delta_stepping(heavy, NodeId(0), 1.0, scheduler);
+    assert(heavy_dist[NodeId(1)] == 4e9 && heavy_dist[NodeId(2)] == 4e9 + 0.5);
+    using IntGraph = dense_index::DenseCsrGraph<NodeId, EdgeId, std::uint64_t>;
+    const auto heavy_int = IntGraph::from_edges(3, heavy_edges, &Edge::from, &Edge::to,
+                                                [](const Edge& e) { return static_cast<std::uint64_t>(e.weight * 2); });
+    const auto int_dist = dense_index::sssp_delta_stepping(heavy_int, NodeId(0), std::uint64_t{1}, scheduler);
+    assert(int_dist[NodeId(1)] == 8000000000u && int_dist[NodeId(2)] == 8000000001u);
+
+    std::cout << "  ✓ BFS, delta-stepping, PageRank and components" << std::endl;
+}
+
+// Test MPMC index queues and narrow index representations
+void test_index_queues() {
+    std::cout << "Testing MPMC index queues..." << std::endl;
+
+    struct SlotTag {};
+    using SlotIndex = dense_index::StrongIndex<SlotTag, std::uint32_t>;
+    using Range = dense_index::IndexRange<SlotIndex>;
+    static_assert(sizeof(SlotIndex) == sizeof(std::uint32_t));
+    static_assert(std::same_as<dense_index::index_rep_t<SlotIndex>, std::uint32_t>);
+    static_assert(std::same_as<dense_index::index_rep_t<EmployeeIndex>, std::size_t>);
+    assert(std::hash<SlotIndex>{}(SlotIndex(9)) == std::hash<std::uint32_t>{}(9));
+
+    // Narrow indices refuse values they cannot hold instead of wrapping
+    struct ByteTag {};
+    using ByteIndex = dense_index::StrongIndex<ByteTag, std::uint8_t>;
+    assert(ByteIndex::checked(255).value() == 255);
+    dense_index::DenseVector<int, ByteIndex> small(256, 0);
+    int rejected = 0;
+    try {
+        [[maybe_unused]] auto i = ByteIndex::checked(256);
+    } catch (const std::length_error&) {
+        ++rejected;
+    }
+    try {
+        [[maybe_unused]] auto i = small.push_back(1);
+    } catch (const std::length_error&) {
+        ++rejected;
+    }
+    try {
+        small.resize(257);
+    } catch (const std::length_error&) {
+        ++rejected;
+    }
+    assert(rejected == 3 && small.size() == 256);
+
+    // Bounded ring: capacity rounding, full/empty and batches
+    dense_index::DenseMpmcQueue<SlotIndex> ring(6);
+    assert(ring.capacity() == 8 && ring.empty());
+    assert(ring.try_push(SlotIndex(100)));
+    assert(ring.try_push(Range(SlotIndex(0), SlotIndex(10))) == 7);
+    assert(!ring.try_push(SlotIndex(200)) && ring.size() == 8);
+    assert(ring.try_pop() == SlotIndex(100));
+    std::array<SlotIndex, 16> out{};
+    assert(ring.try_pop(std::span(out)) == 7);
+    assert(out[0] == SlotIndex(0) && out[6] == SlotIndex(6));
+    assert(!ring.try_pop().has_value() && ring.try_pop(std::span(out)) == 0);
+
+    // Chunked queue spans chunks and reuses its first chunk after clear()
+    dense_index::DenseChunkedQueue<SlotIndex, 8> list;
+    list.push(Range(SlotIndex(0), SlotIndex(20)));
+    list.push(SlotIndex(20));
+    for (std::uint32_t i = 0; i <= 20; ++i) assert(list.try_pop() == SlotIndex(i));
+    assert(list.empty() && !list.try_pop().has_value());
+    list.push(Range(SlotIndex(0), SlotIndex(30)));
+    list.clear();
+    assert(list.empty());
+    const std::vector<SlotIndex> few{SlotIndex(3), SlotIndex(1)};
+    list.push(std::span(few));
+    assert(list.try_pop(std::span(out)) == 2 && out[0] == SlotIndex(3) && out[1] == SlotIndex(1));
+
+    // Drained chunks are reclaimed, so memory follows the queue length, not its traffic
+    for (std::uint32_t round = 0; round < 10000; ++round) {
+        list.push(Range(SlotIndex(0), SlotIndex(5)));
+        assert(list.try_pop(std::span(out)) == 5 && out[4] == SlotIndex(4));
+    }
+    assert(list.empty() && list.chunk_count() <= 4);
+
+    // Concurrent producers and consumers deliver every index exactly once
+    const std::uint32_t per_producer = 20000;
+    const std::uint32_t producers = 3;
+    const std::uint32_t total = per_producer * producers;
+    auto run = [&](auto& queue, auto push) {
+        std::vector<std::atomic<int>> seen(total);
+        std::atomic<std::uint32_t> received{0};
+        std::vector<std::thread> threads;
+        for (std::uint32_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                const auto base = p * per_producer;
+                for (std::uint32_t i = 0; i < per_producer;) {
+                    if (i % 3 == 0) {
+                        i += static_cast<std::uint32_t>(push(queue, Range(SlotIndex(base + i), SlotIndex(base + std::min(i + 37, per_producer)))));
+                    } else {
+                        i += static_cast<std::uint32_t>(push(queue, SlotIndex(base + i)));
+                    }
+                }
+            });
+        }
+        for (int c = 0; c < 3; ++c) {
+            threads.emplace_back([&] {
+                std::array<SlotIndex, 16> batch{};
+                while (received.load() < total) {
+                    const auto n = queue.try_pop(std::span(batch));
+                    for (std::size_t i = 0; i < n; ++i) seen[batch[i].value()].fetch_add(1);
+                    if (auto one = queue.try_pop()) {
+                        seen[one->value()].fetch_add(1);
+                        received.fetch_add(1);
+                    }
+                    received.fetch_add(static_cast<std::uint32_t>(n));
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        assert(std::ranges::all_of(seen, [](const auto& s) { return s.load() == 1; }));
+        assert(queue.empty());
+    };
+
+    dense_index::DenseMpmcQueue<SlotIndex> shared_ring(64);
+    run(shared_ring, [](auto& q, auto item) -> std::size_t {
+        if constexpr (std::same_as<decltype(item), SlotIndex>) {
+            return q.try_push(item) ? 1 : 0;
+        } else {
+            return q.try_push(item);
+        }
+    });
+    dense_index::DenseChunkedQueue<SlotIndex, 64> shared_list;
+    run(shared_list, [](auto& q, auto item) -> std::size_t {
+        q.push(item);
+        if constexpr (std::same_as<decltype(item), SlotIndex>) {
+            return 1;
+        } else {
+            return item.size();
+        }
+    });
+    for (int i = 0; i < 4; ++i) assert(!shared_list.try_pop().has_value());
+    assert(shared_list.chunk_count() <= 2);
+
+    std::cout << "  ✓ Bounded and chunked queues deliver every index once under contention" << std::endl;
+}
+
+// Test frontier switching between sparse and dense forms
+void test_dense_frontier() {
+    std::cout << "Testing DenseFrontier..." << std::endl;
+
+    struct NodeTag {};
+    using NodeIndex = dense_index::StrongIndex<NodeTag, std::uint32_t>;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Sparse form keeps insertion order and deduplicates
+    dense_index::DenseFrontier<NodeIndex> frontier(640, 32);
+    assert(frontier.insert(NodeIndex(7)) && frontier.insert(NodeIndex(3)) && !frontier.insert(NodeIndex(7)));
+    assert(frontier.size() == 2 && !frontier.is_dense() && frontier.contains(NodeIndex(3)));
+    std::vector<NodeIndex> order;
+    frontier.for_each([&](NodeIndex u) { order.push_back(u); });
+    assert((order == std::vector<NodeIndex>{NodeIndex(7), NodeIndex(3)}));
+
+    // Crossing domain / divisor switches to the bitset; iteration is then sorted
+    for (std::uint32_t i = 100; i < 120; ++i) frontier.insert(NodeIndex(i));
+    assert(frontier.is_dense() && frontier.size() == 22);
+    order.clear();
+    frontier.for_each([&](NodeIndex u) { order.push_back(u); });
+    assert(order.front() == NodeIndex(3) && order[1] == NodeIndex(7) && order.back() == NodeIndex(119));
+
+    std::atomic<std::uint32_t> sum{0};
+    frontier.parallel_for_each([&](NodeIndex u) { sum.fetch_add(u.value()); }, scheduler, 1);
+    assert(sum.load() == 10 + (100 + 119) * 10);
+
+    // Union works across forms, and clearing returns to the sparse form
+    dense_index::DenseFrontier<NodeIndex> small(640, 32);
+    small.insert(NodeIndex(500));
+    small.insert(NodeIndex(3));
+    small |= frontier;
+    assert(small.is_dense() && small.size() == 23 && small.contains(NodeIndex(500)));
+    frontier.clear();
+    assert(frontier.empty() && !frontier.is_dense() && !frontier.contains(NodeIndex(3)));
+    frontier.insert(NodeIndex(1));
+    frontier |= small;
+    assert(frontier.size() == 24);
+
+    // Bulk dense assignment falls back to the list when the result is small
+    frontier.assign_dense([](auto& bits) { bits.set(NodeIndex(42)); });
+    assert(!frontier.is_dense() && frontier.size() == 1 && frontier.contains(NodeIndex(42)));
+    frontier.assign_dense([](auto& bits) {
+        for (auto& w : bits.words()) w = ~std::uint64_t{0};
+    });
+    assert(frontier.is_dense() && frontier.size() == 640);
+    frontier.to_sparse();
+    std::size_t visited = 0;
+    frontier.parallel_for_each([&](NodeIndex) { ++visited; }, scheduler, 1000);
+    assert(!frontier.is_dense() && visited == 640);
+
+    std::cout << "  ✓ Sparse and dense forms behave the same and switch on density" << std::endl;
+}
+
+// Test archetype-based world storage
+void test_dense_world() {
+    std::cout << "Testing DenseWorld..." << std::endl;
+
+    struct EntityTag {};
+    using Entity = dense_index::StrongIndex<EntityTag, std::uint32_t>;
+    struct Position { float x, y; };
+    struct Velocity { float dx, dy; };
+    struct Health { int hp; };
+    using World = dense_index::DenseWorld<Entity, Position, Velocity, Health>;
+    static_assert(World::mask_of<Velocity, const Health> == 0b110);
+
+    World world;
+    std::vector<Entity> movers;
+    for (int i = 0; i < 600; ++i) {
+        movers.push_back(world.create(Position{float(i), 0}, Velocity{1, 2}));
+    }
+    auto rock = world.create(Position{-1, -1});
+    auto hero = world.create(Position{0, 0}, Velocity{0, 0}, Health{10});
+    assert(world.size() == 602 && world.archetype_count() == 3);
+    assert(world.has<Velocity>(hero) && !world.has<Velocity>(rock));
+
+    // Typed query over packed spans, across archetypes
+    auto moving = world.query<Position, const Velocity>();
+    assert(moving.count() == 601);
+    std::size_t chunks = 0;
+    moving.for_each_chunk([&](const auto& chunk) {
+        auto pos = chunk.template get<Position>();
+        auto vel = chunk.template get<Velocity>();
+        static_assert(std::same_as<decltype(vel), std::span<const Velocity>>);
+        assert(chunk.size() <= World::chunk_rows && pos.size() == chunk.size());
+        for (std::size_t i = 0; i < chunk.size(); ++i) pos[i].x += vel[i].dx;
+        ++chunks;
+    });
+    assert(chunks == 4);  // 600 rows = 3 chunks, plus the hero's archetype
+    assert(world.get<Position>(movers[10]).x == 11.0f && world.get<Position>(rock).x == -1.0f);
+
+    // Parallel execution visits every entity once
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+    world.query<Position, const Velocity>().parallel_for_each([](Entity, Position& p, const Velocity& v) {
+        p.y += v.dy;
+    }, scheduler);
+    assert(world.get<Position>(movers[599]).y == 2.0f && world.get<Position>(hero).y == 0.0f);
+
+    // Structural changes move entities between archetypes
+    world.emplace<Health>(movers[5], 3);
+    assert(world.has<Health>(movers[5]) && world.get<Position>(movers[5]).x == 6.0f);
+    assert(world.remove<Velocity>(movers[7]) && !world.remove<Velocity>(movers[7]));
+    assert(world.get<Position>(movers[7]).x == 8.0f);
+    world.destroy(movers[0]);
+    assert(!world.alive(movers[0]) && world.size() == 601);
+    assert(world.get<Position>(movers[599]).x == 600.0f);
+    auto reused = world.create(Health{1});
+    assert(reused == movers[0]);
+    bool threw = false;
+    try {
+        [[maybe_unused]] auto& v = world.get<Velocity>(rock);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::size_t with_health = 0;
+    world.query<const Health>().without<Velocity>().for_each([&](Entity, const Health&) { ++with_health; });
+    assert(with_health == 1);
+
+    // Change detection: only chunks written after the saved tick are visited
+    const auto seen = world.tick();
+    world.advance_tick();
+    world.get<Health>(hero).hp -= 4;
+    std::vector<Entity> damaged;
+    world.query<const Health>().changed_since<Health>(seen).for_each([&](Entity e, const Health& h) {
+        if (h.hp < 10) damaged.push_back(e);
+    });
+    assert(damaged.size() == 2);  // hero, and movers[5] which shares its archetype
+    std::size_t touched = 0;
+    world.query<const Position>().changed_since<Position>(seen).for_each_chunk([&](const auto&) { ++touched; });
+    assert(touched == 0);
+
+    std::cout << "  ✓ Archetype queries, structural changes and change ticks" << std::endl;
+}
+
+// Test spatial grid and BVH queries
+void test_spatial_index() {
+    std::cout << "Testing spatial grid and BVH..." << std::endl;
+
+    struct EntityTag {};
+    using Entity = dense_index::StrongIndex<EntityTag, std::uint32_t>;
+    struct Transform { float x, y, z; };
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Deterministic pseudo-random cloud in a 100^3 box
+    dense_index::DenseVector<Transform, Entity> transforms;
+    std::uint32_t seed = 12345;
+    auto next = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) * 100.0f;
+    };
+    for (int i = 0; i < 6000; ++i) {
+        [[maybe_unused]] auto e = transforms.push_back(Transform{next(), next(), next()});
+    }
+
+    auto brute_radius = [&](dense_index::Point3 c, float r) {
+        std::vector<Entity> hits;
+        for (Entity e{}; e.value() < transforms.size(); ++e) {
+            const auto& t = transforms[e];
+            if ((t.x - c.x) * (t.x - c.x) + (t.y - c.y) * (t.y - c.y) + (t.z - c.z) * (t.z - c.z) <= r * r) hits.push_back(e);
+        }
+        return hits;
+    };
+    auto sorted = [](std::vector<Entity> v) {
+        std::ranges::sort(v);
+        return v;
+    };
+    const dense_index::Box3 box{{10, 20, 30}, {40, 45, 50}};
+    std::vector<Entity> in_box;
+    for (Entity e{}; e.value() < transforms.size(); ++e) {
+        const auto& t = transforms[e];
+        if (box.contains({t.x, t.y, t.z})) in_box.push_back(e);
+    }
+
+    dense_index::DenseSpatialGrid<Entity> grid(5.0f);
+    grid.build(transforms, std::identity{}, scheduler);
+    dense_index::DenseBvh<Entity> bvh;
+    bvh.build(transforms, std::identity{}, scheduler);
+    assert(grid.size() == 6000 && bvh.size() == 6000);
+
+    for (auto [center, radius] : {std::pair{dense_index::Point3{50, 50, 50}, 7.0f}, std::pair{dense_index::Point3{0, 0, 0}, 20.0f},
+                                  std::pair{dense_index::Point3{99, 1, 50}, 3.0f}, std::pair{dense_index::Point3{50, 50, 50}, 500.0f}}) {
+        const auto expected = brute_radius(center, radius);
+        assert(sorted(grid.query_radius(center, radius)) == expected);
+        assert(sorted(bvh.query_radius(center, radius)) == expected);
+    }
+    assert(sorted(grid.query_box(box)) == in_box && sorted(bvh.query_box(box)) == in_box);
+
+    // Move every entity; the grid updates incrementally and the BVH refits
+    for (Entity e{}; e.value() < transforms.size(); ++e) {
+        transforms[e].x = e.value() % 7 == 0 ? 100.0f - transforms[e].x : transforms[e].x + 0.1f;
+    }
+    auto pos = [&](Entity e) { return transforms[e]; };
+    grid.update_all(pos, scheduler);
+    bvh.refit(pos, scheduler);
+    for (auto center : {dense_index::Point3{50, 50, 50}, dense_index::Point3{20, 70, 30}}) {
+        const auto expected = brute_radius(center, 12.0f);
+        assert(sorted(grid.query_radius(center, 12.0f)) == expected);
+        assert(sorted(bvh.query_radius(center, 12.0f)) == expected);
+    }
+    grid.update(Entity(3), Transform{500, 500, 500});
+    assert(grid.query_radius(Transform{500, 500, 500}, 1.0f) == std::vector<Entity>{Entity(3)});
+    assert(grid.position(Entity(3)) == (dense_index::Point3{500, 500, 500}));
+
+    // Coordinates beyond the int32 cell range clamp to the edge cells
+    const auto inf = std::numeric_limits<float>::infinity();
+    const std::vector<dense_index::Point3> far_points{{1e30f, 0, 0}, {-1e30f, 0, 0}, {inf, 0, 0}, {0.5f, 0.5f, 0.5f}};
+    dense_index::DenseSpatialGrid<Entity> far(1.0f);
+    far.build(far_points.size(), [&](Entity e) { return far_points[e.value()]; }, scheduler);
+    assert(sorted(far.query_box({{1e30f, -1, -1}, {inf, 1, 1}})) == (std::vector<Entity>{Entity(0), Entity(2)}));
+    assert(far.query_box({{-inf, -1, -1}, {-1e29f, 1, 1}}) == std::vector<Entity>{Entity(1)});
+    assert(far.query_radius(dense_index::Point3{0.5f, 0.5f, 0.5f}, 0.1f) == std::vector<Entity>{Entity(3)});
+
+    std::cout << "  ✓ Radius and box queries match brute force after incremental updates" << std::endl;
+}
+
+// Test dense matrix kernels
+void test_dense_matrix() {
+    std::cout << "Testing DenseMatrix kernels..." << std::endl;
+
+    struct SampleTag {};
+    struct FeatureTag {};
+    struct OutputTag {};
+    using Sample = dense_index::StrongIndex<SampleTag>;
+    using Feature = dense_index::StrongIndex<FeatureTag>;
+    using Output = dense_index::StrongIndex<OutputTag>;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Domains are checked at compile time
+    using Design = dense_index::DenseMatrix<double, Sample, Feature>;
+    using Weights = dense_index::DenseMatrix<double, Feature, Output>;
+    constexpr auto multipliable = []<typename L, typename R>(std::type_identity<L>, std::type_identity<R>) {
+        return requires(L l, R r) { l * r; };
+    };
+    static_assert(std::same_as<decltype(Design{} * Weights{}), dense_index::DenseMatrix<double, Sample, Output>>);
+    static_assert(!multipliable(std::type_identity<Design>{}, std::type_identity<Design>{}));
+    static_assert(!multipliable(std::type_identity<Design>{}, std::type_identity<dense_index::DenseVector<double, Sample>>{}));
+
+    Design small(2, 3);
+    small[Sample(1), Feature(2)] = 5.0;
+    assert(small.at(Sample(1), Feature(2)) == 5.0 && small.row(Sample(1))[Feature(2)] == 5.0);
+    assert((small.transpose()[Feature(2), Sample(1)] == 5.0));
+    bool threw = false;
+    try {
+        [[maybe_unused]] auto v = small.at(Sample(2), Feature(0));
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Kernels against a naive reference, with sizes that leave SIMD and block remainders
+    auto check = [&]<typename T>(std::type_identity<T>, std::size_t m, std::size_t k, std::size_t n, double tolerance) {
+        dense_index::DenseMatrix<T, Sample, Feature> a(m, k);
+        dense_index::DenseMatrix<T, Feature, Output> b(k, n);
+        dense_index::DenseVector<T, Feature> x(k, T{});
+        for (auto r : a.row_indices()) {
+            for (auto c : a.col_indices()) a[r, c] = static_cast<T>((r.value() * 7 + c.value() * 3) % 11) - T(5);
+        }
+        for (auto r : b.row_indices()) {
+            for (auto c : b.col_indices()) b[r, c] = static_cast<T>((r.value() * 5 + c.value()) % 7) - T(3);
+        }
+        for (auto f : indices(x)) x[f] = static_cast<T>(f.value() % 5) - T(2);
+
+        const auto y = a * x;
+        const auto y_par = dense_index::multiply(a, x, scheduler);
+        const auto c = a * b;
+        const auto c_par = dense_index::multiply(a, b, scheduler);
+        for (auto r : a.row_indices()) {
+            T expected{};
+            for (auto f : a.col_indices()) expected += a[r, f] * x[f];
+            assert(std::abs(static_cast<double>(y[r] - expected)) <= tolerance && y_par[r] == y[r]);
+            for (auto o : b.col_indices()) {
+                T sum{};
+                for (auto f : a.col_indices()) sum += a[r, f] * b[f, o];
+                assert((std::abs(static_cast<double>(c[r, o] - sum)) <= tolerance));
+            }
+        }
+        assert(c_par == c);
+    };
+    check(std::type_identity<double>{}, 37, 53, 29, 1e-9);
+    check(std::type_identity<float>{}, 70, 300, 270, 1e-2);
+    check(std::type_identity<int>{}, 9, 5, 6, 0);
+
+    std::cout << "  ✓ Typed GEMV and GEMM match the reference" << std::endl;
+}
+
+// Test sparse matrix conversion and products
+void test_sparse_matrix() {
+    std::cout << "Testing DenseSparseMatrix..." << std::endl;
+
+    struct UserTag {};
+    struct ItemTag {};
+    using User = dense_index::StrongIndex<UserTag>;
+    using Item = dense_index::StrongIndex<ItemTag, std::uint32_t>;
+    using Ratings = dense_index::DenseSparseMatrix<double, User, Item>;
+    using Entry = Ratings::entry_type;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Unsorted COO input with a duplicate coordinate
+    const std::vector<Entry> coo{{User(2), Item(3), 1.5}, {User(0), Item(1), 2.0}, {User(2), Item(0), -1.0},
+                                 {User(0), Item(1), 0.5}, {User(1), Item(2), 4.0}};
+    const auto m = Ratings::from_coo(4, 5, coo);
+    assert(m.rows() == 4 && m.cols() == 5 && m.nonzeros() == 4);
+    assert((m[User(0), Item(1)] == 2.5 && m[User(2), Item(0)] == -1.0 && m[User(3), Item(4)] == 0.0));
+    assert(m.contains(User(1), Item(2)) && !m.contains(User(1), Item(3)));
+    assert(m.row_columns(User(2)).size() == 2 && m.row_columns(User(2))[0] == Item(0));
+    assert(m.row_values(User(3)).empty());
+    bool threw = false;
+    try {
+        [[maybe_unused]] auto v = m.at(User(4), Item(0));
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Transpose swaps the domains; SpMV is typed by them
+    const dense_index::DenseSparseMatrix<double, Item, User> t = m.transpose();
+    assert((t[Item(1), User(0)] == 2.5 && t.nonzeros() == 4 && t.transpose() == m));
+    dense_index::DenseVector<double, Item> x(5, 0.0);
+    for (auto i : indices(x)) x[i] = 1.0 + static_cast<double>(i.value());
+    const dense_index::DenseVector<double, User> y = m * x;
+    assert(y[User(0)] == 5.0 && y[User(1)] == 12.0 && y[User(2)] == 5.0 && y[User(3)] == 0.0);
+
+    // Parallel SpMV over a skewed matrix matches the serial one
+    std::vector<Entry> skewed;
+    for (std::size_t r = 0; r < 3000; ++r) {
+        const std::size_t degree = r % 500 == 0 ? 2000 : r % 7;
+        for (std::size_t k = 0; k < degree; ++k) skewed.push_back({User(r), Item((r * 31 + k * 17) % 2500), 0.5});
+    }
+    const auto big = Ratings::from_coo(3000, 2500, skewed);
+    dense_index::DenseVector<double, Item> ones(2500, 1.0);
+    const auto serial = big * ones;
+    assert(dense_index::multiply(big, ones, scheduler) == serial);
+    assert(serial[User(500)] == 1000.0 && serial[User(3)] == 1.5);
+
+    // Adjacency matrix of a typed graph
+    struct NodeTag {};
+    struct EdgeTag {};
+    using Node = dense_index::StrongIndex<NodeTag>;
+    using Edge = dense_index::StrongIndex<EdgeTag>;
+    struct Arc { Node from, to; };
+    const std::vector<Arc> arcs{{Node(0), Node(1)}, {Node(0), Node(2)}, {Node(1), Node(2)}, {Node(0), Node(1)}};
+    const auto graph = dense_index::DenseCsrGraph<Node, Edge>::from_edges(3, arcs, &Arc::from, &Arc::to);
+    const auto adjacency = dense_index::adjacency_matrix(graph);
+    assert((adjacency[Node(0), Node(1)] == 2.0 && adjacency.nonzeros() == 3));
+
+    std::cout << "  ✓ COO to CSR, transpose and SpMV" << std::endl;
+}
+
+// Test typed mdspan layouts
+void test_dense_mdspan() {
+    std::cout << "Testing DenseMdSpan..." << std::endl;
+
+    struct XTag {};
+    struct YTag {};
+    struct ZTag {};
+    using X = dense_index::StrongIndex<XTag>;
+    using Y = dense_index::StrongIndex<YTag>;
+    using Z = dense_index::StrongIndex<ZTag, std::uint32_t>;
+    using dense_index::full_extent;
+
+    // Mixed static and dynamic extents, layout_right
+    std::vector<int> storage(2 * 3 * 4);
+    std::iota(storage.begin(), storage.end(), 0);
+    using Extents = dense_index::extents<2, std::dynamic_extent, 4>;
+    dense_index::DenseMdSpan<int, Extents, X, Y, Z> grid(storage.data(), 3);
+    static_assert(decltype(grid)::rank == 3 && Extents::rank_dynamic() == 1);
+    assert(grid.extent(0) == 2 && grid.extent(1) == 3 && grid.extent(2) == 4 && grid.size() == 24);
+    assert((grid[X(1), Y(2), Z(3)] == 23 && grid[X(0), Y(1), Z(0)] == 4));
+    assert(grid.stride(0) == 12 && grid.stride(1) == 4 && grid.stride(2) == 1);
+    int sum = 0;
+    for (auto x : grid.axis<0>()) {
+        for (auto y : grid.axis<1>()) {
+            for (auto z : grid.axis<2>()) sum += grid[x, y, z];
+        }
+    }
+    assert(sum == 23 * 24 / 2);
+    bool threw = false;
+    try {
+        (void)grid.at(X(0), Y(3), Z(0));
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Axes only accept their own index type
+    auto indexable = []<typename M, typename... Is>(M&, Is...) { return requires(M m, Is... is) { m[is...]; }; };
+    assert(indexable(grid, X(0), Y(0), Z(0)));
+    assert(!indexable(grid, Y(0), X(0), Z(0)));
+    assert(!indexable(grid, std::size_t{0}, std::size_t{0}, std::size_t{0}));
+
+    // layout_left reverses which axis is contiguous
+    dense_index::DenseLayoutMdSpan<int, dense_index::dextents<2>, dense_index::layout_left, X, Y> left(storage.data(), 4, 6);
+    assert((left[X(1), Y(0)] == 1 && left[X(0), Y(1)] == 4 && left.stride(1) == 4));
+
+    // Typed slicing: fixing an axis drops it, a range narrows it
+    auto plane = dense_index::submdspan(grid, X(1), full_extent, full_extent);
+    static_assert(std::is_same_v<decltype(plane), dense_index::DenseLayoutMdSpan<int, dense_index::dextents<2>, dense_index::layout_stride, Y, Z>>);
+    assert((plane[Y(0), Z(0)] == 12 && plane[Y(2), Z(1)] == 21));
+    auto column = dense_index::submdspan(grid, full_extent, dense_index::IndexRange<Y>(Y(1), Y(3)), Z(2));
+    static_assert(decltype(column)::rank == 2);
+    assert(column.extent(0) == 2 && column.extent(1) == 2);
+    assert((column[X(0), Y(0)] == 6 && column[X(1), Y(1)] == 22));
+    auto line = dense_index::submdspan(plane, Y(1), full_extent);
+    assert((line.extent(0) == 4 && line[Z(3)] == 19));
+    column[X(1), Y(1)] = -1;
+    assert(storage[22] == -1);
+
+    // Tiled layout covers every element exactly once, padding partial tiles
+    using Tiled = dense_index::DenseLayoutMdSpan<int, dense_index::dextents<2>, dense_index::layout_tiled<4, 4>, X, Y>;
+    const Tiled::mapping_type tiled_map(dense_index::dextents<2>(6, 10));
+    assert(tiled_map.required_span_size() == 8 * 12);
+    std::vector<int> tiled_storage(tiled_map.required_span_size(), 0);
+    Tiled tiled(tiled_storage.data(), tiled_map);
+    for (auto x : tiled.axis<0>()) {
+        for (auto y : tiled.axis<1>()) ++tiled[x, y];
+    }
+    assert(std::count(tiled_storage.begin(), tiled_storage.end(), 1) == 60);
+    assert((&tiled[X(0), Y(3)] == tiled_storage.data() + 3 && &tiled[X(1), Y(0)] == tiled_storage.data() + 4));
+    assert((&tiled[X(0), Y(4)] == tiled_storage.data() + 16));
+
+    // DenseMatrix exposes its storage as a 2-D span
+    struct RTag {};
+    struct CTag {};
+    using R = dense_index::StrongIndex<RTag>;
+    using C = dense_index::StrongIndex<CTag>;
+    dense_index::DenseMatrix<double, R, C> matrix(3, 5, 1.0);
+    matrix[R(2), C(4)] = 7.0;
+    auto view = matrix.mdspan();
+    assert((view[R(2), C(4)] == 7.0 && &view[R(1), C(0)] == &matrix[R(1), C(0)]));
+    auto last_row = dense_index::submdspan(view, R(2), full_extent);
+    assert((last_row[C(4)] == 7.0 && last_row.extent(0) == 5));
+    const auto& cmatrix = matrix;
+    dense_index::DenseMdSpan<const double, dense_index::dextents<2>, R, C> cview = cmatrix.mdspan();
+    assert((cview[R(2), C(4)] == 7.0));
+    dense_index::DenseMdSpan<const double, dense_index::dextents<2>, R, C> converted = view;
+    assert(converted.data_handle() == matrix.data());
+
+    std::cout << "  ✓ Typed axes, layouts and submdspan slicing" << std::endl;
+}
+
+// Test tiled stencils
+void test_stencil() {
+    std::cout << "Testing stencil_apply..." << std::endl;
+
+    struct RowTag {};
+    struct ColTag {};
+    struct PlaneTag {};
+    using Row = dense_index::StrongIndex<RowTag>;
+    using Col = dense_index::StrongIndex<ColTag>;
+    using Plane = dense_index::StrongIndex<PlaneTag>;
+    using DR = dense_index::IndexDelta<Row>;
+    using DC = dense_index::IndexDelta<Col>;
+    using DP = dense_index::IndexDelta<Plane>;
+    using Grid = dense_index::DenseMatrix<float, Row, Col>;
+    using Boundary = dense_index::StencilBoundary;
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+
+    // Sizes that leave partial edge tiles on both axes
+    const std::size_t rows = 77;
+    const std::size_t cols = 300;
+    Grid grid(rows, cols);
+    for (auto r : grid.row_indices()) {
+        for (auto c : grid.col_indices()) grid[r, c] = static_cast<float>((r.value() * 31 + c.value() * 17) % 23);
+    }
+
+    const auto source = [](std::ptrdiff_t i, std::size_t n, Boundary b) -> std::ptrdiff_t {
+        const auto size = static_cast<std::ptrdiff_t>(n);
+        if (i >= 0 && i < size) return i;
+        if (b == Boundary::clamp) return i < 0 ? 0 : size - 1;
+        if (b == Boundary::wrap) return ((i % size) + size) % size;
+        return -1;
+    };
+
+    // 5x5 weighted blur against a direct loop, for every boundary rule
+    for (auto boundary : {Boundary::clamp, Boundary::wrap, Boundary::zero}) {
+        const auto blurred = dense_index::stencil_apply(grid, 2, [](const auto& n) {
+            float sum = 0.0f;
+            for (int dr = -2; dr <= 2; ++dr) {
+                for (int dc = -2; dc <= 2; ++dc) sum += static_cast<float>(3 + dr + 2 * dc) * n[DR(dr), DC(dc)];
+            }
+            return sum;
+        }, scheduler, {.boundary = boundary});
+        static_assert(std::is_same_v<std::remove_cvref_t<decltype(blurred)>, Grid>);
+        for (std::size_t r = 0; r < rows; ++r) {
+            for (std::size_t c = 0; c < cols; ++c) {
+                float expected = 0.0f;
+                for (int dr = -2; dr <= 2; ++dr) {
+                    for (int dc = -2; dc <= 2; ++dc) {
+                        const auto sr = source(static_cast<std::ptrdiff_t>(r) + dr, rows, boundary);
+                        const auto sc = source(static_cast<std::ptrdiff_t>(c) + dc, cols, boundary);
+                        const float v = sr < 0 || sc < 0 ? 0.0f : grid[Row(sr), Col(sc)];
+                        expected += static_cast<float>(3 + dr + 2 * dc) * v;
+                    }
+                }
+                assert(std::abs(blurred[Row(r), Col(c)] - expected) <= 1e-3f * (1.0f + std::abs(expected)));
+            }
+        }
+    }
+
+    // Ping-pong diffusion conserves mass under periodic boundaries
+    Grid next(rows, cols);
+    Grid current = grid;
+    const double mass = std::accumulate(current.data(), current.data() + current.size(), 0.0);
+    for (int step = 0; step < 10; ++step) {
+        dense_index::stencil_apply(current, next, 1, [](const auto& n) {
+            return n.center() + 0.2f * (n[DR(-1), DC(0)] + n[DR(1), DC(0)] + n[DR(0), DC(-1)] + n[DR(0), DC(1)] - 4.0f * n.center());
+        }, scheduler, {.boundary = Boundary::wrap});
+        std::swap(current, next);
+    }
+    assert(std::abs(std::accumulate(current.data(), current.data() + current.size(), 0.0) - mass) < 1e-2 * mass);
+
+    // Result type follows the kernel: a mask from a comparison with neighbours
+    const auto peaks = dense_index::stencil_apply(grid, 1, [](const auto& n) -> unsigned char {
+        return n.center() > n[DR(0), DC(-1)] && n.center() > n[DR(0), DC(1)];
+    }, scheduler);
+    static_assert(std::is_same_v<std::remove_cvref_t<decltype(peaks)>, dense_index::DenseMatrix<unsigned char, Row, Col>>);
+
+    // A mutable kernel's scratch buffer is private to each tile
+    const auto cross = dense_index::stencil_apply(grid, 1, [scratch = std::vector<float>()](const auto& n) mutable {
+        scratch.assign({n[DR(-1), DC(0)], n[DR(1), DC(0)], n[DR(0), DC(-1)], n[DR(0), DC(1)]});
+        return std::accumulate(scratch.begin(), scratch.end(), 0.0f);
+    }, scheduler);
+    for (auto r : grid.row_indices()) {
+        for (auto c : grid.col_indices()) {
+            const auto up = Row(r.value() == 0 ? 0 : r.value() - 1), down = Row(std::min(r.value() + 1, rows - 1));
+            const auto left = Col(c.value() == 0 ? 0 : c.value() - 1), right = Col(std::min(c.value() + 1, cols - 1));
+            assert((cross[r, c] == grid[up, c] + grid[down, c] + grid[r, left] + grid[r, right]));
+        }
+    }
+
+    // Deltas are typed per axis
+    using Neighborhood = dense_index::StencilNeighborhood<float, Row, Col>;
+    auto readable = []<typename N, typename... Ds>(std::type_identity<N>, Ds...) { return requires(const N& n, Ds... ds) { n[ds...]; }; };
+    assert(readable(std::type_identity<Neighborhood>{}, DR(0), DC(1)));
+    assert(!readable(std::type_identity<Neighborhood>{}, DC(1), DR(0)));
+    assert(!readable(std::type_identity<Neighborhood>{}, 0, 1));
+
+    // 3-D seven-point Laplacian over an mdspan volume
+    const std::size_t np = 19, nr = 23, nc = 37;
+    std::vector<double> volume(np * nr * nc);
+    for (std::size_t i = 0; i < volume.size(); ++i) volume[i] = static_cast<double>((i * 7919) % 101);
+    std::vector<double> laplacian(volume.size());
+    using Volume = dense_index::DenseMdSpan<const double, dense_index::dextents<3>, Plane, Row, Col>;
+    using OutVolume = dense_index::DenseMdSpan<double, dense_index::dextents<3>, Plane, Row, Col>;
+    const Volume in(volume.data(), np, nr, nc);
+    dense_index::stencil_apply(in, OutVolume(laplacian.data(), np, nr, nc), 1, [](const auto& n) {
+        return n[DP(-1), DR(0), DC(0)] + n[DP(1), DR(0), DC(0)] + n[DP(0), DR(-1), DC(0)] + n[DP(0), DR(1), DC(0)] +
+               n[DP(0), DR(0), DC(-1)] + n[DP(0), DR(0), DC(1)] - 6.0 * n.center();
+    }, scheduler);
+    const auto at = [&](std::ptrdiff_t p, std::ptrdiff_t r, std::ptrdiff_t c) {
+        const auto sp = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(p, 0, np - 1));
+        const auto sr = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(r, 0, nr - 1));
+        const auto sc = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(c, 0, nc - 1));
+        return volume[(sp * nr + sr) * nc + sc];
+    };
+    for (std::ptrdiff_t p = 0; p < static_cast<std::ptrdiff_t>(np); ++p) {
+        for (std::ptrdiff_t r = 0; r < static_cast<std::ptrdiff_t>(nr); ++r) {
+            for (std::ptrdiff_t c = 0; c < static_cast<std::ptrdiff_t>(nc); ++c) {
+                const double expected = at(p - 1, r, c) + at(p + 1, r, c) + at(p, r - 1, c) + at(p, r + 1, c) + at(p, r, c - 1) +
+                                        at(p, r, c + 1) - 6.0 * at(p, r, c);
+                assert(laplacian[(static_cast<std::size_t>(p) * nr + static_cast<std::size_t>(r)) * nc + static_cast<std::size_t>(c)] == expected);
+            }
+        }
+    }
+
+    bool threw = false;
+    try {
+        dense_index::stencil_apply(in, OutVolume(laplacian.data(), np, nr, nc - 1), 1, [](const auto& n) { return n.center(); });
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // In-place updates would race between tiles; the matrix form and a shifted view are both refused
+    int aliased = 0;
+    try {
+        dense_index::stencil_apply(current, current, 1, [](const auto& n) { return n.center(); }, scheduler);
+    } catch (const std::invalid_argument&) {
+        ++aliased;
+    }
+    try {
+        const Volume src(volume.data(), np, nr, nc - 1);
+        dense_index::stencil_apply(src, OutVolume(volume.data() + 1, np, nr, nc - 1), 1, [](const auto& n) { return n.center(); });
+    } catch (const std::invalid_argument&) {
+        ++aliased;
+    }
+    assert(aliased == 2);
+
+    std::cout << "  ✓ Tiled stencils match direct loops for every boundary rule" << std::endl;
+}
+
+// Test bijections between index spaces
+void test_dense_bijection() {
+    std::cout << "Testing DenseBijection..." << std::endl;
+
+    struct ExternalTag {};
+    struct SlotTag {};
+    using External = dense_index::StrongIndex<ExternalTag>;
+    using Slot = dense_index::StrongIndex<SlotTag, std::uint32_t>;
+    using Bijection = dense_index::DenseBijection<External, Slot>;
+
+    // Every pair must be visible, and consistent, from both sides
+    const auto consistent = [](const Bijection& m) {
+        std::size_t pairs = 0;
+        for (auto a : m.a_indices()) {
+            if (auto b = m.find(a)) {
+                if (m.inverse(*b) != a) return false;
+                ++pairs;
+            }
+        }
+        for (auto b : m.b_indices()) {
+            if (auto a = m.find_inverse(b); a && m.map(*a) != b) return false;
+        }
+        return pairs == m.size();
+    };
+
+    Bijection m(6, 4);
+    assert(m.empty() && m.a_size() == 6 && m.b_size() == 4);
+    m.assign(External(5), Slot(0));
+    m.assign(External(2), Slot(1));
+    assert(m.size() == 2 && m.map(External(5)) == Slot(0) && m.inverse(Slot(1)) == External(2));
+    assert(!m.contains(External(0)) && !m.find_inverse(Slot(3)));
+
+    // Reassigning either side unpairs the old partner
+    m.assign(External(3), Slot(0));
+    assert(!m.contains(External(5)) && m.inverse(Slot(0)) == External(3) && m.size() == 2);
+    m.assign(External(3), Slot(2));
+    assert(!m.contains_inverse(Slot(0)) && m.size() == 2 && consistent(m));
+
+    m.swap_images(External(3), External(2));
+    assert(m.map(External(3)) == Slot(1) && m.map(External(2)) == Slot(2) && consistent(m));
+    m.swap_images(External(2), External(0));
+    assert(m.map(External(0)) == Slot(2) && !m.contains(External(2)) && consistent(m));
+    m.swap_preimages(Slot(1), Slot(3));
+    assert(m.map(External(3)) == Slot(3) && !m.contains_inverse(Slot(1)) && consistent(m));
+
+    assert(m.erase(External(0)) && !m.erase(External(0)) && m.size() == 1);
+    assert(m.erase_inverse(Slot(3)) && m.empty() && consistent(m));
+
+    bool threw = false;
+    try {
+        (void)m.at(External(1));
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Dense packing of the slot side mirrors swap-and-pop on slot-indexed data
+    Bijection packed(8, 0);
+    std::vector<int> payload;
+    for (std::size_t e = 0; e < 8; e += 2) {
+        const auto slot = packed.push_back(External(e));
+        assert(slot.value() == payload.size());
+        payload.push_back(static_cast<int>(e) * 10);
+    }
+    const auto erase = [&](External e) {
+        const auto hole = packed.map(e);
+        const auto moved = packed.swap_erase(e);
+        payload[hole.value()] = payload.back();
+        payload.pop_back();
+        return moved;
+    };
+    assert(erase(External(2)) == External(6));
+    assert(!erase(External(4)).has_value());
+    assert(packed.b_size() == 2 && packed.size() == 2 && consistent(packed));
+    packed.for_each([&](External e, Slot s) { assert(payload[s.value()] == static_cast<int>(e.value()) * 10); });
+
+    // Bulk rebuild from a permutation, and the inverted view
+    dense_index::DenseVector<Slot, External> image(1000, Slot(0));
+    for (auto e : dense_index::indices(image)) image[e] = Slot((e.value() * 7) % 1000);
+    auto perm = Bijection::from_permutation(image);
+    assert(perm.size() == 1000 && consistent(perm) && perm.inverse(Slot(7)) == External(1));
+    const auto inv = perm.inverted();
+    static_assert(std::is_same_v<std::remove_cvref_t<decltype(inv)>, dense_index::DenseBijection<Slot, External>>);
+    assert(inv.map(Slot(7)) == External(1) && inv.size() == 1000);
+    image[External(3)] = Slot(7);
+    threw = false;
+    try {
+        perm.rebuild(std::span<const Slot>(image.data(), image.size()));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && perm.empty() && perm.a_size() == 0);
+
+    // Shrinking a domain unpairs what falls outside it
+    auto resized = Bijection::from_permutation(std::vector<Slot>{Slot(2), Slot(0), Slot(1)});
+    resized.resize(3, 2);
+    assert(resized.size() == 2 && !resized.contains(External(0)) && consistent(resized));
+
+    std::cout << "  ✓ Both directions stay in sync through every update" << std::endl;
+}
+
+// Test interval sets of index runs
+void test_interval_set() {
+    std::cout << "Testing DenseIntervalSet..." << std::endl;
+
+    struct PageTag {};
+    using Page = dense_index::StrongIndex<PageTag, std::uint32_t>;
+    using Pages = dense_index::DenseIntervalSet<Page>;
+    using Range = dense_index::IndexRange<Page>;
+    const auto range = [](std::size_t first, std::size_t last) { return Range(Page(first), Page(last)); };
+    static_assert(std::ranges::forward_range<Pages>);
+
+    // Coalescing: adjacent and overlapping inserts merge into one run
+    Pages dirty;
+    dirty.insert(range(10, 20));
+    dirty.insert(range(30, 40));
+    dirty.insert(Page(20));
+    assert(dirty.run_count() == 2 && dirty.size() == 21);
+    dirty.insert(range(21, 30));
+    assert(dirty.run_count() == 1 && dirty.run(0) == range(10, 40) && dirty.size() == 30);
+
+    // Erasing from the middle splits a run
+    dirty.erase(range(15, 18));
+    assert(dirty.run_count() == 2 && dirty.size() == 27);
+    assert(dirty.contains(Page(14)) && !dirty.contains(Page(15)) && dirty.contains(Page(18)));
+    assert(dirty.contains(range(18, 40)) && !dirty.contains(range(12, 20)));
+    assert(dirty.find_next(Page(15)) == Page(18) && dirty.find_next(Page(12)) == Page(12) && !dirty.find_next(Page(40)));
+    assert(dirty.front() == Page(10) && dirty.back() == Page(39));
+
+    // Free-slot allocation hands out the lowest index
+    Pages free_slots{range(0, 3), range(8, 9)};
+    assert(free_slots.pop_front() == Page(0) && free_slots.pop_front() == Page(1) && free_slots.pop_front() == Page(2));
+    assert(free_slots.pop_front() == Page(8) && !free_slots.pop_front() && free_slots.empty());
+    Pages slots{range(0, 1), range(3, 4), range(6, 7), range(9, 10)};
+    assert(slots.pop_front() == Page(0));
+    slots.insert(Page(1));  // new smallest run lands in the drained slot
+    assert(slots.run_count() == 4 && slots.front() == Page(1) && slots.size() == 4);
+    assert(slots.pop_front() == Page(1) && slots.pop_front() == Page(3) && slots.run(0) == range(6, 7));
+    assert((slots == Pages{range(6, 7), range(9, 10)}) && !slots.contains(Page(3)));
+
+    // Random operations against a reference set
+    std::uint32_t seed = 777;
+    const auto next = [&](std::uint32_t bound) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % bound;
+    };
+    const auto matches = [](const Pages& s, const std::set<std::size_t>& ref) {
+        if (s.size() != ref.size()) return false;
+        std::vector<std::size_t> got;
+        for (auto p : s) got.push_back(p.value());
+        if (!std::equal(got.begin(), got.end(), ref.begin(), ref.end())) return false;
+        std::size_t visited = 0;
+        s.for_each([&](Page p) { visited += ref.count(p.value()); });
+        // Runs are sorted, disjoint and never adjacent
+        std::size_t prev_last = 0;
+        bool first = true;
+        for (auto r : s.runs()) {
+            if (r.empty() || (!first && r.first().value() <= prev_last)) return false;
+            prev_last = r.last().value();
+            first = false;
+        }
+        return visited == ref.size();
+    };
+    Pages a;
+    Pages b;
+    std::set<std::size_t> ref_a;
+    std::set<std::size_t> ref_b;
+    for (int step = 0; step < 2000; ++step) {
+        const auto first = next(500);
+        const auto last = first + next(20);
+        auto& s = step % 2 ? a : b;
+        auto& ref = step % 2 ? ref_a : ref_b;
+        if (next(3) == 0) {
+            s.erase(range(first, last));
+            for (auto i = first; i < last; ++i) ref.erase(i);
+        } else if (next(4) == 0) {
+            for (auto n = next(30); n > 0 && !ref.empty(); --n) {
+                assert(s.pop_front() == Page(*ref.begin()));
+                ref.erase(ref.begin());
+            }
+        } else {
+            s.insert(range(first, last));
+            for (auto i = first; i < last; ++i) ref.insert(i);
+        }
+        if (step % 100 == 0) {
+            assert(matches(a, ref_a) && matches(b, ref_b));
+            const auto probe = next(520);
+            assert(a.contains(Page(probe)) == (ref_a.count(probe) == 1));
+        }
+    }
+    assert(matches(a, ref_a) && matches(b, ref_b));
+
+    std::set<std::size_t> ref_union;
+    std::set<std::size_t> ref_inter;
+    std::set<std::size_t> ref_diff;
+    std::ranges::set_union(ref_a, ref_b, std::inserter(ref_union, ref_union.end()));
+    std::ranges::set_intersection(ref_a, ref_b, std::inserter(ref_inter, ref_inter.end()));
+    std::ranges::set_difference(ref_a, ref_b, std::inserter(ref_diff, ref_diff.end()));
+    assert(matches(a | b, ref_union) && matches(a & b, ref_inter) && matches(a - b, ref_diff));
+
+    // Bitset round trip, including runs crossing word boundaries
+    const auto bits = a.to_bitset(600);
+    assert(bits.count() == a.size());
+    for (auto p : a) assert(bits.test(p));
+    assert(Pages::from_bitset(bits) == a);
+    dense_index::DenseBitset<Page> full(130, true);
+    const auto all = Pages::from_bitset(full);
+    assert(all.run_count() == 1 && all.run(0) == range(0, 130));
+    assert(Pages::from_bitset(dense_index::DenseBitset<Page>(70)).empty());
+    bool threw = false;
+    try {
+        (void)a.to_bitset(10);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "  ✓ Runs coalesce and split, set algebra and bitset round trips" << std::endl;
+}
+
+// Test stable vector handles and free list
+void test_stable_vector() {
+    std::cout << "Testing DenseStableVector..." << std::endl;
+
+    struct BodyTag {};
+    using Body = dense_index::StrongIndex<BodyTag, std::uint32_t>;
+
+    // Counts live instances so leaks and double destruction show up
+    static int live = 0;
+    struct Tracked {
+        std::string name;
+        explicit Tracked(std::string n) : name(std::move(n)) { ++live; }
+        Tracked(const Tracked& o) : name(o.name) { ++live; }
+        Tracked(Tracked&& o) noexcept : name(std::move(o.name)) { ++live; }
+        ~Tracked() { --live; }
+    };
+
+    {
+        dense_index::DenseStableVector<Tracked, Body> bodies;
+        std::vector<Body> ids;
+        for (int i = 0; i < 100; ++i) ids.push_back(bodies.emplace("body" + std::to_string(i)));
+        assert(bodies.size() == 100 && live == 100 && ids[57] == Body(57));
+
+        // Erase leaves holes; other indices keep their elements
+        for (int i = 0; i < 100; i += 3) bodies.erase(ids[static_cast<std::size_t>(i)]);
+        assert(bodies.size() == 66 && bodies.hole_count() == 34 && live == 66);
+        assert(!bodies.contains(Body(99)) && bodies.contains(Body(98)) && bodies[Body(98)].name == "body98");
+        bool threw = false;
+        try {
+            (void)bodies.at(Body(0));
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Holes are reused most recent first, without growing
+        assert(bodies.emplace("reused") == Body(99) && bodies.emplace("again") == Body(96));
+        assert(bodies.slot_count() == 100 && bodies.size() == 68);
+
+        // Iteration visits live slots only, in index order
+        std::size_t visited = 0;
+        Body prev(0);
+        bool ordered = true;
+        for (auto it = bodies.begin(); it != bodies.end(); ++it) {
+            ordered = ordered && (visited == 0 || prev < it.index());
+            prev = it.index();
+            assert(bodies.contains(it.index()) && &*it == &bodies[it.index()]);
+            ++visited;
+        }
+        assert(ordered && visited == bodies.size());
+        std::size_t counted = 0;
+        std::as_const(bodies).for_each([&](Body b, const Tracked& t) {
+            assert(&t == &bodies[b]);
+            ++counted;
+        });
+        assert(counted == bodies.size());
+
+        // Copies and moves keep indices and the free list
+        auto copy = bodies;
+        assert(live == 2 * 68 && copy[Body(98)].name == "body98" && copy.emplace("x") == Body(93));
+        auto moved = std::move(copy);
+        assert(moved.size() == 69 && copy.empty() && moved[Body(93)].name == "x");
+        moved.clear();
+        assert(moved.empty() && live == 68);
+        assert(moved.emplace("fresh") == Body(0));
+
+        // An element of the vector is a valid source even when emplace grows it
+        dense_index::DenseStableVector<Tracked, Body> names;
+        for (int i = 0; i < 16; ++i) (void)names.emplace("a name long enough to allocate " + std::to_string(i));
+        assert(names.capacity() == 16);
+        assert(names.emplace(names[Body(3)]) == Body(16) && names.capacity() > 16);
+        assert(names[Body(16)].name == "a name long enough to allocate 3");
+    }
+    assert(live == 0);
+
+    // A copy that throws while growing leaves the vector and its elements intact
+    static int copies_left = 0;
+    struct Fragile {
+        int value;
+        explicit Fragile(int v) : value(v) { ++live; }
+        Fragile(const Fragile& o) : value(o.value) {
+            if (copies_left-- == 0) throw std::runtime_error("copy");
+            ++live;
+        }
+        Fragile(Fragile&& o) : Fragile(static_cast<const Fragile&>(o)) {}  // not noexcept, so growth copies
+        ~Fragile() { --live; }
+    };
+    {
+        dense_index::DenseStableVector<Fragile, Body> fragile;
+        for (int i = 0; i < 16; ++i) (void)fragile.emplace(i);
+        fragile.erase(Body(5));
+        copies_left = 8;
+        bool threw = false;
+        try {
+            fragile.reserve(64);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw && live == 15 && fragile.capacity() == 16 && fragile[Body(15)].value == 15);
+        copies_left = 1000;
+        fragile.reserve(64);
+        assert(live == 15 && fragile.capacity() == 64 && fragile.emplace(99) == Body(5));
+    }
+    assert(live == 0);
+
+    // Growth with holes, and iteration over a sparse occupancy
+    dense_index::DenseStableVector<int, Body> sparse;
+    for (int i = 0; i < 5000; ++i) (void)sparse.insert(i);
+    for (int i = 0; i < 5000; ++i) {
+        if (i % 701 != 0) sparse.erase(Body(static_cast<std::size_t>(i)));
+    }
+    std::vector<int> seen;
+    for (int v : sparse) seen.push_back(v);
+    assert((seen == std::vector<int>{0, 701, 1402, 2103, 2804, 3505, 4206, 4907}));
+    static_assert(std::ranges::forward_range<dense_index::DenseStableVector<int, Body>>);
+    for (int i = 0; i < 100; ++i) (void)sparse.insert(-i);
+    sparse.reserve(20000);
+    assert(sparse.size() == 108 && sparse.slot_count() == 5000 && sparse[Body(701)] == 701);
+
+    std::cout << "  ✓ Holes are reused, indices stay stable, iteration skips holes" << std::endl;
+}
+
+// Test lock-free object pool handles
+void test_object_pool() {
+    std::cout << "Testing DenseObjectPool..." << std::endl;
+
+    struct SessionTag {};
+    using Session = dense_index::StrongIndex<SessionTag, std::uint32_t>;
+    static_assert(sizeof(Session) == 4);
+
+    static std::atomic<int> live{0};
+    struct Connection {
+        std::uint64_t id;
+        std::atomic<int> owners{0};
+        explicit Connection(std::uint64_t i) : id(i) { live.fetch_add(1, std::memory_order_relaxed); }
+        ~Connection() { live.fetch_sub(1, std::memory_order_relaxed); }
+    };
+    using Pool = dense_index::DenseObjectPool<Connection, Session, 256>;
+
+    {
+        Pool pool(1000);
+        const auto a = pool.acquire(1u);
+        const auto b = pool.acquire(2u);
+        assert(a == Session(0) && b == Session(1) && pool[b].id == 2 && live == 2);
+        pool.release(a);
+        assert(live == 1 && pool.acquire(3u) == a && pool[a].id == 3);
+
+        // Exhaustion throws instead of handing out a slot twice
+        Pool tiny(2);
+        (void)tiny.acquire(0u);
+        (void)tiny.acquire(0u);
+        bool threw = false;
+        try {
+            (void)tiny.acquire(0u);
+        } catch (const std::length_error&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Chunks never move, so references survive later growth
+        Connection& first = pool[b];
+        std::vector<Session> more;
+        for (int i = 0; i < 600; ++i) more.push_back(pool.acquire(static_cast<std::uint64_t>(i)));
+        assert(&first == &pool[b] && pool[more[599]].id == 599);
+        for (auto s : more) pool.release(s);
+    }
+    assert(live == 0);
+
+    // Churn from several threads through local caches: no slot is ever held
+    // twice at the same time, and every object is destroyed
+    {
+        constexpr int threads = 4;
+        constexpr int rounds = 20000;
+        Pool pool(threads * 300);
+        std::atomic<bool> doubled{false};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                Pool::LocalCache<16> cache(pool);
+                std::vector<Session> held;
+                std::uint32_t seed = static_cast<std::uint32_t>(t) + 1;
+                for (int r = 0; r < rounds; ++r) {
+                    seed = seed * 1664525u + 1013904223u;
+                    if (held.size() < 200 && ((seed >> 16) % 3 != 0 || held.empty())) {
+                        const auto s = (seed >> 10) % 2 ? cache.acquire(static_cast<std::uint64_t>(t)) : pool.acquire(static_cast<std::uint64_t>(t));
+                        if (pool[s].owners.fetch_add(1) != 0 || pool[s].id != static_cast<std::uint64_t>(t)) doubled = true;
+                        held.push_back(s);
+                    } else {
+                        const auto k = (seed >> 4) % held.size();
+                        const auto s = held[k];
+                        held[k] = held.back();
+                        held.pop_back();
+                        pool[s].owners.fetch_sub(1);
+                        if ((seed >> 12) % 2) {
+                            cache.release(s);
+                        } else {
+                            pool.release(s);
+                        }
+                    }
+                }
+                // Leave some objects live for the pool destructor
+                for (std::size_t k = 0; k < held.size() / 2; ++k) {
+                    pool[held[k]].owners.fetch_sub(1);
+                    cache.release(held[k]);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        assert(!doubled);
+        assert(pool.slots_used() <= pool.capacity());
+    }
+    assert(live == 0);
+
+    std::cout << "  ✓ Typed 32-bit handles, lock-free reuse and local caches" << std::endl;
+}
+
+// Test indexed heaps and Dijkstra
+void test_indexed_heap() {
+    std::cout << "Testing DenseIndexedHeap and DenseRadixHeap..." << std::endl;
+
+    struct NodeTag {};
+    struct EdgeTag {};
+    using NodeId = dense_index::StrongIndex<NodeTag, std::uint32_t>;
+    using EdgeId = dense_index::StrongIndex<EdgeTag>;
+
+    std::uint64_t state = 99;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+
+    // Random pushes, decreases, updates and erases against an ordered reference
+    dense_index::DenseIndexedHeap<NodeId, double> heap(500);
+    std::set<std::pair<double, std::uint32_t>> ref;
+    std::vector<double> key(500, 0.0);
+    std::vector<bool> in(500, false);
+    for (int step = 0; step < 20000; ++step) {
+        const auto v = static_cast<std::uint32_t>(next() % 500);
+        const double k = static_cast<double>(next() % 10000);
+        switch (next() % 5) {
+        case 0:
+        case 1:
+            if (heap.push_or_decrease(NodeId(v), k)) {
+                if (in[v]) ref.erase({key[v], v});
+                key[v] = k;
+                in[v] = true;
+                ref.insert({k, v});
+            } else {
+                assert(in[v] && key[v] <= k);
+            }
+            break;
+        case 2:
+            if (in[v]) {
+                heap.update(NodeId(v), k);
+                ref.erase({key[v], v});
+                ref.insert({k, v});
+                key[v] = k;
+            }
+            break;
+        case 3:
+            assert(heap.erase(NodeId(v)) == in[v]);
+            if (in[v]) ref.erase({key[v], v});
+            in[v] = false;
+            break;
+        default:
+            if (!heap.empty()) {
+                const auto [u, p] = heap.pop();
+                assert(p == ref.begin()->first && in[u.value()] && key[u.value()] == p);
+                ref.erase({p, u.value()});
+                in[u.value()] = false;
+            }
+        }
+        assert(heap.size() == ref.size() && heap.contains(NodeId(v)) == in[v]);
+        if (!heap.empty()) assert(heap.top_priority() == ref.begin()->first);
+    }
+    heap.clear();
+    assert(heap.empty() && !heap.contains(NodeId(0)));
+
+    // Max-heap through the comparator, and an arity that does not fill a line
+    dense_index::DenseIndexedHeap<NodeId, int, 3, std::greater<int>> max_heap(10);
+    for (std::uint32_t i = 0; i < 10; ++i) max_heap.push(NodeId(i), static_cast<int>((i * 7) % 10));
+    max_heap.decrease_key(NodeId(0), 42);
+    assert(max_heap.pop().first == NodeId(0) && max_heap.pop().second == 9 && max_heap.size() == 8);
+
+    // Radix heap: monotone keys, popped in order, with decrease-key
+    dense_index::DenseRadixHeap<NodeId> radix(300);
+    std::multiset<std::uint32_t> radix_ref;
+    std::vector<std::uint32_t> radix_key(300, 0);
+    std::uint32_t floor = 0;
+    for (int step = 0; step < 20000; ++step) {
+        const auto v = static_cast<std::uint32_t>(next() % 300);
+        const auto k = floor + static_cast<std::uint32_t>(next() % 5000);
+        if (next() % 3 != 0) {
+            const bool had = radix.contains(NodeId(v));
+            const auto old = radix_key[v];
+            if (radix.push_or_decrease(NodeId(v), k)) {
+                if (had) radix_ref.erase(radix_ref.find(old));
+                radix_ref.insert(k);
+                radix_key[v] = k;
+            }
+        } else if (!radix.empty()) {
+            const auto [u, p] = radix.pop();
+            assert(p == *radix_ref.begin() && p >= floor && radix_key[u.value()] == p);
+            radix_ref.erase(radix_ref.begin());
+            floor = p;
+        }
+        assert(radix.size() == radix_ref.size());
+    }
+
+    // Dijkstra matches a lazy-deletion reference, for real and integer weights
+    for (bool integral : {false, true}) {
+        const std::size_t n = 3000;
+        struct Edge {
+            NodeId from;
+            NodeId to;
+            std::uint32_t weight;
+        };
+        std::vector<Edge> edges;
+        for (int i = 0; i < 15000; ++i) {
+            edges.push_back({NodeId(next() % (n - 100)), NodeId(next() % (n - 100)), static_cast<std::uint32_t>(1 + next() % 1000)});
+        }
+        std::vector<std::uint64_t> expected(n, std::numeric_limits<std::uint64_t>::max());
+        std::vector<std::vector<std::pair<std::size_t, std::uint32_t>>> adj(n);
+        for (const auto& e : edges) adj[e.from.value()].push_back({e.to.value(), e.weight});
+        std::vector<std::pair<std::uint64_t, std::size_t>> pq{{0, 0}};
+        expected[0] = 0;
+        while (!pq.empty()) {
+            std::pop_heap(pq.begin(), pq.end(), std::greater<>{});
+            const auto [d, u] = pq.back();
+            pq.pop_back();
+            if (d > expected[u]) continue;
+            for (auto [v, w] : adj[u]) {
+                if (d + w < expected[v]) {
+                    expected[v] = d + w;
+                    pq.emplace_back(expected[v], v);
+                    std::push_heap(pq.begin(), pq.end(), std::greater<>{});
+                }
+            }
+        }
+        const auto check = [&](const auto& dist) {
+            for (std::size_t v = 0; v < n; ++v) {
+                if (expected[v] == std::numeric_limits<std::uint64_t>::max()) {
+                    assert(dist[NodeId(v)] == std::numeric_limits<std::remove_cvref_t<decltype(dist[NodeId(v)])>>::max() ||
+                           std::isinf(static_cast<double>(dist[NodeId(v)])));
+                } else {
+                    assert(static_cast<std::uint64_t>(dist[NodeId(v)]) == expected[v]);
+                }
+            }
+        };
+        if (integral) {
+            auto graph = dense_index::DenseCsrGraph<NodeId, EdgeId, std::uint32_t>::from_edges(n, edges, &Edge::from, &Edge::to, &Edge::weight);
+            check(dense_index::sssp_dijkstra(graph, NodeId(0)));
+        } else {
+            auto graph = dense_index::DenseCsrGraph<NodeId, EdgeId, double>::from_edges(n, edges, &Edge::from, &Edge::to,
+                                                                                         [](const Edge& e) { return static_cast<double>(e.weight); });
+            check(dense_index::sssp_dijkstra(graph, NodeId(0)));
+            // Point-to-point: the target's distance is final when the search stops
+            std::size_t far = 0;
+            for (std::size_t v = 0; v < n; ++v) {
+                if (expected[v] != std::numeric_limits<std::uint64_t>::max() && expected[v] > expected[far]) far = v;
+            }
+            const auto early = dense_index::sssp_dijkstra(graph, NodeId(0), NodeId(far));
+            assert(static_cast<std::uint64_t>(early[NodeId(far)]) == expected[far]);
+        }
+    }
+
+    // Path lengths near the top of an unsigned weight saturate instead of wrapping
+    {
+        using Graph = dense_index::DenseCsrGraph<NodeId, EdgeId, unsigned>;
+        const unsigned big = std::numeric_limits<unsigned>::max() - 2;
+        const std::vector<std::tuple<NodeId, NodeId, unsigned>> edges{
+            {NodeId(0), NodeId(1), big}, {NodeId(1), NodeId(2), 5u}, {NodeId(0), NodeId(2), 10u}};
+        const auto weighted = Graph::from_edges(3, edges, [](const auto& e) { return std::get<0>(e); },
+                                                [](const auto& e) { return std::get<1>(e); }, [](const auto& e) { return std::get<2>(e); });
+        const auto dist = dense_index::sssp_dijkstra(weighted, NodeId(0));
+        assert(dist[NodeId(1)] == big && dist[NodeId(2)] == 10u);
+
+        const auto unweighted = Graph::from_edges(3, edges, [](const auto& e) { return std::get<0>(e); },
+                                                  [](const auto& e) { return std::get<1>(e); });
+        bool threw = false;
+        try {
+            (void)dense_index::sssp_dijkstra(unweighted, NodeId(0));
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    std::cout << "  ✓ Decrease-key heaps match reference queues, Dijkstra matches" << std::endl;
+}
+
+// Test sequential and concurrent union-find
+void test_union_find() {
+    std::cout << "Testing DenseUnionFind..." << std::endl;
+
+    struct ItemTag {};
+    struct GroupTag {};
+    using Item = dense_index::StrongIndex<ItemTag, std::uint32_t>;
+    using Group = dense_index::StrongIndex<GroupTag>;
+    static_assert(sizeof(Item) == 4);
+
+    std::uint64_t state = 4242;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+
+    // Sequential: unions against a brute-force relabeling
+    const std::size_t n = 2000;
+    dense_index::DenseUnionFind<Item> sets(n);
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+    for (int i = 0; i < 1500; ++i) pairs.emplace_back(static_cast<std::uint32_t>(next() % n), static_cast<std::uint32_t>(next() % n));
+    std::size_t merges = 0;
+    for (auto [a, b] : pairs) merges += sets.unite(Item(a), Item(b));
+    assert(sets.set_count() == n - merges);
+
+    std::vector<std::vector<std::uint32_t>> adj(n);
+    for (auto [a, b] : pairs) {
+        adj[a].push_back(b);
+        adj[b].push_back(a);
+    }
+    std::vector<std::size_t> expected(n, n);
+    std::size_t groups = 0;
+    for (std::uint32_t s = 0; s < n; ++s) {
+        if (expected[s] != n) continue;
+        std::vector<std::uint32_t> stack{s};
+        expected[s] = groups;
+        while (!stack.empty()) {
+            const auto u = stack.back();
+            stack.pop_back();
+            for (auto v : adj[u]) {
+                if (expected[v] == n) {
+                    expected[v] = groups;
+                    stack.push_back(v);
+                }
+            }
+        }
+        ++groups;
+    }
+    assert(groups == sets.set_count());
+    const auto labels = sets.components<Group>();
+    for (std::uint32_t v = 0; v < n; ++v) assert(labels[Item(v)] == Group(expected[v]));
+    assert(sets.same(Item(pairs[0].first), Item(pairs[0].second)));
+
+    const auto fresh = sets.add();
+    assert(fresh == Item(n) && sets.size() == n + 1 && sets.set_count() == groups + 1 && sets.find(fresh) == fresh);
+
+    // A narrow index refuses more singletons than it can name
+    struct ByteTag {};
+    using ByteItem = dense_index::StrongIndex<ByteTag, std::uint8_t>;
+    assert(dense_index::DenseUnionFind<ByteItem>(256).size() == 256);
+    bool threw = false;
+    try {
+        dense_index::DenseUnionFind<ByteItem> too_many(257);
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Concurrent: parallel unions over the same edges give the same partition
+    dense_index::WorkStealingScheduler scheduler({.threads = 4});
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        dense_index::DenseConcurrentUnionFind<Item> shared(n);
+        std::atomic<std::size_t> shared_merges{0};
+        scheduler.parallel_for(dense_index::IndexRange<Group>(Group(0), Group(pairs.size())), [&](Group i) {
+            const auto [a, b] = pairs[i.value()];
+            if (shared.unite(Item(a), Item(b))) shared_merges.fetch_add(1, std::memory_order_relaxed);
+            assert(shared.same(Item(a), Item(b)));
+        }, {.grain = 8, .affinity = std::nullopt});
+        assert(shared_merges == merges && shared.set_count() == groups);
+        assert(shared.components<Group>(scheduler) == labels);
+        // Representatives are the smallest member of each set
+        for (std::uint32_t v = 0; v < n; ++v) assert(shared.find(Item(v)).value() <= v);
+    }
+
+    std::cout << "  ✓ Sequential and lock-free unions agree with a reference labeling" << std::endl;
+}
+
+// Test Fenwick and segment trees
+void test_fenwick_segment_tree() {
+    std::cout << "Testing DenseFenwick and DenseSegmentTree..." << std::endl;
+
+    struct DayTag {};
+    using Day = dense_index::StrongIndex<DayTag, std::uint32_t>;
+
+    std::uint64_t state = 73;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+
+    const std::size_t n = 1000;
+    dense_index::DenseVector<long, Day> values(n);
+    for (std::size_t i = 0; i < n; ++i) values[Day(i)] = static_cast<long>(next() % 100);
+
+    // Fenwick: bulk build matches incremental adds, queries match a scan
+    dense_index::DenseFenwick<long, Day> sums(values);
+    dense_index::DenseFenwick<long, Day> incremental(n);
+    for (std::size_t i = 0; i < n; ++i) incremental.add(Day(i), values[Day(i)]);
+    auto scan = [&](std::size_t first, std::size_t last) {
+        return std::accumulate(values.begin() + static_cast<std::ptrdiff_t>(first), values.begin() + static_cast<std::ptrdiff_t>(last), 0L);
+    };
+    for (std::size_t i = 0; i <= n; i += 37) {
+        assert(sums.prefix(Day(i)) == scan(0, i));
+        assert(incremental.prefix(Day(i)) == scan(0, i));
+    }
+    assert(sums.total() == scan(0, n));
+    for (int q = 0; q < 200; ++q) {
+        auto a = next() % (n + 1), b = next() % (n + 1);
+        if (a > b) std::swap(a, b);
+        assert(sums.range(Day(a), Day(b)) == scan(a, b));
+    }
+    for (int u = 0; u < 200; ++u) {
+        const Day d(static_cast<std::uint32_t>(next() % n));
+        values[d] = static_cast<long>(next() % 100);
+        sums.set(d, values[d]);
+        assert(sums.at(d) == values[d]);
+    }
+    assert(sums.range(dense_index::IndexRange<Day>(Day(100), Day(900))) == scan(100, 900));
+
+    // lower_bound: first day whose running total reaches the target
+    for (long target : {1L, 500L, sums.total() / 2, sums.total()}) {
+        const auto d = sums.lower_bound(target);
+        assert(sums.prefix(Day(d.value() + 1)) >= target);
+        assert(sums.prefix(d) < target);
+    }
+    assert(sums.lower_bound(sums.total() + 1) == Day(n));
+
+    // Segment tree with sums, minimums and a non-commutative op
+    dense_index::DenseSegmentTree<long, Day> seg_sum(values);
+    dense_index::DenseSegmentTree<long, Day, dense_index::MinOp> seg_min(values);
+    dense_index::DenseSegmentTree<double, Day, dense_index::MaxOp> seg_max(5);
+    assert(seg_max.total() == -std::numeric_limits<double>::infinity());
+    seg_max.set(Day(3), 2.5);
+    assert(seg_max.total() == 2.5 && seg_max.prefix(Day(3)) == -std::numeric_limits<double>::infinity());
+
+    for (int q = 0; q < 300; ++q) {
+        auto a = next() % (n + 1), b = next() % (n + 1);
+        if (a > b) std::swap(a, b);
+        assert(seg_sum.range(Day(a), Day(b)) == scan(a, b));
+        const long expected_min = a == b ? std::numeric_limits<long>::max()
+                                         : *std::min_element(values.begin() + static_cast<std::ptrdiff_t>(a),
+                                                             values.begin() + static_cast<std::ptrdiff_t>(b));
+        assert(seg_min.range(Day(a), Day(b)) == expected_min);
+        if (q % 3 == 0) {
+            const Day d(static_cast<std::uint32_t>(next() % n));
+            values[d] = static_cast<long>(next() % 1000) - 500;
+            seg_sum.set(d, values[d]);
+            seg_min.set(d, values[d]);
+            assert(seg_min[d] == values[d]);
+        }
+    }
+    assert(seg_sum.total() == scan(0, n) && seg_sum.prefix(Day(n)) == seg_sum.total());
+
+    // Affine maps compose in order; folding must respect it
+    struct Affine {
+        long a = 1, b = 0;
+        bool operator==(const Affine&) const = default;
+    };
+    auto compose = [](const Affine& f, const Affine& g) { return Affine{f.a * g.a, f.b * g.a + g.b}; };  // f, then g
+    dense_index::DenseVector<Affine, Day> maps(13);
+    for (std::size_t i = 0; i < maps.size(); ++i) maps[Day(i)] = Affine{static_cast<long>(next() % 3) + 1, static_cast<long>(next() % 5)};
+    dense_index::DenseSegmentTree<Affine, Day, decltype(compose)> chain(maps, Affine{}, compose);
+    for (std::size_t a = 0; a <= maps.size(); ++a) {
+        for (std::size_t b = a; b <= maps.size(); ++b) {
+            Affine expected{};
+            for (std::size_t i = a; i < b; ++i) expected = compose(expected, maps[Day(i)]);
+            assert(chain.range(Day(a), Day(b)) == expected);
+        }
+    }
+
+    std::cout << "  ✓ Fenwick and segment tree queries match brute force" << std::endl;
+}
+
+// Test tree orders and LCA
+void test_dense_tree() {
+    std::cout << "Testing DenseTree..." << std::endl;
+
+    struct DeptTag {};
+    using Dept = dense_index::StrongIndex<DeptTag, std::uint32_t>;
+    struct Department {
+        std::string name;
+        Dept parent;
+    };
+
+    // Small hierarchy: 0 is the root, 3 is a second root (its own parent)
+    std::vector<Department> depts = {
+        {"Company", Dept(0)}, {"Engineering", Dept(0)}, {"Sales", Dept(0)}, {"Spinoff", Dept(3)},
+        {"Backend", Dept(1)}, {"Frontend", Dept(1)}, {"Spinoff R&D", Dept(3)}, {"Databases", Dept(4)},
+    };
+    auto tree = dense_index::DenseTree<Dept>::from_parents(depts, &Department::parent);
+    assert(tree.size() == 8);
+    assert(tree.roots().size() == 2 && tree.roots()[0] == Dept(0) && tree.roots()[1] == Dept(3));
+    assert(!tree.parent(Dept(0)) && tree.parent(Dept(7)) == Dept(4));
+    assert(tree.children(Dept(1)).size() == 2 && tree.children(Dept(1))[0] == Dept(4));
+    assert(tree.depth(Dept(7)) == 3 && tree.subtree_size(Dept(1)) == 4 && tree.subtree_size(Dept(0)) == 6);
+
+    std::vector<std::uint32_t> pre;
+    for (auto d : tree.preorder()) pre.push_back(d.value());
+    assert((pre == std::vector<std::uint32_t>{0, 1, 4, 7, 5, 2, 3, 6}));
+    std::vector<std::uint32_t> post;
+    for (auto d : tree.postorder()) post.push_back(d.value());
+    assert((post == std::vector<std::uint32_t>{7, 4, 5, 1, 2, 0, 6, 3}));
+    for (auto d : tree.nodes()) {
+        assert(tree.preorder()[tree.pre_index(d)] == d);
+        assert(tree.postorder()[tree.post_index(d)] == d);
+    }
+    auto eng = tree.subtree(Dept(1));
+    assert(eng.size() == 4 && eng[0] == Dept(1) && eng[3] == Dept(5));
+    assert(tree.subtree_range(Dept(1)).size() == 4 && tree.subtree_range(Dept(1)).first() == tree.pre_index(Dept(1)));
+
+    assert(tree.lca(Dept(7), Dept(5)) == Dept(1));
+    assert(tree.lca(Dept(7), Dept(2)) == Dept(0));
+    assert(tree.lca(Dept(4), Dept(7)) == Dept(4));
+    assert(tree.lca(Dept(6), Dept(6)) == Dept(6));
+    assert(!tree.lca(Dept(7), Dept(6)) && !tree.lca(Dept(3), Dept(0)));
+    assert(tree.distance(Dept(7), Dept(2)) == 4u && !tree.distance(Dept(0), Dept(6)));
+
+    // Headcount per subtree
+    dense_index::DenseVector<int, Dept> headcount = {1, 2, 30, 1, 10, 8, 4, 5};
+    auto totals = tree.subtree_reduce(headcount);
+    assert(totals[Dept(1)] == 25 && totals[Dept(0)] == 56 && totals[Dept(3)] == 5 && totals[Dept(7)] == 5);
+    auto deepest = tree.subtree_reduce(headcount, [](int a, int b) { return std::max(a, b); });
+    assert(deepest[Dept(0)] == 30 && deepest[Dept(1)] == 10);
+
+    // Relayout: ids become preorder positions and subtrees contiguous id runs
+    auto dfs = tree.relayout();
+    auto dfs_headcount = tree.relayout(headcount);
+    for (auto d : tree.nodes()) {
+        const auto n = tree.dfs_index(d);
+        assert(dfs_headcount[n] == headcount[d]);
+        assert(dfs.subtree_size(n) == tree.subtree_size(d) && dfs.depth(n) == tree.depth(d));
+        assert(dfs.pre_index(n).value() == n.value());
+        if (auto p = tree.parent(d)) assert(dfs.parent(n) == tree.dfs_index(*p));
+    }
+    assert(dfs.subtree_reduce(dfs_headcount)[tree.dfs_index(Dept(1))] == 25);
+
+    // Invalid input: a cycle, and an out-of-range parent treated as a root
+    dense_index::DenseVector<Dept, Dept> cyclic = {Dept(0), Dept(2), Dept(1)};
+    bool threw = false;
+    try {
+        dense_index::DenseTree<Dept> bad(cyclic);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    dense_index::DenseVector<Dept, Dept> sentinel_roots = {Dept(std::numeric_limits<std::uint32_t>::max()), Dept(0)};
+    dense_index::DenseTree<Dept> small(sentinel_roots);
+    assert(small.is_root(Dept(0)) && small.lca(Dept(1), Dept(0)) == Dept(0));
+
+    // Random forest against brute-force ancestor walks
+    std::uint64_t state = 74;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 33;
+    };
+    const std::size_t n = 3000;
+    dense_index::DenseVector<Dept, Dept> parents(n, Dept(0));
+    for (std::size_t v = 0; v < n; ++v) {
+        // About 1% roots; parents precede children until relabeled below
+        parents[Dept(v)] = (v == 0 || next() % 100 == 0) ? Dept(v) : Dept(static_cast<std::uint32_t>(next() % v));
+    }
+    // Relabel by a random permutation so parents can have larger ids
+    std::vector<std::uint32_t> perm(n);
+    std::iota(perm.begin(), perm.end(), 0u);
+    for (std::size_t i = n; i > 1; --i) std::swap(perm[i - 1], perm[next() % i]);
+    dense_index::DenseVector<Dept, Dept> shuffled(n, Dept(0));
+    for (std::size_t v = 0; v < n; ++v) shuffled[Dept(perm[v])] = Dept(perm[parents[Dept(v)].value()]);
+    dense_index::DenseTree<Dept> forest(shuffled);
+
+    auto brute_lca = [&](std::uint32_t a, std::uint32_t b) -> std::optional<std::uint32_t> {
+        std::set<std::uint32_t> ancestors;
+        for (auto x = a;; x = shuffled[Dept(x)].value()) {
+            ancestors.insert(x);
+            if (shuffled[Dept(x)].value() == x) break;
+        }
+        for (auto x = b;; x = shuffled[Dept(x)].value()) {
+            if (ancestors.contains(x)) return x;
+            if (shuffled[Dept(x)].value() == x) return std::nullopt;
+        }
+    };
+    for (int q = 0; q < 2000; ++q) {
+        const auto a = static_cast<std::uint32_t>(next() % n), b = static_cast<std::uint32_t>(next() % n);
+        const auto expected = brute_lca(a, b);
+        const auto got = forest.lca(Dept(a), Dept(b));
+        assert(expected.has_value() == got.has_value());
+        if (expected) assert(got->value() == *expected);
+    }
+    std::size_t total = 0;
+    for (auto r : forest.roots()) total += forest.subtree_size(r);
+    assert(total == n);
+
+    std::cout << "  ✓ Orders, subtree ranges, LCA and relayout are correct" << std::endl;
+}
+
+// Test ring buffers
+void test_ring_buffer() {
+    std::cout << "Testing DenseRingBuffer..." << std::endl;
+
+    struct SeqTag {};
+    using Seq = dense_index::StrongIndex<SeqTag>;
+    struct Tick {
+        std::string symbol;
+        double price;
+    };
+
+    dense_index::DenseRingBuffer<Tick, Seq> history(5);
+    assert(history.capacity() == 8 && history.empty());
+    for (int i = 0; i < 20; ++i) {
+        const auto seq = history.push_back(Tick{"SYM" + std::to_string(i), 100.0 + i});
+        assert(seq == Seq(static_cast<std::size_t>(i)));
+    }
+    assert(history.full() && history.size() == 8);
+    assert(history.front_index() == Seq(12) && history.next_index() == Seq(20));
+    assert(history.window().size() == 8);
+    assert(history[Seq(15)].symbol == "SYM15" && history.at(Seq(19)).price == 119.0);
+    assert(history.front().symbol == "SYM12" && history.back().symbol == "SYM19");
+    assert(!history.contains(Seq(11)) && !history.contains(Seq(20)) && history.contains(Seq(12)));
+    bool threw = false;
+    try {
+        (void)history.at(Seq(3));  // overwritten long ago
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::size_t expected = 12;
+    for (auto it = history.begin(); it != history.end(); ++it, ++expected) {
+        assert(it.index() == Seq(expected) && it->symbol == "SYM" + std::to_string(expected));
+    }
+    double sum = 0;
+    history.for_each([&](Seq s, const Tick& t) { sum += t.price - static_cast<double>(s.value()); });
+    assert(sum == 800.0);
+
+    history.pop_front();
+    assert(history.front_index() == Seq(13) && history.size() == 7);
+    auto copy = history;
+    auto moved = std::move(copy);
+    assert(moved.size() == 7 && moved.front_index() == Seq(13) && moved[Seq(19)].symbol == "SYM19");
+    history.clear();
+    assert(history.empty() && history.push_back(Tick{"NEXT", 1.0}) == Seq(20));
+
+    // Re-pushing the oldest element of a full buffer copies it before it is dropped
+    dense_index::DenseRingBuffer<std::string, Seq> names(2);
+    (void)names.push_back("a string long enough to live on the heap");
+    (void)names.push_back("second");
+    assert(names.full() && names.push_back(names.front()) == Seq(2));
+    assert(names[Seq(2)] == "a string long enough to live on the heap" && names.front() == "second");
+
+    std::cout << "  ✓ Sequence window, masking and overwrite work" << std::endl;
+
+    // SPSC: a producer thread streams values, the consumer checks order
+    std::cout << "Testing DenseSpscRingBuffer..." << std::endl;
+    dense_index::DenseSpscRingBuffer<std::uint64_t, Seq> ring(64);
+    assert(ring.capacity() == 64 && ring.empty());
+    const std::uint64_t total = 200000;
+    std::thread producer([&] {
+        std::uint64_t next = 0;
+        std::array<std::uint64_t, 16> batch{};
+        while (next < total) {
+            if (next % 3 == 0) {
+                if (auto seq = ring.try_push(next)) {
+                    assert(seq->value() == next);
+                    ++next;
+                } else {
+                    std::this_thread::yield();
+                }
+            } else {
+                const auto k = std::min<std::uint64_t>(batch.size(), total - next);
+                for (std::uint64_t i = 0; i < k; ++i) batch[i] = next + i;
+                const auto pushed = ring.try_push(std::span<const std::uint64_t>(batch.data(), k));
+                if (pushed == 0) std::this_thread::yield();
+                next += pushed;
+            }
+        }
+    });
+    std::uint64_t received = 0;
+    bool ordered = true;
+    while (received < total) {
+        if (received % 2 == 0) {
+            if (auto v = ring.try_pop()) {
+                ordered &= *v == received;
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        } else {
+            const auto k = ring.consume([&](Seq s, std::uint64_t& v) {
+                ordered &= v == received && s.value() == received;
+                ++received;
+            }, 32);
+            if (k == 0) std::this_thread::yield();
+        }
+    }
+    producer.join();
+    assert(ordered);
+    assert(ring.published() == Seq(total) && ring.consumed() == Seq(total) && ring.empty());
+
+    // A full ring rejects pushes rather than overwriting
+    dense_index::DenseSpscRingBuffer<int, Seq> small(2);
+    assert(small.try_push(1) && small.try_push(2) && !small.try_push(3));
+    assert(small.try_pop() == 1 && small.try_push(3) == Seq(2));
+
+    std::cout << "  ✓ SPSC stream arrives complete and in order" << std::endl;
+}
+
 // Compile-time error tests (these should NOT compile)
 template<typename = void>
 void compile_time_error_tests() {
@@ -532,7 +2849,27 @@ void compile_time_error_tests() {
     // auto val3 = emp_vec.at(0);  // Error! deleted function
 }
 
+
+
+
+
+
+
 // Performance test to verify zero overhead
+
+
+
+
+
+
+
+
+
+
+
+
+
+
 void test_performance() {
     std::cout << "Testing performance (zero overhead)..." << std::endl;
 
@@ -578,6 +2915,31 @@ int main() {
     test_concepts();
     test_underlying_access();
     test_type_aliases();
+    test_dense_string_column();
+    test_dense_jagged_array();
+    test_work_stealing_scheduler();
+    test_parallel_filter();
+    test_histogram_and_counting_sort();
+    test_dense_atomic();
+    test_sharded_accumulator();
+    test_graph_algorithms();
+    test_index_queues();
+    test_dense_frontier();
+    test_dense_world();
+    test_spatial_index();
+    test_dense_matrix();
+    test_sparse_matrix();
+    test_dense_mdspan();
+    test_stencil();
+    test_dense_bijection();
+    test_interval_set();
+    test_stable_vector();
+    test_object_pool();
+    test_indexed_heap();
+    test_union_find();
+    test_fenwick_segment_tree();
+    test_dense_tree();
+    test_ring_buffer();
     test_performance();
 
     std::cout << "\n✅ All tests passed!" << std::endl;